@@ -0,0 +1,977 @@
+/**
+ * @file bench.cpp
+ * @author Odin's Ravens
+ * @date April 25, 2025
+ * @brief Micro-benchmark driver for the Deque container.
+ *
+ * Each benchmark is selected by name on the command line; running the driver
+ * with no arguments runs all of them. Build with "make deque_bench" so the
+ * driver is compiled with optimizations and without assertions.
+ *
+ * Course: CSCI 325 — Data Structures and Algorithms
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include "block_resources.h"
+#include "deque.h"
+#include "parallel_algorithms.h"
+#include "ring_queue.h"
+#include "spilling_deque.h"
+#include "work_stealing_deque.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/**
+ * @brief Gets the nanoseconds elapsed since a starting time.
+ * @param start The starting time.
+ * @return Elapsed time in nanoseconds.
+ */
+static double elapsedNs(Clock::time_point start) {
+    return chrono::duration<double, nano>(Clock::now() - start).count();
+}
+
+/**
+ * @brief Long-running FIFO of constant size: push_back/pop_front pairs drift the
+ *        elements toward the end of the blockmap. Prints the blockmap footprint at
+ *        regular checkpoints to show it stays flat instead of doubling forever.
+ */
+void benchFifoBlockmap() {
+    const int queueSize = 10000;
+    const long long operations = 50000000;
+    const int checkpoints = 10;
+
+    Deque<int> dq;
+    for (int i = 0; i < queueSize; ++i)
+        dq.push_back(i);
+
+    cout << "[fifo] constant-size queue of " << queueSize << " ints, "
+         << operations << " push_back/pop_front pairs" << endl;
+    cout << "  " << setw(12) << "ops" << setw(14) << "map slots" << setw(14) << "map bytes"
+         << setw(14) << "block allocs" << setw(10) << "ns/op" << endl;
+
+    long long checksum = 0;
+    long long done = 0;
+    for (int c = 1; c <= checkpoints; ++c) {
+        long long target = operations / checkpoints * c;
+        Clock::time_point start = Clock::now();
+        for (; done < target; ++done) {
+            dq.push_back(static_cast<int>(done));
+            checksum += dq.front();
+            dq.pop_front();
+        }
+        double ns = elapsedNs(start) / (operations / checkpoints);
+
+        cout << "  " << setw(12) << done << setw(14) << dq.blockmap_capacity()
+             << setw(14) << dq.blockmap_capacity() * sizeof(int*)
+             << setw(14) << dq.block_allocations()
+             << setw(10) << fixed << setprecision(2) << ns << endl;
+    }
+    cout << "  checksum: " << checksum << endl;
+}
+
+/**
+ * @brief Prints one result row comparing a bulk call against a loop of single-element calls.
+ * @param label Operation being measured.
+ * @param loopNs Nanoseconds per element for the single-element loop.
+ * @param bulkNs Nanoseconds per element for the bulk call.
+ */
+static void printBulkRow(const char* label, double loopNs, double bulkNs) {
+    cout << "  " << setw(22) << left << label << right
+         << setw(10) << fixed << setprecision(3) << loopNs
+         << setw(10) << bulkNs
+         << setw(9) << setprecision(1) << loopNs / bulkNs << "x" << endl;
+}
+
+/**
+ * @brief Packet-batch ingestion: append/prepend/pop_*_n/copy_out against looping
+ *        over push_back/push_front/pop_* and operator[] one element at a time.
+ */
+void benchBulk() {
+    const int batch = 1024;
+    const int rounds = 20000;
+    const double elements = static_cast<double>(batch) * rounds;
+
+    vector<int> packet(batch);
+    for (int i = 0; i < batch; ++i)
+        packet[i] = i;
+    vector<int> out(batch);
+    long long checksum = 0;
+
+    cout << "[bulk] " << rounds << " batches of " << batch << " ints (ns/element)" << endl;
+    cout << "  " << setw(22) << left << "operation" << right
+         << setw(10) << "loop" << setw(10) << "bulk" << setw(10) << "speedup" << endl;
+
+    // append + pop_front_n: the deque is drained after every batch
+    Deque<int> loopDq, bulkDq;
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < batch; ++i)
+            loopDq.push_back(packet[i]);
+        checksum += loopDq.back();
+        for (int i = 0; i < batch; ++i)
+            loopDq.pop_front();
+    }
+    double loopNs = elapsedNs(start) / elements;
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        bulkDq.append(packet.data(), batch);
+        checksum += bulkDq.back();
+        bulkDq.pop_front_n(batch);
+    }
+    double bulkNs = elapsedNs(start) / elements;
+    printBulkRow("append + pop_front_n", loopNs, bulkNs);
+
+    // prepend + pop_back_n
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = batch - 1; i >= 0; --i)
+            loopDq.push_front(packet[i]);
+        checksum += loopDq.front();
+        for (int i = 0; i < batch; ++i)
+            loopDq.pop_back();
+    }
+    loopNs = elapsedNs(start) / elements;
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        bulkDq.prepend(packet.data(), batch);
+        checksum += bulkDq.front();
+        bulkDq.pop_back_n(batch);
+    }
+    bulkNs = elapsedNs(start) / elements;
+    printBulkRow("prepend + pop_back_n", loopNs, bulkNs);
+
+    // copy_out of a resident batch
+    loopDq.append(packet.data(), batch);
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < batch; ++i)
+            out[i] = loopDq[i];
+        checksum += out[r % batch];
+    }
+    loopNs = elapsedNs(start) / elements;
+    start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        loopDq.copy_out(out.data(), batch);
+        checksum += out[r % batch];
+    }
+    bulkNs = elapsedNs(start) / elements;
+    printBulkRow("copy_out", loopNs, bulkNs);
+
+    cout << "  checksum: " << checksum << endl;
+}
+
+/**
+ * @brief Sums a deque of ints through each traversal interface: operator[],
+ *        iterators, range-for, std::accumulate and for_each_segment.
+ */
+void benchIterate() {
+    const int elements = 1 << 22;
+    const int passes = 50;
+
+    Deque<int> dq;
+    for (int i = 0; i < elements; ++i)
+        dq.push_back(i & 1023);
+
+    cout << "[iterate] sum of " << elements << " ints, " << passes << " passes (ns/element)" << endl;
+    long long checksum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (int p = 0; p < passes; ++p) {
+        long long sum = 0;
+        for (int i = 0; i < dq.size(); ++i)
+            sum += dq[i];
+        checksum += sum;
+    }
+    cout << "  " << setw(20) << left << "operator[]" << right << fixed << setprecision(3)
+         << elapsedNs(start) / elements / passes << endl;
+
+    start = Clock::now();
+    for (int p = 0; p < passes; ++p) {
+        long long sum = 0;
+        for (Deque<int>::const_iterator it = dq.cbegin(); it != dq.cend(); ++it)
+            sum += *it;
+        checksum += sum;
+    }
+    cout << "  " << setw(20) << left << "iterator" << right
+         << elapsedNs(start) / elements / passes << endl;
+
+    start = Clock::now();
+    for (int p = 0; p < passes; ++p) {
+        long long sum = 0;
+        for (int value : dq)
+            sum += value;
+        checksum += sum;
+    }
+    cout << "  " << setw(20) << left << "range-for" << right
+         << elapsedNs(start) / elements / passes << endl;
+
+    start = Clock::now();
+    for (int p = 0; p < passes; ++p)
+        checksum += accumulate(dq.begin(), dq.end(), 0LL);
+    cout << "  " << setw(20) << left << "std::accumulate" << right
+         << elapsedNs(start) / elements / passes << endl;
+
+    start = Clock::now();
+    for (int p = 0; p < passes; ++p) {
+        long long sum = 0;
+        dq.for_each_segment([&sum](const int* data, int len) {
+            for (int i = 0; i < len; ++i)
+                sum += data[i];
+        });
+        checksum += sum;
+    }
+    cout << "  " << setw(20) << left << "for_each_segment" << right
+         << elapsedNs(start) / elements / passes << endl;
+
+    cout << "  checksum: " << checksum << endl;
+}
+
+/**
+ * @brief A 64-byte element, standing in for a small request struct.
+ */
+struct Payload64 {
+    long long words[8];
+
+    explicit Payload64(long long v) {
+        for (int i = 0; i < 8; ++i)
+            words[i] = v + i;
+    }
+};
+
+/**
+ * @brief Gets the value a benchmark folds into its checksum for one element.
+ */
+static long long keyOf(int value) { return value; }
+static long long keyOf(const Payload64& value) { return value.words[0]; }
+
+/**
+ * @brief Measures one block size policy: push_back/pop_front throughput and random
+ *        operator[] reads, for element type T in blocks of Bytes bytes.
+ * @param typeName Name printed for T.
+ * @param indices Random indices (below the deque size) to read.
+ * @param checksum Running checksum so the work is not optimized away.
+ */
+template <typename T, size_t Bytes>
+void sweepBlockSize(const char* typeName, const vector<int>& indices, long long& checksum) {
+    // MinElements = 1 so the sweep really varies the block bytes for large types too
+    typedef Deque<T, BlockBytes<T, Bytes, 1>::value> SweepDeque;
+    const int elements = 1 << 20;
+
+    SweepDeque dq;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < elements; ++i)
+        dq.emplace_back(i);
+    for (int i = 0; i < elements; ++i) {
+        checksum += keyOf(dq.front());
+        dq.pop_front();
+    }
+    double pushPopNs = elapsedNs(start) / elements;
+
+    for (int i = 0; i < elements; ++i)
+        dq.emplace_back(i);
+    start = Clock::now();
+    for (size_t i = 0; i < indices.size(); ++i)
+        checksum += keyOf(dq[indices[i]]);
+    double randomNs = elapsedNs(start) / indices.size();
+
+    cout << "  " << setw(10) << left << typeName << right << setw(8) << Bytes
+         << setw(10) << SweepDeque::block_size()
+         << setw(14) << fixed << setprecision(3) << pushPopNs
+         << setw(14) << randomNs << endl;
+}
+
+/**
+ * @brief Sweeps block byte budgets from 256 B to 64 KiB for a small and a 64-byte
+ *        element type, to pick a block size policy per element type.
+ */
+void benchBlockSweep() {
+    const int elements = 1 << 20;
+    const int reads = 1 << 22;
+
+    vector<int> indices(reads);
+    unsigned int state = 12345;
+    for (int i = 0; i < reads; ++i) {
+        state = state * 1103515245u + 12345u;
+        indices[i] = static_cast<int>((state >> 8) % elements);
+    }
+    long long checksum = 0;
+
+    cout << "[blocks] block size sweep, " << elements << " elements, "
+         << reads << " random reads (ns/op)" << endl;
+    cout << "  " << setw(10) << left << "type" << right << setw(8) << "bytes"
+         << setw(10) << "elements" << setw(14) << "push/pop" << setw(14) << "random []" << endl;
+
+    sweepBlockSize<int, 256>("int", indices, checksum);
+    sweepBlockSize<int, 1024>("int", indices, checksum);
+    sweepBlockSize<int, 4096>("int", indices, checksum);
+    sweepBlockSize<int, 16384>("int", indices, checksum);
+    sweepBlockSize<int, 65536>("int", indices, checksum);
+    sweepBlockSize<Payload64, 256>("payload64", indices, checksum);
+    sweepBlockSize<Payload64, 1024>("payload64", indices, checksum);
+    sweepBlockSize<Payload64, 4096>("payload64", indices, checksum);
+    sweepBlockSize<Payload64, 16384>("payload64", indices, checksum);
+    sweepBlockSize<Payload64, 65536>("payload64", indices, checksum);
+
+    cout << "  checksum: " << checksum << endl;
+}
+
+/**
+ * @brief Runs a binary tree of tasks on a pool of workers, each owning a
+ *        WorkStealingDeque: a task of depth d > 0 pushes two tasks of depth d - 1,
+ *        leaves do a little arithmetic. Idle workers steal from random victims.
+ * @param workers Number of worker threads.
+ * @param depth Depth of the task tree (2^(depth+1) - 1 tasks).
+ * @param checksum Running checksum so the leaf work is not optimized away.
+ * @return Wall-clock nanoseconds for the whole tree.
+ */
+static double runTaskTree(int workers, int depth, long long& checksum) {
+    vector<unique_ptr<WorkStealingDeque<int>>> queues;
+    for (int w = 0; w < workers; ++w)
+        queues.emplace_back(new WorkStealingDeque<int>());
+
+    atomic<long long> remaining((2LL << depth) - 1);
+    atomic<long long> total(0);
+    queues[0]->push(depth);
+
+    Clock::time_point start = Clock::now();
+    vector<thread> pool;
+    for (int w = 0; w < workers; ++w) {
+        pool.emplace_back([&, w]() {
+            unsigned int victimState = 2654435761u * (w + 1);
+            long long local = 0;
+            int task;
+            while (remaining.load(memory_order_relaxed) > 0) {
+                bool found = queues[w]->pop(task);
+                if (!found && workers > 1) {
+                    victimState = victimState * 1103515245u + 12345u;
+                    int victim = static_cast<int>((victimState >> 8) % workers);
+                    found = victim != w && queues[victim]->steal(task);
+                }
+                if (!found) continue;
+
+                if (task > 0) {
+                    queues[w]->push(task - 1);
+                    queues[w]->push(task - 1);
+                } else {
+                    unsigned int x = 12345u;
+                    for (int i = 0; i < 256; ++i)
+                        x = x * 1664525u + 1013904223u;
+                    local += x & 0xff;
+                }
+                remaining.fetch_sub(1, memory_order_relaxed);
+            }
+            total += local;
+        });
+    }
+    for (thread& worker : pool)
+        worker.join();
+
+    checksum += total.load();
+    return elapsedNs(start);
+}
+
+/**
+ * @brief Scaling of the work-stealing deque: the same task tree on 1, 2, 4, ...
+ *        workers up to the number of hardware threads.
+ */
+void benchStealScaling() {
+    const int depth = 20;
+    const long long tasks = (2LL << depth) - 1;
+    int maxWorkers = static_cast<int>(thread::hardware_concurrency());
+    if (maxWorkers < 1) maxWorkers = 1;
+
+    vector<int> workerCounts;
+    for (int w = 1; w < maxWorkers; w *= 2)
+        workerCounts.push_back(w);
+    workerCounts.push_back(maxWorkers);
+
+    cout << "[steal] binary task tree of " << tasks << " tasks, "
+         << maxWorkers << " hardware threads" << endl;
+    cout << "  " << setw(8) << "workers" << setw(14) << "Mtasks/s" << setw(12) << "speedup" << endl;
+
+    long long checksum = 0;
+    double baseline = 0;
+    for (size_t i = 0; i < workerCounts.size(); ++i) {
+        double ns = runTaskTree(workerCounts[i], depth, checksum);
+        double rate = tasks / ns * 1000.0;
+        if (i == 0) baseline = rate;
+        cout << "  " << setw(8) << workerCounts[i] << setw(14) << fixed << setprecision(2) << rate
+             << setw(11) << rate / baseline << "x" << endl;
+    }
+    cout << "  checksum: " << checksum << endl;
+}
+
+/**
+ * @brief The baseline the ring queues replace: an unbounded Deque behind a mutex.
+ */
+struct LockedDeque {
+    mutex lock;
+    Deque<int> dq;
+
+    bool try_push(int value) {
+        lock_guard<mutex> guard(lock);
+        dq.push_back(value);
+        return true;
+    }
+
+    bool try_pop(int& out) {
+        lock_guard<mutex> guard(lock);
+        if (dq.empty()) return false;
+        out = dq.front();
+        dq.pop_front();
+        return true;
+    }
+};
+
+/**
+ * @brief Streams items one at a time from a producer thread to a consumer thread.
+ * @param queue The queue under test.
+ * @param items Number of items to send.
+ * @param checksum Running checksum of the received items.
+ * @return Nanoseconds per item.
+ */
+template <typename Queue>
+static double pumpSingle(Queue& queue, int items, long long& checksum) {
+    Clock::time_point start = Clock::now();
+    thread producer([&]() {
+        for (int i = 0; i < items; ++i) {
+            int spins = 0;
+            while (!queue.try_push(i))
+                ringQueueBackoff(spins);
+        }
+    });
+
+    long long sum = 0;
+    for (int received = 0; received < items; ++received) {
+        int value;
+        int spins = 0;
+        while (!queue.try_pop(value))
+            ringQueueBackoff(spins);
+        sum += value;
+    }
+    producer.join();
+    checksum += sum;
+    return elapsedNs(start) / items;
+}
+
+/**
+ * @brief Streams items in batches from a producer thread to a consumer thread.
+ * @param queue The queue under test (needs try_push_n/try_pop_n).
+ * @param items Number of items to send.
+ * @param batch Items offered or requested per call.
+ * @param checksum Running checksum of the received items.
+ * @return Nanoseconds per item.
+ */
+template <typename Queue>
+static double pumpBatch(Queue& queue, int items, int batch, long long& checksum) {
+    Clock::time_point start = Clock::now();
+    thread producer([&]() {
+        vector<int> values(batch);
+        for (int sent = 0; sent < items;) {
+            int offered = min(batch, items - sent);
+            for (int i = 0; i < offered; ++i)
+                values[i] = sent + i;
+            int spins = 0;
+            size_t pushed;
+            while ((pushed = queue.try_push_n(values.data(), offered)) == 0)
+                ringQueueBackoff(spins);
+            sent += static_cast<int>(pushed);
+        }
+    });
+
+    vector<int> out(batch);
+    long long sum = 0;
+    for (int received = 0; received < items;) {
+        int spins = 0;
+        size_t popped;
+        while ((popped = queue.try_pop_n(out.data(), batch)) == 0)
+            ringQueueBackoff(spins);
+        for (size_t i = 0; i < popped; ++i)
+            sum += out[i];
+        received += static_cast<int>(popped);
+    }
+    producer.join();
+    checksum += sum;
+    return elapsedNs(start) / items;
+}
+
+/**
+ * @brief Ping-pongs a token between two threads through a pair of queues.
+ * @param there Queue from the main thread to the echo thread.
+ * @param back Queue from the echo thread back to the main thread.
+ * @param rounds Number of round trips.
+ * @return Nanoseconds per one-way hop (half the round trip).
+ */
+template <typename Queue>
+static double pingPong(Queue& there, Queue& back, int rounds) {
+    thread echo([&]() {
+        for (int r = 0; r < rounds; ++r) {
+            int value;
+            int spins = 0;
+            while (!there.try_pop(value))
+                ringQueueBackoff(spins);
+            while (!back.try_push(value + 1))
+                ringQueueBackoff(spins);
+        }
+    });
+
+    Clock::time_point start = Clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        int spins = 0;
+        while (!there.try_push(r))
+            ringQueueBackoff(spins);
+        int value;
+        while (!back.try_pop(value))
+            ringQueueBackoff(spins);
+    }
+    double ns = elapsedNs(start) / rounds / 2;
+    echo.join();
+    return ns;
+}
+
+/**
+ * @brief Producer/consumer throughput and ping-pong latency of the SPSC and MPMC
+ *        ring queues against a mutex-wrapped Deque.
+ */
+void benchRingQueues() {
+    const int items = 1 << 21;
+    const int rounds = 100000;
+    const int capacity = 4096;
+    const int batch = 64;
+    long long checksum = 0;
+
+    cout << "[ring] " << items << " ints producer -> consumer, capacity " << capacity
+         << "; " << rounds << " ping-pong rounds" << endl;
+    cout << "  " << setw(24) << left << "queue" << right << setw(16) << "ns/item"
+         << setw(18) << "one-way ns" << endl;
+
+    {
+        LockedDeque queue, there, back;
+        double single = pumpSingle(queue, items, checksum);
+        double latency = pingPong(there, back, rounds);
+        cout << "  " << setw(24) << left << "mutex + Deque" << right << fixed << setprecision(2)
+             << setw(16) << single << setw(18) << latency << endl;
+    }
+    {
+        SpscRingQueue<int> queue(capacity), there(capacity), back(capacity);
+        double single = pumpSingle(queue, items, checksum);
+        double batched = pumpBatch(queue, items, batch, checksum);
+        double latency = pingPong(there, back, rounds);
+        cout << "  " << setw(24) << left << "SpscRingQueue" << right
+             << setw(16) << single << setw(18) << latency << endl;
+        cout << "  " << setw(24) << left << "SpscRingQueue batch 64" << right
+             << setw(16) << batched << setw(18) << "-" << endl;
+    }
+    {
+        MpmcRingQueue<int> queue(capacity), there(capacity), back(capacity);
+        double single = pumpSingle(queue, items, checksum);
+        double batched = pumpBatch(queue, items, batch, checksum);
+        double latency = pingPong(there, back, rounds);
+        cout << "  " << setw(24) << left << "MpmcRingQueue" << right
+             << setw(16) << single << setw(18) << latency << endl;
+        cout << "  " << setw(24) << left << "MpmcRingQueue batch 64" << right
+             << setw(16) << batched << setw(18) << "-" << endl;
+    }
+    // Five streams (one through the mutex queue, two through each ring) of 0 .. items - 1
+    long long expected = 5 * (static_cast<long long>(items) * (items - 1) / 2);
+    cout << "  checksum: " << checksum << endl;
+    if (checksum != expected) {
+        cerr << "Ring queue checksum " << checksum << " differs from the expected " << expected << endl;
+        exit(1);
+    }
+}
+
+/**
+ * @brief Replays a list of middle edits (erase one element, reinsert it elsewhere)
+ *        on a container with insert()/erase().
+ * @param queue The container, already filled.
+ * @param edits (erase index, insert index) pairs.
+ * @param checksum Accumulates the moved values.
+ * @return Nanoseconds per edit.
+ */
+template <typename Queue>
+static double replayMiddleEdits(Queue& queue, const vector<pair<int, int>>& edits, long long& checksum) {
+    Clock::time_point start = Clock::now();
+    for (const pair<int, int>& edit : edits) {
+        int value = queue[edit.first];
+        queue.erase(queue.begin() + edit.first);
+        queue.insert(queue.begin() + edit.second, value);
+        checksum += value;
+    }
+    return elapsedNs(start) / edits.size();
+}
+
+/**
+ * @brief Cancels and reprioritises queue entries in the middle: Deque insert()/erase()
+ *        against std::deque and against rebuilding a std::vector for every edit.
+ */
+void benchMiddleEdits() {
+    const int sizes[] = {1000, 10000, 100000, 1000000};
+    const int editCount = 2000;
+    long long checksum = 0;
+
+    cout << "[middle] erase + reinsert at random positions in an int queue (ns/edit)" << endl;
+    cout << "  " << setw(10) << "size" << setw(14) << "Deque" << setw(14) << "std::deque"
+         << setw(16) << "vector rebuild" << endl;
+
+    for (int size : sizes) {
+        mt19937 rng(size);
+        vector<pair<int, int>> edits(editCount);
+        for (pair<int, int>& edit : edits)
+            edit = make_pair(static_cast<int>(rng() % size), static_cast<int>(rng() % size));
+
+        Deque<int> dq;
+        deque<int> stdDq;
+        for (int i = 0; i < size; ++i) {
+            dq.push_back(i);
+            stdDq.push_back(i);
+        }
+        double dequeNs = replayMiddleEdits(dq, edits, checksum);
+        double stdNs = replayMiddleEdits(stdDq, edits, checksum);
+
+        // The rebuild copies everything but the cancelled entry into a new vector, then
+        // copies again to put it back at its new priority; keep the total work bounded
+        int rebuilds = min(editCount, max(20, 20000000 / size));
+        vector<int> queue(size);
+        iota(queue.begin(), queue.end(), 0);
+        Clock::time_point start = Clock::now();
+        for (int e = 0; e < rebuilds; ++e) {
+            int value = queue[edits[e].first];
+            vector<int> without;
+            without.reserve(size);
+            without.insert(without.end(), queue.begin(), queue.begin() + edits[e].first);
+            without.insert(without.end(), queue.begin() + edits[e].first + 1, queue.end());
+            vector<int> rebuilt;
+            rebuilt.reserve(size);
+            rebuilt.insert(rebuilt.end(), without.begin(), without.begin() + edits[e].second);
+            rebuilt.push_back(value);
+            rebuilt.insert(rebuilt.end(), without.begin() + edits[e].second, without.end());
+            queue.swap(rebuilt);
+            checksum += value;
+        }
+        double rebuildNs = elapsedNs(start) / rebuilds;
+
+        cout << "  " << setw(10) << size << fixed << setprecision(1)
+             << setw(14) << dequeNs << setw(14) << stdNs << setw(16) << rebuildNs << endl;
+        if (!equal(dq.begin(), dq.end(), stdDq.begin()))
+            cout << "  MISMATCH between Deque and std::deque" << endl;
+    }
+    cout << "  checksum: " << checksum << endl;
+}
+
+/**
+ * @brief Fills a backlog far larger than the hot windows and drains it, FIFO and LIFO.
+ * @param queue The (empty) deque to fill.
+ * @param elements Number of elements to push.
+ * @param checksum Accumulates the popped values.
+ * @param fillNs Receives nanoseconds per push_back.
+ * @param fifoNs Receives nanoseconds per pop_front over the first half.
+ * @param lifoNs Receives nanoseconds per pop_back over the second half.
+ */
+template <typename Queue>
+static void fillAndDrain(Queue& queue, int elements, long long& checksum,
+                         double& fillNs, double& fifoNs, double& lifoNs) {
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < elements; ++i)
+        queue.push_back(i);
+    fillNs = elapsedNs(start) / elements;
+
+    start = Clock::now();
+    for (int i = 0; i < elements / 2; ++i) {
+        checksum += queue.front();
+        queue.pop_front();
+    }
+    fifoNs = elapsedNs(start) / (elements / 2);
+
+    start = Clock::now();
+    while (!queue.empty()) {
+        checksum += queue.back();
+        queue.pop_back();
+    }
+    lifoNs = elapsedNs(start) / (elements - elements / 2);
+}
+
+/**
+ * @brief Traffic-spike backlog: a SpillingDeque keeps a few hot blocks per end on the
+ *        heap and pages the rest to a backing file, against an all-in-memory Deque.
+ */
+void benchSpill() {
+    const int elements = 1 << 25;
+    const int hotBlocks = 8;
+    long long checksum = 0;
+    double fillNs, fifoNs, lifoNs;
+
+    cout << "[spill] " << elements << " ints pushed, then drained from the front and the back" << endl;
+    cout << "  " << setw(26) << left << "container" << right << setw(10) << "push ns" << setw(10)
+         << "fifo ns" << setw(10) << "lifo ns" << setw(16) << "block heap MiB" << endl;
+
+    {
+        Deque<int> dq;
+        fillAndDrain(dq, elements, checksum, fillNs, fifoNs, lifoNs);
+        double heapMiB = static_cast<double>(elements) * sizeof(int) / (1 << 20);
+        cout << "  " << setw(26) << left << "Deque" << right << fixed << setprecision(2)
+             << setw(10) << fillNs << setw(10) << fifoNs << setw(10) << lifoNs
+             << setw(16) << setprecision(1) << heapMiB << endl;
+    }
+    {
+        SpillingDeque<int> sdq(".", hotBlocks);
+        fillAndDrain(sdq, elements, checksum, fillNs, fifoNs, lifoNs);
+        double heapMiB = 2.0 * hotBlocks * SpillingDeque<int>::block_size() * sizeof(int) / (1 << 20);
+        cout << "  " << setw(26) << left << "SpillingDeque (8 hot/end)" << right << fixed << setprecision(2)
+             << setw(10) << fillNs << setw(10) << fifoNs << setw(10) << lifoNs
+             << setw(16) << setprecision(1) << heapMiB << endl;
+        cout << "  spills: " << sdq.block_spills() << ", loads: " << sdq.block_loads()
+             << ", backing file: " << sdq.backing_file_bytes() / (1 << 20) << " MiB" << endl;
+    }
+    cout << "  checksum: " << checksum << endl;
+}
+
+/**
+ * @brief Fills a deque, then reads it at pseudo-random indices through operator[].
+ * @param dq The (empty) deque to fill.
+ * @param elements Number of elements; a power of two.
+ * @param reads Number of random reads.
+ * @param checksum Accumulates the values read.
+ * @param fillNs Receives nanoseconds per push_back.
+ * @return Nanoseconds per random read.
+ */
+template <typename Queue>
+static double fillAndProbe(Queue& dq, int elements, int reads, long long& checksum, double& fillNs) {
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < elements; ++i)
+        dq.push_back(i);
+    fillNs = elapsedNs(start) / elements;
+
+    // xorshift indices, so no index array competes for the TLB
+    unsigned x = 2463534242u;
+    start = Clock::now();
+    for (int r = 0; r < reads; ++r) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        checksum += dq[static_cast<int>(x & (elements - 1))];
+    }
+    return elapsedNs(start) / reads;
+}
+
+/**
+ * @brief Reads the first line of a file that starts with a prefix (for /proc and /sys).
+ * @param path The file to read.
+ * @param prefix Line prefix to look for; empty matches the first line.
+ * @return The line, or "unavailable".
+ */
+static string readKernelLine(const char* path, const string& prefix) {
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        if (line.compare(0, prefix.size(), prefix) == 0) return line;
+    }
+    return "unavailable";
+}
+
+/**
+ * @brief TLB-heavy random operator[] over a 128 MiB deque whose blocks come from the
+ *        global heap, an ArenaResource, or an ArenaResource over HugePageResource.
+ */
+void benchTlb() {
+    typedef Deque<int, BlockBytes<int>::value, pmr::polymorphic_allocator<int>> PmrDeque;
+    const int elements = 1 << 25;
+    const int reads = 1 << 24;
+    long long checksum = 0;
+    double fillNs, readNs;
+
+    cout << "[tlb] " << elements << " ints (" << (elements * sizeof(int) >> 20) << " MiB), "
+         << reads << " random operator[] reads" << endl;
+    cout << "  transparent huge pages: "
+         << readKernelLine("/sys/kernel/mm/transparent_hugepage/enabled", "") << endl;
+    cout << "  " << setw(24) << left << "block storage" << right
+         << setw(10) << "fill ns" << setw(10) << "read ns" << endl;
+
+    {
+        Deque<int> dq;
+        readNs = fillAndProbe(dq, elements, reads, checksum, fillNs);
+        cout << "  " << setw(24) << left << "heap (std::allocator)" << right << fixed << setprecision(2)
+             << setw(10) << fillNs << setw(10) << readNs << endl;
+    }
+    {
+        ArenaResource arena(32 << 20);
+        PmrDeque dq(&arena);
+        readNs = fillAndProbe(dq, elements, reads, checksum, fillNs);
+        cout << "  " << setw(24) << left << "ArenaResource" << right << fixed << setprecision(2)
+             << setw(10) << fillNs << setw(10) << readNs << endl;
+    }
+    {
+        HugePageResource hugePages;
+        ArenaResource arena(32 << 20, &hugePages);
+        PmrDeque dq(&arena);
+        readNs = fillAndProbe(dq, elements, reads, checksum, fillNs);
+        string anonHuge = readKernelLine("/proc/self/smaps_rollup", "AnonHugePages:");
+        cout << "  " << setw(24) << left << "Arena over huge pages" << right << fixed << setprecision(2)
+             << setw(10) << fillNs << setw(10) << readNs << endl;
+        cout << "  huge-page mappings: " << (hugePages.explicit_bytes() >> 20) << " MiB explicit, "
+             << (hugePages.transparent_bytes() >> 20) << " MiB transparent; " << anonHuge << endl;
+    }
+    cout << "  checksum: " << checksum << endl;
+}
+
+/**
+ * @brief Times the best of a few runs of a parallel algorithm.
+ * @param run Runs the algorithm once.
+ * @return Milliseconds for the fastest run.
+ */
+template <typename F>
+static double bestOfMs(F run) {
+    const int repeats = 5;
+    double best = 0;
+    for (int r = 0; r < repeats; ++r) {
+        Clock::time_point start = Clock::now();
+        run();
+        double ms = elapsedNs(start) / 1e6;
+        if (r == 0 || ms < best) best = ms;
+    }
+    return best;
+}
+
+/**
+ * @brief Scaling of parallel_for_each/reduce/transform/find over a 64 MiB deque from
+ *        1 to N threads, against the serial loop over for_each_segment().
+ */
+void benchParallel() {
+    const int elements = 1 << 24;
+    int maxThreads = ParallelPool::hardwareThreads();
+
+    vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    Deque<int> dq;
+    Deque<int> out;
+    for (int i = 0; i < elements; ++i) {
+        dq.push_back(i & 0xffff);
+        out.push_back(0);
+    }
+    // Past every element, so find scans the whole deque
+    const int missing = -1;
+    long long checksum = 0;
+
+    cout << "[parallel] " << elements << " ints, " << maxThreads << " hardware threads" << endl;
+    cout << "  " << setw(8) << "threads" << setw(12) << "for_each ms" << setw(12) << "reduce ms"
+         << setw(14) << "transform ms" << setw(10) << "find ms" << setw(12) << "speedup" << endl;
+
+    auto printRow = [](const string& label, double forEachMs, double reduceMs, double transformMs,
+                       double findMs, double speedup) {
+        cout << "  " << setw(8) << label << fixed << setprecision(2) << setw(12) << forEachMs
+             << setw(12) << reduceMs << setw(14) << transformMs << setw(10) << findMs
+             << setw(11) << speedup << "x" << endl;
+    };
+
+    // Serial baseline over the same segments
+    double serialForEach = bestOfMs([&] {
+        dq.for_each_segment([](int* data, int len) {
+            for (int i = 0; i < len; ++i)
+                data[i] = data[i] * 3 + 1;
+        });
+    });
+    double serialReduce = bestOfMs([&] {
+        long long sum = 0;
+        dq.for_each_segment([&sum](const int* data, int len) {
+            for (int i = 0; i < len; ++i)
+                sum += data[i];
+        });
+        checksum += sum;
+    });
+    double serialTransform = bestOfMs([&] {
+        transform(dq.cbegin(), dq.cend(), out.begin(), [](int x) { return x ^ (x >> 3); });
+    });
+    double serialFind = bestOfMs([&] {
+        checksum += find(dq.cbegin(), dq.cend(), missing) - dq.cbegin();
+    });
+    double serialTotal = serialForEach + serialReduce + serialTransform + serialFind;
+    printRow("serial", serialForEach, serialReduce, serialTransform, serialFind, 1.0);
+
+    for (size_t i = 0; i < threadCounts.size(); ++i) {
+        ParallelPool pool(threadCounts[i]);
+        double forEachMs = bestOfMs([&] {
+            parallel_for_each(dq, [](int& x) { x = x * 3 + 1; }, pool);
+        });
+        double reduceMs = bestOfMs([&] {
+            checksum += parallel_reduce(dq, 0LL, plus<long long>(), pool);
+        });
+        double transformMs = bestOfMs([&] {
+            parallel_transform(dq, out, [](int x) { return x ^ (x >> 3); }, pool);
+        });
+        double findMs = bestOfMs([&] {
+            checksum += parallel_find(dq, missing, pool) - dq.begin();
+        });
+        double total = forEachMs + reduceMs + transformMs + findMs;
+        printRow(to_string(threadCounts[i]), forEachMs, reduceMs, transformMs, findMs, serialTotal / total);
+    }
+    cout << "  speedup: serial total over parallel total of the four algorithms" << endl;
+    cout << "  checksum: " << checksum + out[elements / 2] << endl;
+}
+
+/**
+ * @brief A named benchmark the driver can run.
+ */
+struct Benchmark {
+    const char* name;
+    void (*run)();
+    const char* description;
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"fifo", benchFifoBlockmap, "constant-size FIFO; blockmap footprint over time"},
+    {"bulk", benchBulk, "bulk append/prepend/pop_n/copy_out vs single-element loops"},
+    {"iterate", benchIterate, "sum via operator[], iterators, accumulate and segments"},
+    {"blocks", benchBlockSweep, "block byte budget sweep: push/pop and random access"},
+    {"steal", benchStealScaling, "work-stealing task tree scaling from 1 to N workers"},
+    {"ring", benchRingQueues, "SPSC/MPMC ring queues vs mutex + Deque: throughput, latency"},
+    {"middle", benchMiddleEdits, "insert/erase in the middle vs std::deque and vector rebuild"},
+    {"spill", benchSpill, "SpillingDeque backlog paged to a file vs in-memory Deque"},
+    {"tlb", benchTlb, "random operator[] with heap, arena and huge-page block storage"},
+    {"parallel", benchParallel, "parallel for_each/reduce/transform/find scaling from 1 to N threads"},
+};
+
+int main(int argc, char* argv[]) {
+    const int benchmarkCount = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+    if (argc == 1) {
+        for (int i = 0; i < benchmarkCount; ++i)
+            BENCHMARKS[i].run();
+        return 0;
+    }
+
+    for (int a = 1; a < argc; ++a) {
+        bool found = false;
+        for (int i = 0; i < benchmarkCount; ++i) {
+            if (strcmp(argv[a], BENCHMARKS[i].name) == 0) {
+                BENCHMARKS[i].run();
+                found = true;
+            }
+        }
+        if (!found) {
+            cerr << "Unknown benchmark: " << argv[a] << "\nAvailable benchmarks:\n";
+            for (int i = 0; i < benchmarkCount; ++i)
+                cerr << "  " << setw(10) << left << BENCHMARKS[i].name << BENCHMARKS[i].description << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
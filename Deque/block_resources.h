@@ -0,0 +1,263 @@
+/**
+ * @file block_resources.h
+ * @author Odin's Ravens
+ * @date April 25, 2025
+ * @brief Header-only std::pmr memory resources for Deque block storage.
+ *
+ * ArenaResource carves allocations out of large chunks and recycles freed blocks by
+ * size, so a deque's blocks sit next to each other and never go back to the heap
+ * until the arena is destroyed. HugePageResource maps memory in 2 MiB huge pages; use
+ * it as the arena's upstream so each huge page holds hundreds of blocks and random
+ * access across a large deque needs far fewer TLB entries:
+ *
+ *     HugePageResource hugePages;
+ *     ArenaResource arena(32 << 20, &hugePages);
+ *     Deque<int, 1024, std::pmr::polymorphic_allocator<int>> dq(&arena);
+ *
+ * Course: CSCI 325 — Data Structures and Algorithms
+ */
+
+#ifndef BLOCK_RESOURCES_H
+#define BLOCK_RESOURCES_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+
+/**
+ * @class ArenaResource
+ * @brief A chunked arena that recycles freed allocations of the same size and alignment.
+ *
+ * Allocation bumps a pointer through the current chunk; deallocation pushes the memory
+ * onto a free list for its (size, alignment), and the next request of that shape pops
+ * it. Chunks are only returned to the upstream resource when the arena is destroyed.
+ * Not thread-safe; give each thread its own arena.
+ */
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    /**
+     * @brief Constructs an empty arena.
+     * @param chunkBytes Size of each chunk requested from upstream.
+     * @param upstream Resource the chunks come from.
+     */
+    explicit ArenaResource(std::size_t chunkBytes = 1 << 20,
+                           std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : chunkBytes(chunkBytes), upstream(upstream), cursor(nullptr), limit(nullptr), reserved(0) {}
+
+    /**
+     * @brief Destructor. Returns every chunk to the upstream resource.
+     */
+    ~ArenaResource() override {
+        for (const Chunk& chunk : chunks)
+            upstream->deallocate(chunk.memory, chunk.bytes, chunk.align);
+    }
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    /**
+     * @brief Gets the total size of the chunks taken from upstream.
+     * @return Bytes reserved by the arena.
+     */
+    std::size_t bytes_reserved() const { return reserved; }
+
+    /**
+     * @brief Gets the number of chunks taken from upstream.
+     * @return The chunk count.
+     */
+    std::size_t chunk_count() const { return chunks.size(); }
+
+private:
+    /**
+     * @struct Chunk
+     * @brief One allocation from upstream, remembered so it can be given back.
+     */
+    struct Chunk {
+        void* memory;
+        std::size_t bytes;
+        std::size_t align;
+    };
+
+    /**
+     * @struct FreeList
+     * @brief Freed allocations of one size and alignment; the link lives in the memory.
+     */
+    struct FreeList {
+        std::size_t bytes;
+        std::size_t align;
+        void* head;
+    };
+
+    std::size_t chunkBytes;
+    std::pmr::memory_resource* upstream;
+    std::vector<Chunk> chunks;
+    std::vector<FreeList> freeLists;
+
+    // Unused part of the current chunk
+    char* cursor;
+    char* limit;
+
+    std::size_t reserved;
+
+    /**
+     * @brief Finds the free list for a size and alignment.
+     * @return The list, or nullptr if nothing of that shape was ever freed.
+     */
+    FreeList* findFreeList(std::size_t bytes, std::size_t align) {
+        for (FreeList& list : freeLists) {
+            if (list.bytes == bytes && list.align == align) return &list;
+        }
+        return nullptr;
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        FreeList* list = findFreeList(bytes, align);
+        if (list != nullptr && list->head != nullptr) {
+            void* p = list->head;
+            list->head = *static_cast<void**>(p);
+            return p;
+        }
+
+        std::uintptr_t start = (reinterpret_cast<std::uintptr_t>(cursor) + align - 1) & ~(align - 1);
+        if (cursor == nullptr || start + bytes > reinterpret_cast<std::uintptr_t>(limit)) {
+            // Start a new chunk; the tail of the old one is abandoned
+            std::size_t chunkAlign = align > alignof(std::max_align_t) ? align : alignof(std::max_align_t);
+            std::size_t size = bytes + align > chunkBytes ? bytes + align : chunkBytes;
+            void* memory = upstream->allocate(size, chunkAlign);
+            chunks.push_back(Chunk{memory, size, chunkAlign});
+            reserved += size;
+            cursor = static_cast<char*>(memory);
+            limit = cursor + size;
+            start = (reinterpret_cast<std::uintptr_t>(cursor) + align - 1) & ~(align - 1);
+        }
+        cursor = reinterpret_cast<char*>(start + bytes);
+        return reinterpret_cast<void*>(start);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        // Too small to hold the free-list link: the memory stays with the arena unused
+        if (bytes < sizeof(void*)) return;
+
+        FreeList* list = findFreeList(bytes, align);
+        if (list == nullptr) {
+            freeLists.push_back(FreeList{bytes, align, nullptr});
+            list = &freeLists.back();
+        }
+        *static_cast<void**>(p) = list->head;
+        list->head = p;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+/**
+ * @class HugePageResource
+ * @brief Maps each allocation as its own run of 2 MiB huge pages.
+ *
+ * Explicit huge pages (MAP_HUGETLB) are tried first; they need pages reserved in
+ * /proc/sys/vm/nr_hugepages. Otherwise the memory is mapped 2 MiB-aligned and marked
+ * for transparent huge pages (MADV_HUGEPAGE), which the kernel backs with huge pages
+ * when it can. Every allocation is rounded up to whole huge pages, so this is meant as
+ * the upstream of an ArenaResource rather than for individual blocks.
+ */
+class HugePageResource : public std::pmr::memory_resource {
+public:
+    // Size of one huge page on x86-64 and most ARM64 kernels
+    static const std::size_t HUGE_PAGE_BYTES = std::size_t(2) << 20;
+
+    /**
+     * @brief Constructs the resource.
+     * @param tryExplicit Whether to try MAP_HUGETLB before transparent huge pages.
+     */
+    explicit HugePageResource(bool tryExplicit = true)
+        : tryExplicit(tryExplicit), explicitBytes(0), transparentBytes(0) {}
+
+    HugePageResource(const HugePageResource&) = delete;
+    HugePageResource& operator=(const HugePageResource&) = delete;
+
+    /**
+     * @brief Gets the bytes currently mapped from reserved (MAP_HUGETLB) huge pages.
+     * @return Explicit huge-page bytes.
+     */
+    std::size_t explicit_bytes() const { return explicitBytes; }
+
+    /**
+     * @brief Gets the bytes currently mapped as transparent-huge-page candidates.
+     * @return Transparent huge-page bytes.
+     */
+    std::size_t transparent_bytes() const { return transparentBytes; }
+
+private:
+    bool tryExplicit;
+    std::size_t explicitBytes;
+    std::size_t transparentBytes;
+
+    // Mappings made with MAP_HUGETLB, so deallocation can tell the two kinds apart
+    std::vector<void*> explicitMappings;
+
+    static std::size_t roundUp(std::size_t bytes) {
+        return (bytes + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        assert(align <= HUGE_PAGE_BYTES && "HugePageResource cannot align past a huge page");
+        (void)align;
+        std::size_t length = roundUp(bytes);
+
+#ifdef MAP_HUGETLB
+        if (tryExplicit) {
+            void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                explicitMappings.push_back(p);
+                explicitBytes += length;
+                return p;
+            }
+        }
+#endif
+
+        // Over-map by one huge page, then trim both ends to a 2 MiB boundary
+        void* raw = mmap(nullptr, length + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        char* rawStart = static_cast<char*>(raw);
+        char* start = reinterpret_cast<char*>(
+            (reinterpret_cast<std::uintptr_t>(rawStart) + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1));
+        if (start > rawStart) munmap(rawStart, start - rawStart);
+        char* end = start + length;
+        char* rawEnd = rawStart + length + HUGE_PAGE_BYTES;
+        if (rawEnd > end) munmap(end, rawEnd - end);
+
+#ifdef MADV_HUGEPAGE
+        madvise(start, length, MADV_HUGEPAGE);
+#endif
+        transparentBytes += length;
+        return start;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t) override {
+        std::size_t length = roundUp(bytes);
+        munmap(p, length);
+        for (std::size_t i = 0; i < explicitMappings.size(); ++i) {
+            if (explicitMappings[i] == p) {
+                explicitMappings[i] = explicitMappings.back();
+                explicitMappings.pop_back();
+                explicitBytes -= length;
+                return;
+            }
+        }
+        transparentBytes -= length;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+#endif
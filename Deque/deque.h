@@ -1,130 +1,1801 @@
-/**
- * @file deque.h
- * @author Odin's Ravens
- * @date April 25, 2025
- * @brief Header file for the Deque class.
- * 
- * This file contains the class definition for a custom Deque (double-ended queue)
- * implemented using a dynamic double array (2D array) called blockmap.
- * This class supports efficient push and pop operations from both ends,
- * indexed access via operator[], and dynamic resizing as needed.
- * 
- * Course: CSCI 325 — Data Structures and Algorithms
- */
-
-#ifndef DEQUE_H
-#define DEQUE_H
-
-/**
- * @class Deque
- * @brief A double-ended queue (deque) implemented using a dynamic double array.
- * 
- * Supports push/pop from both front and back, indexed access, and dynamic resizing.
- */
-class Deque {
-private:
-    // Number of elements per block in the blockmap
-    static const int BLOCK_SIZE = 64;
-
-    // Pointer to a dynamic array of integer pointers (2D array)
-    int** blockmap;
-
-    // Number of blocks that the blockmap can currently hold
-    int blockmapCapacity;
-
-    // Index of the block where the front element is located
-    int frontBlock;
-
-    // Index of the block where the back element is located
-    int backBlock;
-
-    // Index within the front block where the front element starts
-    int frontIndex;
-
-    // Index within the back block where the back element ends
-    int backIndex;
-
-    // Total number of elements in the deque
-    int count;
-
-    /**
-     * @brief Grows the deque from the front by allocating a new block if needed.
-     */
-    void growFront();
-
-    /**
-     * @brief Grows the deque from the back by allocating a new block if needed.
-     */
-    void growBack();
-
-    /**
-     * @brief Resizes the blockmap if more blocks are needed (front or back).
-     */
-    void resizeBlockmap();
-
-public:
-    /**
-     * @brief Constructs an empty deque.
-     */
-    Deque();
-
-    /**
-     * @brief Destructor. Frees all dynamically allocated memory.
-     */
-    ~Deque();
-
-    /**
-     * @brief Adds an element to the front of the deque.
-     * @param value The integer value to add.
-     */
-    void push_front(int value);
-
-    /**
-     * @brief Adds an element to the back of the deque.
-     * @param value The integer value to add.
-     */
-    void push_back(int value);
-
-    /**
-     * @brief Removes the front element from the deque.
-     */
-    void pop_front();
-
-    /**
-     * @brief Removes the back element from the deque.
-     */
-    void pop_back();
-
-    /**
-     * @brief Gets a copy of the front element.
-     * @return The value at the front of the deque.
-     */
-    int front() const;
-
-    /**
-     * @brief Gets a copy of the back element.
-     * @return The value at the back of the deque.
-     */
-    int back() const;
-
-    /**
-     * @brief Checks whether the deque is empty.
-     * @return True if the deque is empty; false otherwise.
-     */
-    bool empty() const;
-
-    /**
-     * @brief Gets the current number of elements in the deque.
-     * @return The number of stored elements.
-     */
-    int size() const;
-
-    /**
-     * @brief Accesses the element at a specific index.
-     * @param index Index of the element (0-based).
-     * @return Reference to the element at that index.
-     */
-    int& operator[](int index);
-};
-
-#endif
+/**
+ * @file deque.h
+ * @author Odin's Ravens
+ * @date April 25, 2025
+ * @brief Header-only class template for the Deque container.
+ *
+ * This file contains the class template definition for a custom Deque (double-ended queue)
+ * implemented using a dynamic double array (2D array) called blockmap.
+ * This class supports efficient push and pop operations from both ends,
+ * indexed access via operator[], and dynamic resizing as needed.
+ *
+ * Blocks are raw, uninitialized storage: elements are constructed in place when
+ * they are pushed or emplaced and destroyed when they are popped, so element types
+ * never need to be default-constructible or copyable.
+ *
+ * Blocks emptied by a pop are kept on a small spare list (up to a configurable
+ * high-water mark) and handed back out by the next push that crosses a block
+ * boundary, so a steady-state queue does not touch the heap for block storage.
+ *
+ * Moving a deque, swapping two deques, and splicing one onto either end of another
+ * hand over whole blocks by moving blockmap pointers instead of touching elements.
+ *
+ * Block sizes are powers of two chosen at compile time from a byte budget (see
+ * BlockBytes), so locating an element takes a shift and a mask instead of a division.
+ *
+ * Iterators are STL random-access iterators, so the standard algorithms and range-for
+ * work. Hot loops should prefer for_each_segment(), which hands out each block's
+ * elements as one contiguous (pointer, length) span the compiler can vectorize.
+ *
+ * Blocks and the blockmap come from an STL allocator, rebound to a block-sized,
+ * cache-aligned storage type. std::pmr::polymorphic_allocator works, so blocks can
+ * live in any std::pmr::memory_resource (see block_resources.h for an arena and a
+ * huge-page resource). Allocators propagate on copy, move and swap as they do for
+ * the standard containers; blocks only change hands between deques whose allocators
+ * compare equal, and are moved element-wise otherwise.
+ *
+ * stats() reports the memory footprint at any time; building with DEQUE_STATS=1 adds
+ * per-operation and blockmap resize counters (see deque_stats.h).
+ *
+ * Course: CSCI 325 — Data Structures and Algorithms
+ */
+
+#ifndef DEQUE_H
+#define DEQUE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "deque_stats.h"
+
+// Default byte budget for one block (override with -DDEQUE_BLOCK_BYTES=<power of two>)
+#ifndef DEQUE_BLOCK_BYTES
+#define DEQUE_BLOCK_BYTES 4096
+#endif
+
+// Blocks are aligned to at least a cache line so they never share one with other data
+#define DEQUE_CACHE_LINE 64
+
+/**
+ * @brief Computes the base-2 logarithm of a power of two at compile time.
+ * @param n A power of two.
+ * @return log2(n).
+ */
+constexpr int dequeLog2(int n) {
+    return n <= 1 ? 0 : 1 + dequeLog2(n / 2);
+}
+
+/**
+ * @struct BlockBytes
+ * @brief Block sizing policy: how many elements of type T fill a block of Bytes bytes.
+ *
+ * The count is rounded down to a power of two and never drops below MinElements, so
+ * large element types still get useful blocks. Pass it as the Deque's BlockSize to
+ * pick a per-type policy, e.g. Deque<Packet, BlockBytes<Packet, 16384>::value>.
+ *
+ * @tparam T The element type.
+ * @tparam Bytes Byte budget for one block; must be a power of two.
+ * @tparam MinElements Smallest allowed number of elements per block.
+ */
+template <typename T, std::size_t Bytes = DEQUE_BLOCK_BYTES, int MinElements = 16>
+struct BlockBytes {
+    static_assert(Bytes > 0 && (Bytes & (Bytes - 1)) == 0, "BlockBytes budget must be a power of two");
+
+    static constexpr int fitting = static_cast<int>(Bytes / sizeof(T)) > 0
+                                       ? static_cast<int>(Bytes / sizeof(T)) : 1;
+    static constexpr int rounded = 1 << dequeLog2(fitting);
+    static constexpr int value = rounded > MinElements ? rounded : MinElements;
+};
+
+/**
+ * @class Deque
+ * @brief A double-ended queue (deque) implemented using a dynamic double array.
+ *
+ * Supports push/pop from both front and back, indexed access, and dynamic resizing.
+ *
+ * @tparam T The element type.
+ * @tparam BlockSize Number of elements per block in the blockmap; must be a power of
+ *         two. Defaults to as many elements as fit in DEQUE_BLOCK_BYTES.
+ * @tparam Allocator STL allocator for blocks and the blockmap (for example
+ *         std::pmr::polymorphic_allocator<T>).
+ */
+template <typename T, int BlockSize = BlockBytes<T>::value, typename Allocator = std::allocator<T>>
+class Deque {
+    static_assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0,
+                  "Deque BlockSize must be a power of two");
+
+private:
+    // Number of elements per block in the blockmap
+    static const int BLOCK_SIZE = BlockSize;
+
+    // Shift and mask that split a slot position into block and index within the block
+    static const int BLOCK_SHIFT = dequeLog2(BlockSize);
+    static const int BLOCK_MASK = BlockSize - 1;
+
+    // Bytes and alignment of one block; a spare block must also fit a list link
+    static constexpr std::size_t BLOCK_BYTES =
+        sizeof(T) * BLOCK_SIZE > sizeof(T*) ? sizeof(T) * BLOCK_SIZE : sizeof(T*);
+    static constexpr std::size_t BLOCK_ALIGN =
+        alignof(T) > DEQUE_CACHE_LINE ? alignof(T) : DEQUE_CACHE_LINE;
+
+    /**
+     * @struct BlockStorage
+     * @brief Raw storage for one block, so the allocator sees its size and alignment.
+     */
+    struct alignas(BLOCK_ALIGN) BlockStorage {
+        unsigned char bytes[BLOCK_BYTES];
+    };
+
+    typedef std::allocator_traits<Allocator> AllocTraits;
+    typedef typename AllocTraits::template rebind_alloc<BlockStorage> BlockAllocator;
+    typedef typename AllocTraits::template rebind_alloc<T*> MapAllocator;
+
+    // Default number of empty blocks kept for reuse instead of being freed
+    static const int DEFAULT_SPARE_LIMIT = 2;
+
+    // Number of block pointers in a new deque's blockmap
+    static const int INITIAL_BLOCKMAP_CAPACITY = 8;
+
+    // Pointer to a dynamic array of block pointers (2D array)
+    T** blockmap;
+
+    // Number of blocks that the blockmap can currently hold
+    int blockmapCapacity;
+
+    // Index of the block where the front element is located
+    int frontBlock;
+
+    // Index within the front block where the front element starts
+    int frontIndex;
+
+    // Total number of elements in the deque
+    int count;
+
+    // Singly linked list of empty blocks kept for reuse (link stored in the block itself)
+    T* spareList;
+
+    // Number of blocks currently on the spare list
+    int spareCount;
+
+    // High-water mark: most spare blocks kept before they are returned to the heap
+    int spareLimit;
+
+    // Number of blocks obtained from and returned to the allocator
+    std::size_t blockAllocs;
+    std::size_t blockFrees;
+
+    // Allocator for blocks; the blockmap uses a copy rebound to T*
+    BlockAllocator blockAllocator;
+
+#if DEQUE_STATS
+    // Operation and resize counters; they describe this object, so they are never
+    // swapped or moved along with the elements
+    DequeCounters counters;
+#endif
+
+    /**
+     * @brief Allocates one block of uninitialized element storage.
+     * @return Pointer to storage for BLOCK_SIZE elements.
+     */
+    T* allocateBlock();
+
+    /**
+     * @brief Releases a block obtained from allocateBlock().
+     * @param block The block to free. No elements may be alive in it.
+     */
+    void freeBlock(T* block);
+
+    /**
+     * @brief Allocates a blockmap with every entry set to nullptr.
+     * @param capacity Number of block pointers.
+     * @return The new blockmap.
+     */
+    T** allocateBlockmap(int capacity);
+
+    /**
+     * @brief Releases a blockmap obtained from allocateBlockmap().
+     * @param map The blockmap to free (may be nullptr).
+     * @param capacity Number of block pointers it was allocated with.
+     */
+    void freeBlockmap(T** map, int capacity);
+
+    /**
+     * @brief Constructs an element in front of the current front (emplace_front() without
+     *        the op counter, for internal use).
+     * @param args Arguments forwarded to the element constructor.
+     * @return Reference to the new front element.
+     */
+    template <typename... Args>
+    T& constructFront(Args&&... args);
+
+    /**
+     * @brief Constructs an element after the current back (emplace_back() without the
+     *        op counter, for internal use).
+     * @param args Arguments forwarded to the element constructor.
+     * @return Reference to the new back element.
+     */
+    template <typename... Args>
+    T& constructBack(Args&&... args);
+
+    /**
+     * @brief Copies n elements onto the back, one block at a time (append() without the
+     *        op counter).
+     * @param values First element to copy.
+     * @param n Number of elements.
+     */
+    void copyBack(const T* values, int n);
+
+    /**
+     * @brief Destroys the first n elements (pop_front_n() without the op counter).
+     * @param n Number of elements (at most size()).
+     */
+    void destroyFront(int n);
+
+    /**
+     * @brief Destroys the last n elements (pop_back_n() without the op counter).
+     * @param n Number of elements (at most size()).
+     */
+    void destroyBack(int n);
+
+    /**
+     * @brief Exchanges everything but the allocators with another deque.
+     * @param other The deque to swap with.
+     */
+    void swapContents(Deque& other) noexcept;
+
+    /**
+     * @brief Gets a block from the spare list, or from the heap if the list is empty.
+     * @return Pointer to storage for BLOCK_SIZE elements.
+     */
+    T* acquireBlock();
+
+    /**
+     * @brief Returns an empty block to the spare list, or to the heap if the list is full.
+     * @param block The block to release. No elements may be alive in it.
+     */
+    void releaseBlock(T* block);
+
+    /**
+     * @brief Frees spare blocks until at most limit remain on the spare list.
+     * @param limit Number of spare blocks to keep.
+     */
+    void trimSpares(int limit);
+
+    /**
+     * @brief Accesses the list link stored inside a spare block.
+     * @param block A block on (or being put on) the spare list.
+     * @return Reference to the block's next-spare pointer.
+     */
+    static T*& nextSpare(T* block);
+
+    /**
+     * @brief Makes room for one element before the front, allocating a new block if needed.
+     * @return Address of the uninitialized slot in front of the current front element.
+     */
+    T* growFront();
+
+    /**
+     * @brief Makes room for one element after the back, allocating a new block if needed.
+     * @return Address of the uninitialized slot just past the current back element.
+     */
+    T* growBack();
+
+    /**
+     * @brief Makes room in the blockmap when a push reaches either end of it.
+     *
+     * Recenters the blocks in place when the map is at most half full, and
+     * only grows its capacity (doubling) when it is actually running out of room.
+     *
+     * @param extraBlocks Number of blocks the caller is about to add on one side.
+     */
+    void resizeBlockmap(int extraBlocks);
+
+    /**
+     * @brief Allocates every block needed to add n elements after the back.
+     * @param n Number of elements about to be appended.
+     */
+    void reserveBack(int n);
+
+    /**
+     * @brief Allocates every block needed to add n elements before the front.
+     * @param n Number of elements about to be prepended.
+     */
+    void reserveFront(int n);
+
+    /**
+     * @brief Forgets n elements at the front whose objects are already gone, freeing
+     *        the front block if it empties. The n elements must lie in the front block.
+     * @param n Number of elements to drop.
+     */
+    void releaseFront(int n);
+
+    /**
+     * @brief Forgets n elements at the back whose objects are already gone, freeing
+     *        the back block if it empties. The n elements must lie in the back block.
+     * @param n Number of elements to drop.
+     */
+    void releaseBack(int n);
+
+    /**
+     * @brief Moves every element of src onto the back of this deque, one block-sized
+     *        chunk at a time, leaving src empty.
+     * @param src The deque to take elements from.
+     */
+    void relocateBackFrom(Deque& src);
+
+    /**
+     * @brief Moves every element of src onto the front of this deque, one block-sized
+     *        chunk at a time, leaving src empty.
+     * @param src The deque to take elements from.
+     */
+    void relocateFrontFrom(Deque& src);
+
+    /**
+     * @brief Moves n elements into uninitialized storage and destroys the originals
+     *        (memcpy for trivially copyable types).
+     * @param src First source element.
+     * @param n Number of elements.
+     * @param dst First uninitialized destination slot.
+     */
+    static void relocateRange(T* src, int n, T* dst);
+
+    /**
+     * @brief Copy-constructs n elements into uninitialized storage (memcpy for
+     *        trivially copyable types).
+     * @param src First source element.
+     * @param n Number of elements.
+     * @param dst First uninitialized destination slot.
+     */
+    static void constructRange(const T* src, int n, T* dst);
+
+    /**
+     * @brief Destroys n contiguous elements (a no-op for trivially destructible types).
+     * @param first First element to destroy.
+     * @param n Number of elements.
+     */
+    static void destroyRange(T* first, int n);
+
+    /**
+     * @brief Move-assigns n live elements from logical index from to index to, one
+     *        block-sized chunk at a time (memmove for trivially copyable types).
+     *        Ranges may overlap; every destination slot must hold a live element.
+     * @param from Index of the first element to move.
+     * @param to Index the first element moves to.
+     * @param n Number of elements.
+     */
+    void shiftRange(int from, int to, int n);
+
+    /**
+     * @brief Computes the address of the element at a logical index.
+     * @param index Index of the element (0-based, may be one past the end).
+     * @return Pointer to the slot for that index.
+     */
+    T* slot(int index) const;
+
+public:
+    /**
+     * @class Iterator
+     * @brief STL random-access iterator over a Deque.
+     *
+     * Holds the blockmap and an absolute slot position, so it stays cheap to copy and
+     * compare. Like std::deque iterators, it is invalidated by any push or pop.
+     *
+     * @tparam IsConst True for const_iterator, false for iterator.
+     */
+    template <bool IsConst>
+    class Iterator {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<IsConst, const T*, T*>::type pointer;
+        typedef typename std::conditional<IsConst, const T&, T&>::type reference;
+
+        Iterator() : map(nullptr), pos(0) {}
+
+        // An iterator converts to a const_iterator, but not the other way round
+        template <bool WasConst, typename = typename std::enable_if<IsConst && !WasConst>::type>
+        Iterator(const Iterator<WasConst>& other) : map(other.map), pos(other.pos) {}
+
+        reference operator*() const { return map[pos >> BLOCK_SHIFT][pos & BLOCK_MASK]; }
+        pointer operator->() const { return &**this; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        Iterator& operator++() { ++pos; return *this; }
+        Iterator operator++(int) { Iterator old = *this; ++pos; return old; }
+        Iterator& operator--() { --pos; return *this; }
+        Iterator operator--(int) { Iterator old = *this; --pos; return old; }
+
+        Iterator& operator+=(difference_type n) { pos += static_cast<int>(n); return *this; }
+        Iterator& operator-=(difference_type n) { pos -= static_cast<int>(n); return *this; }
+        Iterator operator+(difference_type n) const { Iterator it = *this; return it += n; }
+        Iterator operator-(difference_type n) const { Iterator it = *this; return it -= n; }
+        friend Iterator operator+(difference_type n, const Iterator& it) { return it + n; }
+        difference_type operator-(const Iterator& other) const { return pos - other.pos; }
+
+        bool operator==(const Iterator& other) const { return pos == other.pos; }
+        bool operator!=(const Iterator& other) const { return pos != other.pos; }
+        bool operator<(const Iterator& other) const { return pos < other.pos; }
+        bool operator>(const Iterator& other) const { return pos > other.pos; }
+        bool operator<=(const Iterator& other) const { return pos <= other.pos; }
+        bool operator>=(const Iterator& other) const { return pos >= other.pos; }
+
+    private:
+        friend class Deque;
+        template <bool> friend class Iterator;
+
+        Iterator(T* const* blockmap, int position) : map(blockmap), pos(position) {}
+
+        // The deque's blockmap and the slot position counted from blockmap[0][0]
+        T* const* map;
+        int pos;
+    };
+
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    typedef Allocator allocator_type;
+
+    /**
+     * @brief Constructs an empty deque with a default-constructed allocator.
+     */
+    Deque();
+
+    /**
+     * @brief Constructs an empty deque that takes its storage from an allocator.
+     * @param alloc The allocator (e.g. a polymorphic_allocator built from a memory_resource*).
+     */
+    explicit Deque(const Allocator& alloc);
+
+    /**
+     * @brief Copy constructor. Copies the elements one block at a time.
+     * @param other The deque to copy.
+     */
+    Deque(const Deque& other);
+
+    /**
+     * @brief Copies another deque's elements into storage from the given allocator.
+     * @param other The deque to copy.
+     * @param alloc The allocator for the copy.
+     */
+    Deque(const Deque& other, const Allocator& alloc);
+
+    /**
+     * @brief Move constructor. Takes over other's blocks in O(1); other is left empty.
+     * @param other The deque to move from.
+     */
+    Deque(Deque&& other) noexcept;
+
+    /**
+     * @brief Copy assignment (copy and swap).
+     * @param other The deque to copy.
+     * @return Reference to this deque.
+     */
+    Deque& operator=(const Deque& other);
+
+    /**
+     * @brief Move assignment. Takes over other's blocks when the allocator propagates
+     *        or the allocators compare equal; otherwise moves the elements one block-sized
+     *        chunk at a time. other is left empty.
+     * @param other The deque to move from.
+     * @return Reference to this deque.
+     */
+    Deque& operator=(Deque&& other) noexcept(AllocTraits::propagate_on_container_move_assignment::value ||
+                                             AllocTraits::is_always_equal::value);
+
+    /**
+     * @brief Destructor. Destroys all elements and frees all dynamically allocated memory.
+     */
+    ~Deque();
+
+    /**
+     * @brief Exchanges the contents of two deques in O(1). Unless the allocator propagates
+     *        on swap, both deques must have equal allocators.
+     * @param other The deque to swap with.
+     */
+    void swap(Deque& other) noexcept;
+
+    /**
+     * @brief Gets a copy of the allocator.
+     * @return The deque's allocator.
+     */
+    allocator_type get_allocator() const;
+
+    /**
+     * @brief Exchanges the contents of two deques in O(1).
+     */
+    friend void swap(Deque& a, Deque& b) noexcept { a.swap(b); }
+
+    /**
+     * @brief Moves all of other's elements onto the back of this deque, leaving other empty.
+     *
+     * When the free part of this deque's back block lines up with the used part of
+     * other's front block, only those edge elements are moved and every other block
+     * is handed over by pointer, O(blocks). Otherwise the smaller of the two deques
+     * is moved element-wise, O(min(size(), other.size())). If the allocators differ,
+     * all of other's elements are moved, O(other.size()).
+     *
+     * @param other The deque to take elements from.
+     */
+    void splice_back(Deque&& other);
+
+    /**
+     * @brief Moves all of other's elements onto the front of this deque, leaving other empty.
+     *
+     * Costs are as for splice_back(), with the roles of the front and back blocks swapped.
+     *
+     * @param other The deque to take elements from.
+     */
+    void splice_front(Deque&& other);
+
+    /**
+     * @brief Constructs an element in place at the front of the deque.
+     * @param args Arguments forwarded to the element constructor.
+     * @return Reference to the new front element.
+     */
+    template <typename... Args>
+    T& emplace_front(Args&&... args);
+
+    /**
+     * @brief Constructs an element in place at the back of the deque.
+     * @param args Arguments forwarded to the element constructor.
+     * @return Reference to the new back element.
+     */
+    template <typename... Args>
+    T& emplace_back(Args&&... args);
+
+    /**
+     * @brief Adds a copy of an element to the front of the deque.
+     * @param value The value to add.
+     */
+    void push_front(const T& value);
+
+    /**
+     * @brief Moves an element onto the front of the deque.
+     * @param value The value to add.
+     */
+    void push_front(T&& value);
+
+    /**
+     * @brief Adds a copy of an element to the back of the deque.
+     * @param value The value to add.
+     */
+    void push_back(const T& value);
+
+    /**
+     * @brief Moves an element onto the back of the deque.
+     * @param value The value to add.
+     */
+    void push_back(T&& value);
+
+    /**
+     * @brief Removes the front element from the deque.
+     */
+    void pop_front();
+
+    /**
+     * @brief Removes the back element from the deque.
+     */
+    void pop_back();
+
+    /**
+     * @brief Copies a range of elements onto the back of the deque, one block at a time.
+     * @param values First element to copy.
+     * @param n Number of elements; values[n - 1] becomes the new back.
+     */
+    void append(const T* values, std::size_t n);
+
+    /**
+     * @brief Copies a range of elements onto the front of the deque, one block at a time.
+     * @param values First element to copy.
+     * @param n Number of elements; values[0] becomes the new front.
+     */
+    void prepend(const T* values, std::size_t n);
+
+    /**
+     * @brief Removes the first n elements from the deque.
+     * @param n Number of elements to remove (at most size()).
+     */
+    void pop_front_n(std::size_t n);
+
+    /**
+     * @brief Removes the last n elements from the deque.
+     * @param n Number of elements to remove (at most size()).
+     */
+    void pop_back_n(std::size_t n);
+
+    /**
+     * @brief Constructs an element in place before pos, shifting the elements on
+     *        whichever side of pos is shorter by one slot, O(min(i, size() - i)).
+     * @param pos Position to insert before (begin() through end()).
+     * @param args Arguments forwarded to the element constructor.
+     * @return Iterator to the new element. All other iterators are invalidated.
+     */
+    template <typename... Args>
+    iterator emplace(const_iterator pos, Args&&... args);
+
+    /**
+     * @brief Inserts a copy of an element before pos (see emplace()).
+     * @param pos Position to insert before.
+     * @param value The value to add.
+     * @return Iterator to the new element.
+     */
+    iterator insert(const_iterator pos, const T& value);
+
+    /**
+     * @brief Moves an element into the deque before pos (see emplace()).
+     * @param pos Position to insert before.
+     * @param value The value to add.
+     * @return Iterator to the new element.
+     */
+    iterator insert(const_iterator pos, T&& value);
+
+    /**
+     * @brief Removes the element at pos, closing the gap from whichever side is shorter.
+     * @param pos Position of the element to remove (not end()).
+     * @return Iterator to the element that followed the removed one.
+     */
+    iterator erase(const_iterator pos);
+
+    /**
+     * @brief Removes the elements in [first, last), closing the gap from whichever side
+     *        is shorter, O(min(elements before, elements after) + (last - first)).
+     * @param first First element to remove.
+     * @param last One past the last element to remove.
+     * @return Iterator to the element that followed the removed range.
+     */
+    iterator erase(const_iterator first, const_iterator last);
+
+    /**
+     * @brief Copies the first n elements into an array, one block at a time.
+     * @param dst Destination array with room for n elements.
+     * @param n Number of elements to copy (at most size()).
+     */
+    void copy_out(T* dst, std::size_t n) const;
+
+    /**
+     * @brief Accesses the front element.
+     * @return Reference to the value at the front of the deque.
+     */
+    T& front();
+    const T& front() const;
+
+    /**
+     * @brief Accesses the back element.
+     * @return Reference to the value at the back of the deque.
+     */
+    T& back();
+    const T& back() const;
+
+    /**
+     * @brief Checks whether the deque is empty.
+     * @return True if the deque is empty; false otherwise.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Gets the current number of elements in the deque.
+     * @return The number of stored elements.
+     */
+    int size() const;
+
+    /**
+     * @brief Gets the number of elements per block.
+     * @return The compile-time block size (a power of two).
+     */
+    static constexpr int block_size() { return BLOCK_SIZE; }
+
+    /**
+     * @brief Accesses the element at a specific index.
+     * @param index Index of the element (0-based).
+     * @return Reference to the element at that index.
+     */
+    T& operator[](int index);
+    const T& operator[](int index) const;
+
+    /**
+     * @brief Gets an iterator to the front element.
+     * @return Iterator to the first element (equal to end() if empty).
+     */
+    iterator begin();
+    const_iterator begin() const;
+    const_iterator cbegin() const;
+
+    /**
+     * @brief Gets an iterator one past the back element.
+     * @return Iterator past the last element.
+     */
+    iterator end();
+    const_iterator end() const;
+    const_iterator cend() const;
+
+    /**
+     * @brief Gets reverse iterators, starting at the back element.
+     * @return Reverse iterator to the last element, or past the first for rend().
+     */
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    /**
+     * @brief Calls f(data, length) once per block, front to back, with each block's
+     *        elements as one contiguous span.
+     * @param f Callable taking (T*, int) (or (const T*, int) for a const deque).
+     */
+    template <typename F>
+    void for_each_segment(F f);
+    template <typename F>
+    void for_each_segment(F f) const;
+
+    /**
+     * @brief Gets the number of segments (blocks holding elements) for_each_segment() visits.
+     * @return The segment count; 0 for an empty deque.
+     */
+    int segment_count() const;
+
+    /**
+     * @brief Gets one segment, so work can be split along block boundaries. Segment 0
+     *        holds elements [0, len0); segment i > 0 starts at len0 + (i - 1) * block_size().
+     * @param i Segment number, less than segment_count().
+     * @return The segment's first element and its length.
+     */
+    std::pair<T*, int> segment(int i);
+    std::pair<const T*, int> segment(int i) const;
+
+    /**
+     * @brief Pre-allocates block storage so the deque can hold n elements without
+     *        allocating blocks from the heap. Extra blocks go on the spare list, and
+     *        the high-water mark is raised so they are kept.
+     * @param n Number of elements to make room for.
+     */
+    void reserve(int n);
+
+    /**
+     * @brief Returns every spare block to the heap.
+     */
+    void shrink_to_fit();
+
+    /**
+     * @brief Sets the high-water mark of the spare block list.
+     * @param blocks Most empty blocks kept for reuse; extra spares are freed now.
+     */
+    void set_spare_limit(int blocks);
+
+    /**
+     * @brief Gets the high-water mark of the spare block list.
+     * @return Most empty blocks kept for reuse.
+     */
+    int spare_limit() const;
+
+    /**
+     * @brief Gets the number of empty blocks currently kept for reuse.
+     * @return The number of spare blocks.
+     */
+    int spare_blocks() const;
+
+    /**
+     * @brief Gets how many blocks have been allocated from the heap so far.
+     * @return The number of block allocations.
+     */
+    std::size_t block_allocations() const;
+
+    /**
+     * @brief Gets how many blocks have been returned to the heap so far.
+     * @return The number of block deallocations.
+     */
+    std::size_t block_deallocations() const;
+
+    /**
+     * @brief Gets the number of block pointers the blockmap can hold.
+     * @return The current blockmap capacity.
+     */
+    int blockmap_capacity() const;
+
+    /**
+     * @brief Takes a snapshot of the memory footprint and, when built with DEQUE_STATS=1,
+     *        the operation and resize counters. O(blockmap capacity).
+     * @return The snapshot.
+     */
+    DequeStats stats() const;
+
+    /**
+     * @brief Writes stats() to a stream.
+     * @param out The stream to write to.
+     * @param format StatsFormat::TEXT for one "name: value" line per figure, or
+     *        StatsFormat::JSON for a single JSON object.
+     */
+    void dump_stats(std::ostream& out, StatsFormat format = StatsFormat::TEXT) const;
+};
+
+template <typename T, int BlockSize, typename Allocator>
+Deque<T, BlockSize, Allocator>::Deque() : Deque(Allocator()) {}
+
+template <typename T, int BlockSize, typename Allocator>
+Deque<T, BlockSize, Allocator>::Deque(const Allocator& alloc) : blockAllocator(alloc) {
+    blockmapCapacity = INITIAL_BLOCKMAP_CAPACITY;
+    blockmap = allocateBlockmap(blockmapCapacity);
+    DEQUE_STAT(counters.peakBlockmapCapacity = blockmapCapacity);
+
+    spareList = nullptr;
+    spareCount = 0;
+    spareLimit = DEFAULT_SPARE_LIMIT;
+    blockAllocs = 0;
+    blockFrees = 0;
+
+    // Start in the middle to allow growing in both directions
+    frontBlock = blockmapCapacity / 2;
+    blockmap[frontBlock] = acquireBlock();
+
+    frontIndex = BLOCK_SIZE / 2;
+    count = 0;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+Deque<T, BlockSize, Allocator>::Deque(const Deque& other)
+    : Deque(other, AllocTraits::select_on_container_copy_construction(other.get_allocator())) {}
+
+template <typename T, int BlockSize, typename Allocator>
+Deque<T, BlockSize, Allocator>::Deque(const Deque& other, const Allocator& alloc) : Deque(alloc) {
+    spareLimit = other.spareLimit;
+    other.for_each_segment([this](const T* data, int len) {
+        copyBack(data, len);
+    });
+}
+
+template <typename T, int BlockSize, typename Allocator>
+Deque<T, BlockSize, Allocator>::Deque(Deque&& other) noexcept
+    : blockmap(other.blockmap), blockmapCapacity(other.blockmapCapacity),
+      frontBlock(other.frontBlock), frontIndex(other.frontIndex), count(other.count),
+      spareList(other.spareList), spareCount(other.spareCount), spareLimit(other.spareLimit),
+      blockAllocs(other.blockAllocs), blockFrees(other.blockFrees),
+      blockAllocator(std::move(other.blockAllocator)) {
+    // Leave other as an empty deque with no blockmap; it allocates one on the next push
+    other.blockmap = nullptr;
+    other.blockmapCapacity = 0;
+    other.frontBlock = 0;
+    other.frontIndex = 0;
+    other.count = 0;
+    other.spareList = nullptr;
+    other.spareCount = 0;
+    other.blockAllocs = 0;
+    other.blockFrees = 0;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+Deque<T, BlockSize, Allocator>& Deque<T, BlockSize, Allocator>::operator=(const Deque& other) {
+    if (this != &other) {
+        // The copy is built with the allocator this deque should end up with
+        const bool propagate = AllocTraits::propagate_on_container_copy_assignment::value;
+        Deque copy(other, propagate ? other.get_allocator() : get_allocator());
+        swapContents(copy);
+        if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+            using std::swap;
+            swap(blockAllocator, copy.blockAllocator);
+        }
+    }
+    return *this;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+Deque<T, BlockSize, Allocator>& Deque<T, BlockSize, Allocator>::operator=(Deque&& other)
+    noexcept(AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value) {
+    if (this == &other) return *this;
+
+    if (AllocTraits::propagate_on_container_move_assignment::value || blockAllocator == other.blockAllocator) {
+        // Our old blocks leave with moved, together with the allocator that owns them
+        Deque moved(std::move(other));
+        swapContents(moved);
+        if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+            using std::swap;
+            swap(blockAllocator, moved.blockAllocator);
+        }
+    } else {
+        // Blocks cannot change hands between different allocators
+        destroyBack(count);
+        relocateBackFrom(other);
+    }
+    return *this;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::swap(Deque& other) noexcept {
+    assert((AllocTraits::propagate_on_container_swap::value || blockAllocator == other.blockAllocator) &&
+           "swap() called on deques with unequal allocators");
+    swapContents(other);
+    if constexpr (AllocTraits::propagate_on_container_swap::value) {
+        using std::swap;
+        swap(blockAllocator, other.blockAllocator);
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::allocator_type Deque<T, BlockSize, Allocator>::get_allocator() const {
+    return allocator_type(blockAllocator);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::swapContents(Deque& other) noexcept {
+    std::swap(blockmap, other.blockmap);
+    std::swap(blockmapCapacity, other.blockmapCapacity);
+    std::swap(frontBlock, other.frontBlock);
+    std::swap(frontIndex, other.frontIndex);
+    std::swap(count, other.count);
+    std::swap(spareList, other.spareList);
+    std::swap(spareCount, other.spareCount);
+    std::swap(spareLimit, other.spareLimit);
+    std::swap(blockAllocs, other.blockAllocs);
+    std::swap(blockFrees, other.blockFrees);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+Deque<T, BlockSize, Allocator>::~Deque() {
+    if (!std::is_trivially_destructible<T>::value) {
+        for (int i = 0; i < count; ++i)
+            slot(i)->~T();
+    }
+    for (int i = 0; i < blockmapCapacity; ++i) {
+        if (blockmap[i] != nullptr)
+            freeBlock(blockmap[i]);
+    }
+    trimSpares(0);
+    freeBlockmap(blockmap, blockmapCapacity);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T* Deque<T, BlockSize, Allocator>::allocateBlock() {
+    BlockStorage* storage = std::allocator_traits<BlockAllocator>::allocate(blockAllocator, 1);
+    return reinterpret_cast<T*>(storage->bytes);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::freeBlock(T* block) {
+    std::allocator_traits<BlockAllocator>::deallocate(blockAllocator, reinterpret_cast<BlockStorage*>(block), 1);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T** Deque<T, BlockSize, Allocator>::allocateBlockmap(int capacity) {
+    MapAllocator mapAllocator(blockAllocator);
+    T** map = std::allocator_traits<MapAllocator>::allocate(mapAllocator, capacity);
+    for (int i = 0; i < capacity; ++i)
+        map[i] = nullptr;
+    return map;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::freeBlockmap(T** map, int capacity) {
+    if (map == nullptr) return;
+    MapAllocator mapAllocator(blockAllocator);
+    std::allocator_traits<MapAllocator>::deallocate(mapAllocator, map, capacity);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T*& Deque<T, BlockSize, Allocator>::nextSpare(T* block) {
+    return *std::launder(reinterpret_cast<T**>(block));
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T* Deque<T, BlockSize, Allocator>::acquireBlock() {
+    if (spareList != nullptr) {
+        T* block = spareList;
+        spareList = nextSpare(block);
+        spareCount--;
+        DEQUE_STAT(++counters.spareReuses);
+        return block;
+    }
+    blockAllocs++;
+    return allocateBlock();
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::releaseBlock(T* block) {
+    if (spareCount < spareLimit) {
+        ::new (static_cast<void*>(block)) T*(spareList);
+        spareList = block;
+        spareCount++;
+        return;
+    }
+    blockFrees++;
+    freeBlock(block);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::trimSpares(int limit) {
+    while (spareCount > limit) {
+        T* block = spareList;
+        spareList = nextSpare(block);
+        spareCount--;
+        blockFrees++;
+        freeBlock(block);
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T* Deque<T, BlockSize, Allocator>::growFront() {
+    if (frontIndex == 0) {
+        if (frontBlock == 0) resizeBlockmap(1);
+        if (blockmap[frontBlock - 1] == nullptr)
+            blockmap[frontBlock - 1] = acquireBlock();
+        return blockmap[frontBlock - 1] + (BLOCK_SIZE - 1);
+    }
+    return blockmap[frontBlock] + (frontIndex - 1);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T* Deque<T, BlockSize, Allocator>::growBack() {
+    int end = frontIndex + count;
+    if (frontBlock + (end >> BLOCK_SHIFT) == blockmapCapacity) resizeBlockmap(1);
+
+    int block = frontBlock + (end >> BLOCK_SHIFT);
+    if (blockmap[block] == nullptr)
+        blockmap[block] = acquireBlock();
+    return blockmap[block] + (end & BLOCK_MASK);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::resizeBlockmap(int extraBlocks) {
+    // Blocks spanned by the elements (an empty deque keeps its front block only
+    // while frontIndex points into it)
+    int used = count == 0 ? (frontIndex == 0 ? 0 : 1)
+                          : ((frontIndex + count - 1) >> BLOCK_SHIFT) + 1;
+
+    // Anything allocated outside that span (an emptied front block, or blocks left
+    // behind by a throwing constructor) goes back to the spare list so the span can
+    // be moved on its own
+    for (int i = 0; i < blockmapCapacity; ++i) {
+        if (blockmap[i] != nullptr && (i < frontBlock || i >= frontBlock + used)) {
+            releaseBlock(blockmap[i]);
+            blockmap[i] = nullptr;
+        }
+    }
+
+    // A FIFO drifts toward one end while the other end empties out. As long as the
+    // span (plus the blocks being grown into) fills at most half the map, slide it
+    // back to the middle instead of doubling. That leaves at least a quarter of the
+    // map free on each side, so sliding stays amortized O(1) per block crossed.
+    int newCapacity = blockmapCapacity > 0 ? blockmapCapacity : INITIAL_BLOCKMAP_CAPACITY;
+    while ((used + extraBlocks) * 2 > newCapacity) newCapacity *= 2;
+    int newFront = (newCapacity - used) / 2;
+
+    if (newCapacity == blockmapCapacity) {
+        DEQUE_STAT(++counters.blockmapRecenters);
+        std::memmove(blockmap + newFront, blockmap + frontBlock, used * sizeof(T*));
+        for (int i = 0; i < blockmapCapacity; ++i) {
+            if (i < newFront || i >= newFront + used)
+                blockmap[i] = nullptr;
+        }
+    } else {
+        T** newBlockmap = allocateBlockmap(newCapacity);
+        for (int i = 0; i < used; ++i)
+            newBlockmap[newFront + i] = blockmap[frontBlock + i];
+
+        freeBlockmap(blockmap, blockmapCapacity);
+        blockmap = newBlockmap;
+        blockmapCapacity = newCapacity;
+        DEQUE_STAT(++counters.blockmapGrowths);
+        DEQUE_STAT(counters.peakBlockmapCapacity = std::max(counters.peakBlockmapCapacity, newCapacity));
+    }
+    frontBlock = newFront;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T* Deque<T, BlockSize, Allocator>::slot(int index) const {
+    int absolute = frontIndex + index;
+    return blockmap[frontBlock + (absolute >> BLOCK_SHIFT)] + (absolute & BLOCK_MASK);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+template <typename... Args>
+T& Deque<T, BlockSize, Allocator>::emplace_front(Args&&... args) {
+    DEQUE_STAT(++counters.pushFront);
+    return constructFront(std::forward<Args>(args)...);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+template <typename... Args>
+T& Deque<T, BlockSize, Allocator>::emplace_back(Args&&... args) {
+    DEQUE_STAT(++counters.pushBack);
+    return constructBack(std::forward<Args>(args)...);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+template <typename... Args>
+T& Deque<T, BlockSize, Allocator>::constructFront(Args&&... args) {
+    T* p = growFront();
+    ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+
+    // Only commit the new front once construction has succeeded
+    if (frontIndex == 0) {
+        --frontBlock;
+        frontIndex = BLOCK_SIZE;
+    }
+    --frontIndex;
+    count++;
+    return *p;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+template <typename... Args>
+T& Deque<T, BlockSize, Allocator>::constructBack(Args&&... args) {
+    T* p = growBack();
+    ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+    count++;
+    return *p;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::push_front(const T& value) {
+    emplace_front(value);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::push_front(T&& value) {
+    emplace_front(std::move(value));
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::push_back(const T& value) {
+    emplace_back(value);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::push_back(T&& value) {
+    emplace_back(std::move(value));
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::pop_front() {
+    assert(!empty() && "pop_front() called on empty deque");
+    DEQUE_STAT(++counters.popFront);
+
+    blockmap[frontBlock][frontIndex].~T();
+    releaseFront(1);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::pop_back() {
+    assert(!empty() && "pop_back() called on empty deque");
+    DEQUE_STAT(++counters.popBack);
+
+    slot(count - 1)->~T();
+    releaseBack(1);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::releaseFront(int n) {
+    frontIndex += n;
+    count -= n;
+    if (frontIndex == BLOCK_SIZE) {
+        releaseBlock(blockmap[frontBlock]);
+        blockmap[frontBlock++] = nullptr;
+        frontIndex = 0;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::releaseBack(int n) {
+    int last = frontIndex + count - 1;
+    int block = frontBlock + (last >> BLOCK_SHIFT);
+    count -= n;
+
+    // Free the back block once it no longer holds any elements
+    if (n == (last & BLOCK_MASK) + 1 && block != frontBlock) {
+        releaseBlock(blockmap[block]);
+        blockmap[block] = nullptr;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::relocateRange(T* src, int n, T* dst) {
+    if (std::is_trivially_copyable<T>::value) {
+        std::memcpy(static_cast<void*>(dst), src, n * sizeof(T));
+    } else {
+        for (int i = 0; i < n; ++i) {
+            ::new (static_cast<void*>(dst + i)) T(std::move(src[i]));
+            src[i].~T();
+        }
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::relocateBackFrom(Deque& src) {
+    reserveBack(src.count);
+    while (src.count > 0) {
+        int end = frontIndex + count;
+        int chunk = std::min(std::min(BLOCK_SIZE - (end & BLOCK_MASK), BLOCK_SIZE - src.frontIndex),
+                             src.count);
+        relocateRange(src.blockmap[src.frontBlock] + src.frontIndex, chunk,
+                      blockmap[frontBlock + (end >> BLOCK_SHIFT)] + (end & BLOCK_MASK));
+        count += chunk;
+        src.releaseFront(chunk);
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::relocateFrontFrom(Deque& src) {
+    reserveFront(src.count);
+    while (src.count > 0) {
+        int block = frontBlock;
+        int index = frontIndex;
+        if (index == 0) {
+            --block;
+            index = BLOCK_SIZE;
+        }
+        int srcInBlock = ((src.frontIndex + src.count - 1) & BLOCK_MASK) + 1;
+        int chunk = std::min(std::min(index, srcInBlock), src.count);
+        relocateRange(src.slot(src.count - chunk), chunk, blockmap[block] + index - chunk);
+
+        frontBlock = block;
+        frontIndex = index - chunk;
+        count += chunk;
+        src.releaseBack(chunk);
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::splice_back(Deque&& other) {
+    if (this == &other || other.count == 0) return;
+    DEQUE_STAT(++counters.splices);
+    if (!(blockAllocator == other.blockAllocator)) {
+        relocateBackFrom(other);
+        return;
+    }
+
+    // Whole blocks can only change hands if both deques agree on the offset at the seam
+    int seam = (frontIndex + count) & BLOCK_MASK;
+    if (seam != other.frontIndex) {
+        if (count <= other.count) {
+            other.relocateFrontFrom(*this);
+            swapContents(other);
+        } else {
+            relocateBackFrom(other);
+        }
+        return;
+    }
+
+    // Top up our partial back block from other's front block
+    if (seam != 0) {
+        int chunk = std::min(BLOCK_SIZE - seam, other.count);
+        relocateRange(other.blockmap[other.frontBlock] + other.frontIndex, chunk, slot(count));
+        count += chunk;
+        other.releaseFront(chunk);
+        if (other.count == 0) return;
+    }
+
+    // other now starts at the beginning of a block and we end at the end of one
+    int blocks = ((other.count - 1) >> BLOCK_SHIFT) + 1;
+    int used = count == 0 ? 0 : ((frontIndex + count - 1) >> BLOCK_SHIFT) + 1;
+    if (frontBlock + used + blocks > blockmapCapacity) resizeBlockmap(blocks);
+
+    int dst = frontBlock + ((frontIndex + count) >> BLOCK_SHIFT);
+    for (int i = 0; i < blocks; ++i) {
+        if (blockmap[dst + i] != nullptr) releaseBlock(blockmap[dst + i]);
+        blockmap[dst + i] = other.blockmap[other.frontBlock + i];
+        other.blockmap[other.frontBlock + i] = nullptr;
+    }
+    count += other.count;
+    other.count = 0;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::splice_front(Deque&& other) {
+    if (this == &other || other.count == 0) return;
+    DEQUE_STAT(++counters.splices);
+    if (!(blockAllocator == other.blockAllocator)) {
+        relocateFrontFrom(other);
+        return;
+    }
+
+    // Whole blocks can only change hands if both deques agree on the offset at the seam
+    int seam = (other.frontIndex + other.count) & BLOCK_MASK;
+    if (seam != frontIndex) {
+        if (count <= other.count) {
+            other.relocateBackFrom(*this);
+            swapContents(other);
+        } else {
+            relocateFrontFrom(other);
+        }
+        return;
+    }
+
+    // Top up our partial front block from other's back block
+    if (seam != 0) {
+        int chunk = std::min(seam, other.count);
+        relocateRange(other.slot(other.count - chunk), chunk, blockmap[frontBlock] + frontIndex - chunk);
+        frontIndex -= chunk;
+        count += chunk;
+        other.releaseBack(chunk);
+        if (other.count == 0) return;
+    }
+
+    // other now ends at the end of a block and we start at the beginning of one
+    int blocks = ((other.frontIndex + other.count - 1) >> BLOCK_SHIFT) + 1;
+    if (frontBlock < blocks) resizeBlockmap(blocks);
+
+    for (int i = 1; i <= blocks; ++i) {
+        if (blockmap[frontBlock - i] != nullptr) releaseBlock(blockmap[frontBlock - i]);
+        blockmap[frontBlock - i] = other.blockmap[other.frontBlock + blocks - i];
+        other.blockmap[other.frontBlock + blocks - i] = nullptr;
+    }
+    frontBlock -= blocks;
+    frontIndex = other.frontIndex;
+    count += other.count;
+    other.count = 0;
+    other.frontIndex = 0;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::constructRange(const T* src, int n, T* dst) {
+    if (std::is_trivially_copyable<T>::value)
+        std::memcpy(static_cast<void*>(dst), src, n * sizeof(T));
+    else
+        std::uninitialized_copy(src, src + n, dst);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::destroyRange(T* first, int n) {
+    if (!std::is_trivially_destructible<T>::value) {
+        for (int i = 0; i < n; ++i)
+            first[i].~T();
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::reserveBack(int n) {
+    int used = count == 0 ? (frontIndex == 0 ? 0 : 1)
+                          : ((frontIndex + count - 1) >> BLOCK_SHIFT) + 1;
+    int end = frontIndex + count;
+    int needed = ((end + n - 1) >> BLOCK_SHIFT) + 1;
+    if (frontBlock + needed > blockmapCapacity) resizeBlockmap(needed - used);
+
+    for (int b = frontBlock + (end >> BLOCK_SHIFT); b < frontBlock + needed; ++b) {
+        if (blockmap[b] == nullptr)
+            blockmap[b] = acquireBlock();
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::reserveFront(int n) {
+    int needed = n > frontIndex ? (n - frontIndex + BLOCK_MASK) >> BLOCK_SHIFT : 0;
+    if (frontBlock < needed) resizeBlockmap(needed);
+
+    for (int b = frontBlock - needed; b < frontBlock; ++b) {
+        if (blockmap[b] == nullptr)
+            blockmap[b] = acquireBlock();
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::append(const T* values, std::size_t n) {
+    int added = static_cast<int>(n);
+    assert(n == static_cast<std::size_t>(added) && "append() range too large");
+    DEQUE_STAT(++counters.appends);
+    copyBack(values, added);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::copyBack(const T* values, int added) {
+    if (added == 0) return;
+    reserveBack(added);
+
+    // Fill the partial back block, then whole blocks; count is updated per block
+    // so the elements copied so far stay in the deque if a copy throws
+    int done = 0;
+    while (done < added) {
+        int end = frontIndex + count;
+        int chunk = std::min(BLOCK_SIZE - (end & BLOCK_MASK), added - done);
+        constructRange(values + done, chunk,
+                       blockmap[frontBlock + (end >> BLOCK_SHIFT)] + (end & BLOCK_MASK));
+        count += chunk;
+        done += chunk;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::prepend(const T* values, std::size_t n) {
+    int remaining = static_cast<int>(n);
+    assert(n == static_cast<std::size_t>(remaining) && "prepend() range too large");
+    DEQUE_STAT(++counters.prepends);
+    if (remaining == 0) return;
+    reserveFront(remaining);
+
+    // Fill backwards from the current front, committing each block as it is done
+    while (remaining > 0) {
+        int block = frontBlock;
+        int index = frontIndex;
+        if (index == 0) {
+            --block;
+            index = BLOCK_SIZE;
+        }
+        int chunk = std::min(index, remaining);
+        constructRange(values + remaining - chunk, chunk, blockmap[block] + index - chunk);
+
+        frontBlock = block;
+        frontIndex = index - chunk;
+        count += chunk;
+        remaining -= chunk;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::pop_front_n(std::size_t n) {
+    assert(n <= static_cast<std::size_t>(count) && "pop_front_n() called with n > size()");
+    DEQUE_STAT(++counters.popFrontN);
+    destroyFront(static_cast<int>(n));
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::destroyFront(int remaining) {
+    while (remaining > 0) {
+        int chunk = std::min(BLOCK_SIZE - frontIndex, remaining);
+        destroyRange(blockmap[frontBlock] + frontIndex, chunk);
+        releaseFront(chunk);
+        remaining -= chunk;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::pop_back_n(std::size_t n) {
+    assert(n <= static_cast<std::size_t>(count) && "pop_back_n() called with n > size()");
+    DEQUE_STAT(++counters.popBackN);
+    destroyBack(static_cast<int>(n));
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::destroyBack(int remaining) {
+    while (remaining > 0) {
+        int inBlock = ((frontIndex + count - 1) & BLOCK_MASK) + 1;
+        int chunk = std::min(inBlock, remaining);
+        destroyRange(slot(count - chunk), chunk);
+        releaseBack(chunk);
+        remaining -= chunk;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::shiftRange(int from, int to, int n) {
+    if (from == to) return;
+
+    // Each chunk stays inside one source block and one destination block. Moving
+    // toward the back walks from the end so overlapping chunks are not overwritten.
+    if (to > from) {
+        int srcEnd = frontIndex + from + n;
+        int dstEnd = frontIndex + to + n;
+        while (n > 0) {
+            int chunk = std::min(n, std::min(((srcEnd - 1) & BLOCK_MASK) + 1, ((dstEnd - 1) & BLOCK_MASK) + 1));
+            srcEnd -= chunk;
+            dstEnd -= chunk;
+            T* src = blockmap[frontBlock + (srcEnd >> BLOCK_SHIFT)] + (srcEnd & BLOCK_MASK);
+            T* dst = blockmap[frontBlock + (dstEnd >> BLOCK_SHIFT)] + (dstEnd & BLOCK_MASK);
+            if (std::is_trivially_copyable<T>::value)
+                std::memmove(static_cast<void*>(dst), src, chunk * sizeof(T));
+            else
+                std::move_backward(src, src + chunk, dst + chunk);
+            n -= chunk;
+        }
+    } else {
+        int srcPos = frontIndex + from;
+        int dstPos = frontIndex + to;
+        while (n > 0) {
+            int chunk = std::min(n, std::min(BLOCK_SIZE - (srcPos & BLOCK_MASK), BLOCK_SIZE - (dstPos & BLOCK_MASK)));
+            T* src = blockmap[frontBlock + (srcPos >> BLOCK_SHIFT)] + (srcPos & BLOCK_MASK);
+            T* dst = blockmap[frontBlock + (dstPos >> BLOCK_SHIFT)] + (dstPos & BLOCK_MASK);
+            if (std::is_trivially_copyable<T>::value)
+                std::memmove(static_cast<void*>(dst), src, chunk * sizeof(T));
+            else
+                std::move(src, src + chunk, dst);
+            srcPos += chunk;
+            dstPos += chunk;
+            n -= chunk;
+        }
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+template <typename... Args>
+typename Deque<T, BlockSize, Allocator>::iterator Deque<T, BlockSize, Allocator>::emplace(const_iterator pos, Args&&... args) {
+    int index = static_cast<int>(pos - cbegin());
+    assert(index >= 0 && index <= count && "emplace() position out of range");
+    DEQUE_STAT(++counters.inserts);
+
+    if (index == 0) {
+        constructFront(std::forward<Args>(args)...);
+        return begin();
+    }
+    if (index == count) {
+        constructBack(std::forward<Args>(args)...);
+        return end() - 1;
+    }
+
+    // Build the value first: args may refer to an element that is about to shift
+    T value(std::forward<Args>(args)...);
+    if (index < count - index) {
+        // Open a slot at the front, then slide elements [1, index) down by one
+        constructFront(std::move(front()));
+        shiftRange(2, 1, index - 1);
+    } else {
+        // Open a slot at the back, then slide elements [index, size - 1) up by one
+        constructBack(std::move(back()));
+        shiftRange(index, index + 1, count - 2 - index);
+    }
+    *slot(index) = std::move(value);
+    return begin() + index;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::iterator Deque<T, BlockSize, Allocator>::insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::iterator Deque<T, BlockSize, Allocator>::insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::iterator Deque<T, BlockSize, Allocator>::erase(const_iterator pos) {
+    return erase(pos, pos + 1);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::iterator Deque<T, BlockSize, Allocator>::erase(const_iterator first, const_iterator last) {
+    int index = static_cast<int>(first - cbegin());
+    int n = static_cast<int>(last - first);
+    assert(index >= 0 && n >= 0 && index + n <= count && "erase() range out of bounds");
+    DEQUE_STAT(++counters.erases);
+
+    // Slide the shorter side over the gap, then drop the leftover elements at that end
+    int after = count - index - n;
+    if (index < after) {
+        shiftRange(0, n, index);
+        destroyFront(n);
+    } else {
+        shiftRange(index + n, index, after);
+        destroyBack(n);
+    }
+    return begin() + index;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::copy_out(T* dst, std::size_t n) const {
+    assert(n <= static_cast<std::size_t>(count) && "copy_out() called with n > size()");
+
+    int remaining = static_cast<int>(n);
+    int pos = frontIndex;
+    while (remaining > 0) {
+        int chunk = std::min(BLOCK_SIZE - (pos & BLOCK_MASK), remaining);
+        const T* src = blockmap[frontBlock + (pos >> BLOCK_SHIFT)] + (pos & BLOCK_MASK);
+        if (std::is_trivially_copyable<T>::value)
+            std::memcpy(static_cast<void*>(dst), src, chunk * sizeof(T));
+        else
+            std::copy(src, src + chunk, dst);
+        dst += chunk;
+        pos += chunk;
+        remaining -= chunk;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T& Deque<T, BlockSize, Allocator>::front() {
+    assert(!empty() && "front() called on empty deque");
+    return blockmap[frontBlock][frontIndex];
+}
+
+template <typename T, int BlockSize, typename Allocator>
+const T& Deque<T, BlockSize, Allocator>::front() const {
+    assert(!empty() && "front() called on empty deque");
+    return blockmap[frontBlock][frontIndex];
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T& Deque<T, BlockSize, Allocator>::back() {
+    assert(!empty() && "back() called on empty deque");
+    return *slot(count - 1);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+const T& Deque<T, BlockSize, Allocator>::back() const {
+    assert(!empty() && "back() called on empty deque");
+    return *slot(count - 1);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+bool Deque<T, BlockSize, Allocator>::empty() const {
+    return count == 0;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+int Deque<T, BlockSize, Allocator>::size() const {
+    return count;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+T& Deque<T, BlockSize, Allocator>::operator[](int index) {
+    assert(index >= 0 && index < count && "operator[] out of bounds");
+    return *slot(index);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+const T& Deque<T, BlockSize, Allocator>::operator[](int index) const {
+    assert(index >= 0 && index < count && "operator[] out of bounds");
+    return *slot(index);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::iterator Deque<T, BlockSize, Allocator>::begin() {
+    return iterator(blockmap, (frontBlock << BLOCK_SHIFT) + frontIndex);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::const_iterator Deque<T, BlockSize, Allocator>::begin() const {
+    return const_iterator(blockmap, (frontBlock << BLOCK_SHIFT) + frontIndex);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::const_iterator Deque<T, BlockSize, Allocator>::cbegin() const {
+    return begin();
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::iterator Deque<T, BlockSize, Allocator>::end() {
+    return iterator(blockmap, (frontBlock << BLOCK_SHIFT) + frontIndex + count);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::const_iterator Deque<T, BlockSize, Allocator>::end() const {
+    return const_iterator(blockmap, (frontBlock << BLOCK_SHIFT) + frontIndex + count);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+typename Deque<T, BlockSize, Allocator>::const_iterator Deque<T, BlockSize, Allocator>::cend() const {
+    return end();
+}
+
+template <typename T, int BlockSize, typename Allocator>
+template <typename F>
+void Deque<T, BlockSize, Allocator>::for_each_segment(F f) {
+    int pos = frontIndex;
+    int remaining = count;
+    for (int b = frontBlock; remaining > 0; ++b) {
+        int len = std::min(BLOCK_SIZE - pos, remaining);
+        f(blockmap[b] + pos, len);
+        remaining -= len;
+        pos = 0;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+template <typename F>
+void Deque<T, BlockSize, Allocator>::for_each_segment(F f) const {
+    int pos = frontIndex;
+    int remaining = count;
+    for (int b = frontBlock; remaining > 0; ++b) {
+        int len = std::min(BLOCK_SIZE - pos, remaining);
+        f(static_cast<const T*>(blockmap[b] + pos), len);
+        remaining -= len;
+        pos = 0;
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+int Deque<T, BlockSize, Allocator>::segment_count() const {
+    return count == 0 ? 0 : ((frontIndex + count - 1) >> BLOCK_SHIFT) + 1;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+std::pair<T*, int> Deque<T, BlockSize, Allocator>::segment(int i) {
+    assert(i >= 0 && i < segment_count() && "segment() index out of range");
+    int start = i == 0 ? frontIndex : 0;
+    int first = (i << BLOCK_SHIFT) + start - frontIndex;
+    return std::pair<T*, int>(blockmap[frontBlock + i] + start, std::min(BLOCK_SIZE - start, count - first));
+}
+
+template <typename T, int BlockSize, typename Allocator>
+std::pair<const T*, int> Deque<T, BlockSize, Allocator>::segment(int i) const {
+    assert(i >= 0 && i < segment_count() && "segment() index out of range");
+    int start = i == 0 ? frontIndex : 0;
+    int first = (i << BLOCK_SHIFT) + start - frontIndex;
+    return std::pair<const T*, int>(blockmap[frontBlock + i] + start, std::min(BLOCK_SIZE - start, count - first));
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::reserve(int n) {
+    // Blocks needed in the worst case, where the elements straddle a block edge
+    int needed = ((n + BLOCK_MASK) >> BLOCK_SHIFT) + 1;
+
+    int held = spareCount;
+    for (int i = 0; i < blockmapCapacity; ++i) {
+        if (blockmap[i] != nullptr) held++;
+    }
+
+    if (needed - held > 0) {
+        if (spareLimit < spareCount + needed - held)
+            spareLimit = spareCount + needed - held;
+        for (; held < needed; ++held) {
+            blockAllocs++;
+            releaseBlock(allocateBlock());
+        }
+    }
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::shrink_to_fit() {
+    trimSpares(0);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::set_spare_limit(int blocks) {
+    assert(blocks >= 0 && "set_spare_limit() called with a negative limit");
+    spareLimit = blocks;
+    trimSpares(spareLimit);
+}
+
+template <typename T, int BlockSize, typename Allocator>
+int Deque<T, BlockSize, Allocator>::spare_limit() const {
+    return spareLimit;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+int Deque<T, BlockSize, Allocator>::spare_blocks() const {
+    return spareCount;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+std::size_t Deque<T, BlockSize, Allocator>::block_allocations() const {
+    return blockAllocs;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+std::size_t Deque<T, BlockSize, Allocator>::block_deallocations() const {
+    return blockFrees;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+int Deque<T, BlockSize, Allocator>::blockmap_capacity() const {
+    return blockmapCapacity;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+DequeStats Deque<T, BlockSize, Allocator>::stats() const {
+    DequeStats snapshot;
+    snapshot.countersEnabled = DEQUE_STATS != 0;
+    snapshot.blockSize = BLOCK_SIZE;
+    snapshot.elementBytes = sizeof(T);
+    snapshot.blockBytes = sizeof(BlockStorage);
+    snapshot.elements = count;
+    snapshot.blocksInUse = count == 0 ? 0 : ((frontIndex + count - 1) >> BLOCK_SHIFT) + 1;
+    snapshot.spareBlocks = spareCount;
+    snapshot.blockmapCapacity = blockmapCapacity;
+    snapshot.blockAllocations = blockAllocs;
+    snapshot.blockDeallocations = blockFrees;
+
+    // Held blocks include the empty front block a new or drained deque keeps
+    int held = spareCount;
+    for (int i = 0; i < blockmapCapacity; ++i) {
+        if (blockmap[i] != nullptr) held++;
+    }
+    snapshot.bytesInUse = static_cast<std::size_t>(count) * sizeof(T);
+    snapshot.bytesReserved = held * sizeof(BlockStorage) + blockmapCapacity * sizeof(T*);
+    snapshot.edgeWasteBytes =
+        static_cast<std::size_t>(snapshot.blocksInUse) * BLOCK_SIZE * sizeof(T) - snapshot.bytesInUse;
+#if DEQUE_STATS
+    snapshot.ops = counters;
+    snapshot.ops.peakBlockmapCapacity = std::max(counters.peakBlockmapCapacity, blockmapCapacity);
+#endif
+    return snapshot;
+}
+
+template <typename T, int BlockSize, typename Allocator>
+void Deque<T, BlockSize, Allocator>::dump_stats(std::ostream& out, StatsFormat format) const {
+    writeDequeStats(out, stats(), format);
+}
+
+#endif
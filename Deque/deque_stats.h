@@ -0,0 +1,172 @@
+/**
+ * @file deque_stats.h
+ * @author Odin's Ravens
+ * @date April 25, 2025
+ * @brief Runtime statistics for Deque: memory footprint, blockmap resizes and op counts.
+ *
+ * The memory figures are computed on demand by Deque::stats() and are always
+ * available. The operation and resize counters cost a member and an increment per
+ * call, so they are only compiled in when DEQUE_STATS is defined to 1
+ * (e.g. "make STATS=1"); otherwise they read as zero and the dump says so.
+ *
+ * Course: CSCI 325 — Data Structures and Algorithms
+ */
+
+#ifndef DEQUE_STATS_H
+#define DEQUE_STATS_H
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+
+// Compile in the Deque operation counters (override with -DDEQUE_STATS=1)
+#ifndef DEQUE_STATS
+#define DEQUE_STATS 0
+#endif
+
+#if DEQUE_STATS
+#define DEQUE_STAT(statement) statement
+#else
+#define DEQUE_STAT(statement)
+#endif
+
+/**
+ * @struct DequeCounters
+ * @brief Per-deque event counters, maintained only when DEQUE_STATS is enabled.
+ */
+struct DequeCounters {
+    // Blockmap reallocations (doubling) and in-place recenterings
+    std::size_t blockmapGrowths = 0;
+    std::size_t blockmapRecenters = 0;
+
+    // Largest blockmap capacity seen
+    int peakBlockmapCapacity = 0;
+
+    // Blocks handed out from the spare list instead of the allocator
+    std::size_t spareReuses = 0;
+
+    // Calls to each public operation (emplace_* count as push_*)
+    std::size_t pushFront = 0;
+    std::size_t pushBack = 0;
+    std::size_t popFront = 0;
+    std::size_t popBack = 0;
+    std::size_t inserts = 0;
+    std::size_t erases = 0;
+    std::size_t appends = 0;
+    std::size_t prepends = 0;
+    std::size_t popFrontN = 0;
+    std::size_t popBackN = 0;
+    std::size_t splices = 0;
+};
+
+/**
+ * @struct DequeStats
+ * @brief A snapshot of a deque's memory use and, if enabled, its counters.
+ */
+struct DequeStats {
+    // Whether ops holds real counts (DEQUE_STATS was enabled)
+    bool countersEnabled;
+
+    // Element and block geometry
+    int blockSize;
+    std::size_t elementBytes;
+    std::size_t blockBytes;
+
+    // Elements stored and blocks they span
+    int elements;
+    int blocksInUse;
+    int spareBlocks;
+
+    // Current blockmap size in block pointers
+    int blockmapCapacity;
+
+    // Blocks obtained from and returned to the allocator over the deque's life
+    std::size_t blockAllocations;
+    std::size_t blockDeallocations;
+
+    // Bytes holding elements, bytes held in blocks and the blockmap, and the unused
+    // slots of the partial blocks at the two ends
+    std::size_t bytesInUse;
+    std::size_t bytesReserved;
+    std::size_t edgeWasteBytes;
+
+    DequeCounters ops;
+};
+
+/**
+ * @enum StatsFormat
+ * @brief Output format for writeDequeStats().
+ */
+enum class StatsFormat {
+    TEXT,
+    JSON
+};
+
+/**
+ * @brief Writes a stats snapshot as aligned "name: value" lines or as one JSON object.
+ * @param out The stream to write to.
+ * @param stats The snapshot.
+ * @param format TEXT or JSON.
+ */
+inline void writeDequeStats(std::ostream& out, const DequeStats& stats, StatsFormat format) {
+    struct Field {
+        const char* text;
+        const char* json;
+        long long value;
+    };
+    const DequeCounters& ops = stats.ops;
+    const Field fields[] = {
+        {"block size (elements)", "block_size", stats.blockSize},
+        {"element bytes", "element_bytes", static_cast<long long>(stats.elementBytes)},
+        {"block bytes", "block_bytes", static_cast<long long>(stats.blockBytes)},
+        {"elements", "elements", stats.elements},
+        {"blocks in use", "blocks_in_use", stats.blocksInUse},
+        {"spare blocks", "spare_blocks", stats.spareBlocks},
+        {"blocks allocated", "block_allocations", static_cast<long long>(stats.blockAllocations)},
+        {"blocks freed", "block_deallocations", static_cast<long long>(stats.blockDeallocations)},
+        {"blockmap capacity", "blockmap_capacity", stats.blockmapCapacity},
+        {"bytes in use", "bytes_in_use", static_cast<long long>(stats.bytesInUse)},
+        {"bytes reserved", "bytes_reserved", static_cast<long long>(stats.bytesReserved)},
+        {"edge block waste (bytes)", "edge_waste_bytes", static_cast<long long>(stats.edgeWasteBytes)},
+        {"peak blockmap capacity", "peak_blockmap_capacity", ops.peakBlockmapCapacity},
+        {"blockmap growths", "blockmap_growths", static_cast<long long>(ops.blockmapGrowths)},
+        {"blockmap recenters", "blockmap_recenters", static_cast<long long>(ops.blockmapRecenters)},
+        {"spare block reuses", "spare_reuses", static_cast<long long>(ops.spareReuses)},
+        {"push_front", "push_front", static_cast<long long>(ops.pushFront)},
+        {"push_back", "push_back", static_cast<long long>(ops.pushBack)},
+        {"pop_front", "pop_front", static_cast<long long>(ops.popFront)},
+        {"pop_back", "pop_back", static_cast<long long>(ops.popBack)},
+        {"insert", "insert", static_cast<long long>(ops.inserts)},
+        {"erase", "erase", static_cast<long long>(ops.erases)},
+        {"append", "append", static_cast<long long>(ops.appends)},
+        {"prepend", "prepend", static_cast<long long>(ops.prepends)},
+        {"pop_front_n", "pop_front_n", static_cast<long long>(ops.popFrontN)},
+        {"pop_back_n", "pop_back_n", static_cast<long long>(ops.popBackN)},
+        {"splice", "splice", static_cast<long long>(ops.splices)},
+    };
+    const int fieldCount = sizeof(fields) / sizeof(fields[0]);
+
+    // Everything from the peak capacity on is a counter
+    const int firstCounter = 12;
+
+    if (format == StatsFormat::JSON) {
+        out << "{\"counters_enabled\": " << (stats.countersEnabled ? "true" : "false");
+        for (int i = 0; i < fieldCount; ++i)
+            out << ", \"" << fields[i].json << "\": " << fields[i].value;
+        out << "}\n";
+        return;
+    }
+
+    for (int i = 0; i < fieldCount; ++i) {
+        if (i == firstCounter && !stats.countersEnabled) {
+            out << "  (operation counters disabled; build with -DDEQUE_STATS=1)\n";
+            break;
+        }
+        out << "  " << fields[i].text << ":";
+        for (int pad = static_cast<int>(std::strlen(fields[i].text)); pad < 26; ++pad)
+            out << ' ';
+        out << fields[i].value << "\n";
+    }
+}
+
+#endif
@@ -1,163 +1,760 @@
-/**
- * @file main.cpp  
- * @author Odin's Ravens  
- * @date April 25, 2025  
- * @brief Automated and interactive test harness ("Deque Gauntlet")  
- * 
- * This test driver runs a user-defined number of operations on a custom Deque and compares
- * each one to std::vector as a reference. After an initial dry run, it offers reproducible or
- * new random test options based on the previously used seed.
- * 
- * Course: CSCI 325 — Data Structures and Algorithms  
- */
-
- #include <iostream>
- #include <vector>
- #include <cstdlib>
- #include <ctime>
- #include <cassert>
- #include "deque.h"
- 
- using namespace std;
- 
- enum Operation {
-     PUSH_FRONT,
-     PUSH_BACK,
-     POP_FRONT,
-     POP_BACK,
-     ACCESS_INDEX
- };
- 
- Operation randomOperation() {
-     int r = rand() % 100;
-     if (r < 30) return PUSH_BACK;
-     else if (r < 60) return PUSH_FRONT;
-     else if (r < 75) return POP_BACK;
-     else if (r < 90) return POP_FRONT;
-     else return ACCESS_INDEX;
- }
- 
- void runDequeGauntlet(int operations) {
-     Deque myDeque;
-     vector<int> refVec;
- 
-     cout << "\n[Deque Gauntlet] Starting with " << operations << " operations..." << endl;
- 
-     for (int i = 0; i < operations; ++i) {
-         Operation op = randomOperation();
-         int value = rand() % 1000;
- 
-         switch (op) {
-             case PUSH_BACK:
-                 myDeque.push_back(value);
-                 refVec.push_back(value);
-                 break;
-             case PUSH_FRONT:
-                 myDeque.push_front(value);
-                 refVec.insert(refVec.begin(), value);
-                 break;
-             case POP_BACK:
-                 if (!refVec.empty()) {
-                     myDeque.pop_back();
-                     refVec.pop_back();
-                 }
-                 break;
-             case POP_FRONT:
-                 if (!refVec.empty()) {
-                     myDeque.pop_front();
-                     refVec.erase(refVec.begin());
-                 }
-                 break;
-             case ACCESS_INDEX:
-                 if (!refVec.empty()) {
-                     int idx = rand() % refVec.size();
-                     assert(myDeque[idx] == refVec[idx] && "Mismatch on operator[] access");
-                 }
-                 break;
-         }
- 
-         assert(myDeque.size() == (int)refVec.size() && "Size mismatch between deque and vector");
- 
-         if (!refVec.empty()) {
-             assert(myDeque.front() == refVec.front() && "Front value mismatch");
-             assert(myDeque.back() == refVec.back() && "Back value mismatch");
-         }
-     }
- 
-     // Summary output
-     cout << "[Deque Gauntlet] Test complete!" << endl;
-     cout << "  Final size: " << myDeque.size() << endl;
- 
-     if (!myDeque.empty()) {
-         cout << "  Front: " << myDeque.front() << endl;
-         cout << "  Back : " << myDeque.back() << endl;
- 
-         cout << "  First 5 elements: ";
-         for (int i = 0; i < min(5, myDeque.size()); ++i)
-             cout << myDeque[i] << " ";
-         cout << endl;
- 
-         cout << "  Last 5 elements : ";
-         for (int i = max(0, myDeque.size() - 5); i < myDeque.size(); ++i)
-             cout << myDeque[i] << " ";
-         cout << endl;
- 
-         cout << "\n[Validation Samples from Deque vs std::vector]\n";
-         for (int i = 0; i < 5; ++i) {
-             int idx = rand() % refVec.size();
-             int dequeVal = myDeque[idx];
-             int vectorVal = refVec[idx];
-             cout << "  Index " << idx << ": Deque = " << dequeVal
-                  << ", std::vector = " << vectorVal
-                  << (dequeVal == vectorVal ? " GO" : " NO-GO") << endl;
-         }
-     } else {
-         cout << "  Deque is empty.\n";
-     }
- 
-     cout << "[Deque Gauntlet] All tests passed successfully!" << endl;
- }
- 
- int main() {
-     cout << "===== Deque Gauntlet Test Driver =====" << endl;
- 
-     int operationCount;
-     cout << "Enter number of operations to perform per run: ";
-     cin >> operationCount;
- 
-     // Initial random seed
-     int lastUsedSeed = static_cast<int>(time(0));
-     srand(lastUsedSeed);
-     cout << "Initial dry run of " << operationCount << " random operations with seed = " << lastUsedSeed << endl;
-     runDequeGauntlet(operationCount);
- 
-     while (true) {
-         cout << "\nChoose test mode:\n";
-         cout << "  1. Reproduce last run (seed = " << lastUsedSeed << ")\n";
-         cout << "  2. New random run\n";
-         cout << "  3. Quit\n";
-         cout << "Enter choice: ";
- 
-         int choice;
-         cin >> choice;
- 
-         if (choice == 1) {
-             cout << "Re-running with previous seed: " << lastUsedSeed << endl;
-             srand(lastUsedSeed);
-             runDequeGauntlet(operationCount);
-         } else if (choice == 2) {
-             lastUsedSeed = static_cast<int>(time(0));
-             cout << "Running new random run with seed: " << lastUsedSeed << endl;
-             srand(lastUsedSeed);
-             runDequeGauntlet(operationCount);
-         } else if (choice == 3) {
-             cout << "Exiting. Goodbye!" << endl;
-             break;
-         } else {
-             cout << "Invalid option. Try again.\n";
-         }
-     }
- 
-     return 0;
- }
+/**
+ * @file main.cpp  
+ * @author Odin's Ravens  
+ * @date April 25, 2025  
+ * @brief Automated and interactive test harness ("Deque Gauntlet")  
+ * 
+ * This test driver runs a user-defined number of operations on a custom Deque and compares
+ * each one to std::deque as a reference. After an initial dry run, it offers reproducible or
+ * new random test options based on the previously used seed.
+ *
+ * Each run also stress-tests the WorkStealingDeque: the owner thread pushes and pops while
+ * a pack of thief threads steal, and every task must be taken exactly once. Then several
+ * producers and consumers share an MpmcRingQueue, pushing and popping one value at a time
+ * and in batches; every value must be popped exactly once and in its producer's order.
+ * Finally, a SpillingDeque with tiny blocks grows and drains against std::deque while
+ * spilling its middle to a backing file in the current directory.
+ *
+ * Given command-line arguments, the driver runs without prompting:
+ *   deque_test --ops N --seed S [--seed S ...] [--json]
+ *       run the Gauntlet for each seed; --json prints the Deque stats as JSON
+ *   deque_test --bench [--ops N] [--seeds K] [--threads T]
+ *       time each operation mix on Deque and std::deque (ns/op and heap allocations),
+ *       with K seeds per mix spread over T threads
+ * 
+ * Course: CSCI 325 — Data Structures and Algorithms  
+ */
+
+ #include <algorithm>
+ #include <atomic>
+ #include <chrono>
+ #include <deque>
+ #include <functional>
+ #include <iomanip>
+ #include <iostream>
+ #include <memory>
+ #include <new>
+ #include <numeric>
+ #include <random>
+ #include <thread>
+ #include <vector>
+ #include <cstdlib>
+ #include <cstring>
+ #include <ctime>
+ #include <cassert>
+ #include "block_resources.h"
+ #include "deque.h"
+ #include "parallel_algorithms.h"
+ #include "ring_queue.h"
+ #include "spilling_deque.h"
+ #include "work_stealing_deque.h"
+ 
+ using namespace std;
+ 
+ // Sum of squares for parallel_reduce: folds elements as x * x and partial sums as they are
+ struct SquareSum {
+     long long operator()(long long acc, const int& x) const { return acc + (long long)x * x; }
+     long long operator()(long long a, long long b) const { return a + b; }
+ };
+ 
+ // Format of the Deque stats printed after each Gauntlet run
+ StatsFormat gauntletStatsFormat = StatsFormat::TEXT;
+ 
+ // Heap allocations made by the current thread (counted by the operator new below)
+ static thread_local long long threadAllocations = 0;
+ 
+ void* operator new(size_t size) {
+     ++threadAllocations;
+     if (void* p = malloc(size > 0 ? size : 1)) return p;
+     throw bad_alloc();
+ }
+ 
+ void* operator new(size_t size, align_val_t alignment) {
+     ++threadAllocations;
+     void* p = nullptr;
+     size_t align = static_cast<size_t>(alignment) < sizeof(void*) ? sizeof(void*) : static_cast<size_t>(alignment);
+     if (posix_memalign(&p, align, size > 0 ? size : 1) == 0) return p;
+     throw bad_alloc();
+ }
+ 
+ void* operator new[](size_t size) { return operator new(size); }
+ void* operator new[](size_t size, align_val_t alignment) { return operator new(size, alignment); }
+ void operator delete(void* p) noexcept { free(p); }
+ void operator delete(void* p, size_t) noexcept { free(p); }
+ void operator delete(void* p, align_val_t) noexcept { free(p); }
+ void operator delete(void* p, size_t, align_val_t) noexcept { free(p); }
+ void operator delete[](void* p) noexcept { free(p); }
+ void operator delete[](void* p, size_t) noexcept { free(p); }
+ void operator delete[](void* p, align_val_t) noexcept { free(p); }
+ void operator delete[](void* p, size_t, align_val_t) noexcept { free(p); }
+ 
+ enum Operation {
+     PUSH_FRONT,
+     PUSH_BACK,
+     POP_FRONT,
+     POP_BACK,
+     ACCESS_INDEX,
+     BULK_APPEND,
+     BULK_PREPEND,
+     BULK_POP_FRONT,
+     BULK_POP_BACK,
+     INSERT_MIDDLE,
+     ERASE_MIDDLE
+ };
+ 
+ Operation randomOperation() {
+     int r = rand() % 100;
+     if (r < 26) return PUSH_BACK;
+     else if (r < 52) return PUSH_FRONT;
+     else if (r < 64) return POP_BACK;
+     else if (r < 76) return POP_FRONT;
+     else if (r < 86) return ACCESS_INDEX;
+     else if (r < 88) return BULK_APPEND;
+     else if (r < 90) return BULK_PREPEND;
+     else if (r < 91) return BULK_POP_FRONT;
+     else if (r < 92) return BULK_POP_BACK;
+     else if (r < 96) return INSERT_MIDDLE;
+     else return ERASE_MIDDLE;
+ }
+ 
+ void runDequeGauntlet(int operations) {
+     Deque<int> myDeque;
+     deque<int> refDeque;
+     vector<int> batch;
+ 
+     cout << "\n[Deque Gauntlet] Starting with " << operations << " operations..." << endl;
+ 
+     for (int i = 0; i < operations; ++i) {
+         Operation op = randomOperation();
+         int value = rand() % 1000;
+ 
+         switch (op) {
+             case PUSH_BACK:
+                 myDeque.push_back(value);
+                 refDeque.push_back(value);
+                 break;
+             case PUSH_FRONT:
+                 myDeque.push_front(value);
+                 refDeque.push_front(value);
+                 break;
+             case POP_BACK:
+                 if (!refDeque.empty()) {
+                     myDeque.pop_back();
+                     refDeque.pop_back();
+                 }
+                 break;
+             case POP_FRONT:
+                 if (!refDeque.empty()) {
+                     myDeque.pop_front();
+                     refDeque.pop_front();
+                 }
+                 break;
+             case ACCESS_INDEX:
+                 if (!refDeque.empty()) {
+                     int idx = rand() % refDeque.size();
+                     assert(myDeque[idx] == refDeque[idx] && "Mismatch on operator[] access");
+                 }
+                 break;
+             case BULK_APPEND:
+             case BULK_PREPEND:
+                 batch.resize(rand() % 200);
+                 for (size_t k = 0; k < batch.size(); ++k)
+                     batch[k] = rand() % 1000;
+                 if (op == BULK_APPEND) {
+                     myDeque.append(batch.data(), batch.size());
+                     refDeque.insert(refDeque.end(), batch.begin(), batch.end());
+                 } else {
+                     myDeque.prepend(batch.data(), batch.size());
+                     refDeque.insert(refDeque.begin(), batch.begin(), batch.end());
+                 }
+                 break;
+             case BULK_POP_FRONT:
+             case BULK_POP_BACK: {
+                 int n = min(rand() % 200, (int)refDeque.size());
+                 if (op == BULK_POP_FRONT) {
+                     myDeque.pop_front_n(n);
+                     refDeque.erase(refDeque.begin(), refDeque.begin() + n);
+                 } else {
+                     myDeque.pop_back_n(n);
+                     refDeque.erase(refDeque.end() - n, refDeque.end());
+                 }
+                 break;
+             }
+             case INSERT_MIDDLE: {
+                 int idx = rand() % (refDeque.size() + 1);
+                 Deque<int>::iterator it = myDeque.insert(myDeque.cbegin() + idx, value);
+                 refDeque.insert(refDeque.begin() + idx, value);
+                 assert(*it == value && "insert() returned the wrong position");
+                 break;
+             }
+             case ERASE_MIDDLE:
+                 if (!refDeque.empty()) {
+                     int idx = rand() % refDeque.size();
+                     int n = min(1 + rand() % 4, (int)refDeque.size() - idx);
+                     myDeque.erase(myDeque.cbegin() + idx, myDeque.cbegin() + idx + n);
+                     refDeque.erase(refDeque.begin() + idx, refDeque.begin() + idx + n);
+                 }
+                 break;
+         }
+ 
+         assert(myDeque.size() == (int)refDeque.size() && "Size mismatch between deque and reference");
+ 
+         if (!refDeque.empty()) {
+             assert(myDeque.front() == refDeque.front() && "Front value mismatch");
+             assert(myDeque.back() == refDeque.back() && "Back value mismatch");
+         }
+     }
+ 
+     // Full traversal through iterators and per-block segments must match the reference
+     assert(equal(myDeque.begin(), myDeque.end(), refDeque.begin()) && "Iterator traversal mismatch");
+     long long segmentSum = 0;
+     myDeque.for_each_segment([&](const int* data, int len) {
+         for (int i = 0; i < len; ++i)
+             segmentSum += data[i];
+     });
+     assert(segmentSum == accumulate(refDeque.begin(), refDeque.end(), 0LL) && "Segment traversal mismatch");
+ 
+     // A warmed-up FIFO recycles its spare blocks and recenters its blockmap in place, so
+     // pushing and popping across many block edges allocates nothing
+     Deque<int> fifo;
+     for (int i = 0; i < 3000; ++i)
+         fifo.push_back(i);
+     for (int i = 3000; i < 30000; ++i) {
+         fifo.push_back(i);
+         fifo.pop_front();
+     }
+     size_t warmBlocks = fifo.block_allocations();
+     long long warmAllocations = threadAllocations;
+     for (int i = 30000; i < 300000; ++i) {
+         fifo.push_back(i);
+         assert(fifo.front() == i - 3000 && "Steady-state FIFO order mismatch");
+         fifo.pop_front();
+     }
+     assert(fifo.block_allocations() == warmBlocks && threadAllocations == warmAllocations
+            && "Steady-state FIFO allocated");
+ 
+     // Copies are deep, moves and splices hand blocks over without losing elements
+     Deque<int> copied(myDeque);
+     Deque<int> moved(std::move(copied));
+     assert(copied.empty() && equal(moved.begin(), moved.end(), refDeque.begin()) && "Copy/move mismatch");
+     Deque<int> spliced(myDeque);
+     moved.splice_back(Deque<int>(myDeque));
+     moved.splice_front(std::move(spliced));
+     assert(spliced.empty() && moved.size() == 3 * myDeque.size() && "Splice size mismatch");
+     for (int part = 0; part < 3; ++part)
+         assert(equal(refDeque.begin(), refDeque.end(), moved.begin() + part * myDeque.size()) && "Splice mismatch");
+ 
+     // Deques in different arenas keep their own storage: assignment and splicing
+     // between them move elements instead of handing over blocks
+     typedef Deque<int, BlockBytes<int>::value, pmr::polymorphic_allocator<int>> ArenaDeque;
+     ArenaResource arenaA, arenaB;
+     ArenaDeque inA(&arenaA), inB(&arenaB);
+     myDeque.for_each_segment([&](const int* data, int len) { inA.append(data, len); });
+     inB = inA;
+     inB.splice_front(std::move(inA));
+     inA = std::move(inB);
+     assert(inA.get_allocator().resource() == &arenaA && inB.empty() && "Arena allocator mismatch");
+     assert(inA.size() == 2 * myDeque.size() && equal(refDeque.begin(), refDeque.end(), inA.begin() + myDeque.size())
+            && "Arena splice mismatch");
+ 
+     // Parallel algorithms split along blocks must agree with a serial pass
+     ParallelPool pool(4);
+     long long expectedSum = accumulate(refDeque.begin(), refDeque.end(), 0LL);
+     assert(parallel_reduce(moved, 0LL, plus<long long>(), pool) == 3 * expectedSum && "parallel_reduce mismatch");
+     // An op that isn't plain addition: every element must go through op(U, const T&),
+     // whatever the thread count
+     ParallelPool serialPool(1);
+     long long expectedSquares = 0;
+     for (int x : refDeque)
+         expectedSquares += (long long)x * x;
+     assert(parallel_reduce(moved, 0LL, SquareSum(), pool) == 3 * expectedSquares
+            && parallel_reduce(moved, 0LL, SquareSum(), serialPool) == 3 * expectedSquares
+            && "parallel_reduce sum of squares mismatch");
+     parallel_for_each(moved, [](int& x) { x = 2 * x + 1; }, pool);
+     Deque<int> halved(moved);
+     parallel_transform(moved, halved, [](int x) { return (x - 1) / 2; }, pool);
+     for (int part = 0; part < 3; ++part)
+         assert(equal(refDeque.begin(), refDeque.end(), halved.begin() + part * myDeque.size())
+                && "parallel_for_each/parallel_transform mismatch");
+     if (!refDeque.empty()) {
+         int target = refDeque[rand() % refDeque.size()];
+         assert(parallel_find(myDeque, target, pool) - myDeque.begin()
+                == find(refDeque.begin(), refDeque.end(), target) - refDeque.begin() && "parallel_find mismatch");
+     }
+     assert(parallel_find(myDeque, -1, pool) == myDeque.end() && "parallel_find false match");
+ 
+     // Summary output
+     cout << "[Deque Gauntlet] Test complete!" << endl;
+     cout << "  Final size: " << myDeque.size() << endl;
+     cout << "  Deque stats:" << endl;
+     myDeque.dump_stats(cout, gauntletStatsFormat);
+ 
+     if (!myDeque.empty()) {
+         cout << "  Front: " << myDeque.front() << endl;
+         cout << "  Back : " << myDeque.back() << endl;
+ 
+         cout << "  First 5 elements: ";
+         for (int i = 0; i < min(5, myDeque.size()); ++i)
+             cout << myDeque[i] << " ";
+         cout << endl;
+ 
+         cout << "  Last 5 elements : ";
+         for (int i = max(0, myDeque.size() - 5); i < myDeque.size(); ++i)
+             cout << myDeque[i] << " ";
+         cout << endl;
+ 
+         cout << "\n[Validation Samples from Deque vs std::deque]\n";
+         for (int i = 0; i < 5; ++i) {
+             int idx = rand() % refDeque.size();
+             int dequeVal = myDeque[idx];
+             int refVal = refDeque[idx];
+             cout << "  Index " << idx << ": Deque = " << dequeVal
+                  << ", std::deque = " << refVal
+                  << (dequeVal == refVal ? " GO" : " NO-GO") << endl;
+         }
+     } else {
+         cout << "  Deque is empty.\n";
+     }
+ 
+     cout << "[Deque Gauntlet] All tests passed successfully!" << endl;
+ }
+ 
+ void runStealGauntlet(int tasks) {
+     const int thiefCount = 8;
+ 
+     // Small blocks so the blockmap has to grow while thieves are stealing
+     WorkStealingDeque<int, 16> wsDeque;
+     unique_ptr<atomic<int>[]> taken(new atomic<int>[tasks]);
+     for (int i = 0; i < tasks; ++i)
+         taken[i].store(0);
+ 
+     atomic<bool> ownerDone(false);
+     atomic<int> stolen(0);
+ 
+     cout << "\n[Steal Gauntlet] " << tasks << " tasks, 1 owner, " << thiefCount << " thieves..." << endl;
+ 
+     vector<thread> thieves;
+     for (int t = 0; t < thiefCount; ++t) {
+         thieves.emplace_back([&]() {
+             int task;
+             while (!ownerDone.load() || !wsDeque.empty()) {
+                 if (wsDeque.steal(task)) {
+                     taken[task]++;
+                     stolen++;
+                 }
+             }
+         });
+     }
+ 
+     // Owner: bursts of pushes interleaved with pops from its own end
+     int popped = 0;
+     int task;
+     for (int next = 0; next < tasks;) {
+         int burst = 1 + rand() % 200;
+         for (int i = 0; i < burst && next < tasks; ++i)
+             wsDeque.push(next++);
+ 
+         int pops = rand() % burst;
+         for (int i = 0; i < pops && wsDeque.pop(task); ++i) {
+             taken[task]++;
+             popped++;
+         }
+     }
+     while (wsDeque.pop(task)) {
+         taken[task]++;
+         popped++;
+     }
+     ownerDone.store(true);
+     for (thread& thief : thieves)
+         thief.join();
+ 
+     for (int i = 0; i < tasks; ++i)
+         assert(taken[i].load() == 1 && "Task lost or taken twice");
+     assert(popped + stolen.load() == tasks && "Task count mismatch");
+ 
+     cout << "[Steal Gauntlet] Test complete!" << endl;
+     cout << "  Popped by owner: " << popped << ", stolen: " << stolen.load()
+          << ", final blockmap capacity: " << wsDeque.blockmap_capacity() << endl;
+     cout << "[Steal Gauntlet] Every task taken exactly once!" << endl;
+ }
+ 
+ void runQueueGauntlet(int values) {
+     const int producerCount = 4;
+     const int consumerCount = 4;
+     const int maxBatch = 32;
+ 
+     // A small ring so producers often find it full and consumers often find it empty
+     MpmcRingQueue<int> queue(64);
+     int perProducer = max(1, values / producerCount);
+     int total = perProducer * producerCount;
+     unique_ptr<atomic<int>[]> taken(new atomic<int>[total]);
+     for (int i = 0; i < total; ++i)
+         taken[i].store(0);
+ 
+     // Values a consumer may still claim; each blocking pop or batch is claimed first, so
+     // no consumer ever waits for a value another one will take
+     atomic<int> unclaimed(total);
+     atomic<bool> outOfOrder(false);
+ 
+     cout << "\n[Queue Gauntlet] " << total << " values, " << producerCount << " producers, "
+          << consumerCount << " consumers..." << endl;
+ 
+     // Producer p pushes p * perProducer, p * perProducer + 1, ... in order, by single
+     // blocking pushes and by batches
+     vector<thread> threads;
+     for (int p = 0; p < producerCount; ++p) {
+         unsigned seed = static_cast<unsigned>(rand());
+         threads.emplace_back([&, p, seed]() {
+             minstd_rand rng(seed);
+             int batch[maxBatch];
+             for (int next = p * perProducer, end = next + perProducer; next < end;) {
+                 if (rng() % 2 == 0) {
+                     queue.push(next++);
+                     continue;
+                 }
+                 int count = min(end - next, 1 + static_cast<int>(rng() % maxBatch));
+                 for (int i = 0; i < count; ++i)
+                     batch[i] = next + i;
+                 for (int done = 0; done < count;) {
+                     size_t pushed = queue.try_push_n(batch + done, count - done);
+                     if (pushed == 0) this_thread::yield();
+                     done += static_cast<int>(pushed);
+                 }
+                 next += count;
+             }
+         });
+     }
+ 
+     // Each consumer must see every producer's values in increasing order
+     for (int c = 0; c < consumerCount; ++c) {
+         unsigned seed = static_cast<unsigned>(rand());
+         threads.emplace_back([&, seed]() {
+             minstd_rand rng(seed);
+             vector<int> lastSeen(producerCount, -1);
+             int batch[maxBatch];
+             auto take = [&](int value) {
+                 assert(value >= 0 && value < total && "Queue value out of range");
+                 taken[value]++;
+                 int p = value / perProducer;
+                 if (value <= lastSeen[p]) outOfOrder.store(true);
+                 lastSeen[p] = value;
+             };
+ 
+             for (;;) {
+                 int want = rng() % 2 == 0 ? 1 : 1 + static_cast<int>(rng() % maxBatch);
+                 int left = unclaimed.load();
+                 while (left > 0 && !unclaimed.compare_exchange_weak(left, left - min(left, want))) {
+                     // a failed exchange reloads left
+                 }
+                 if (left <= 0) break;
+                 want = min(left, want);
+ 
+                 if (want == 1) {
+                     int value;
+                     queue.pop(value);
+                     take(value);
+                     continue;
+                 }
+                 for (int got = 0; got < want;) {
+                     size_t popped = queue.try_pop_n(batch, want - got);
+                     if (popped == 0) this_thread::yield();
+                     for (size_t i = 0; i < popped; ++i)
+                         take(batch[i]);
+                     got += static_cast<int>(popped);
+                 }
+             }
+         });
+     }
+     for (thread& t : threads)
+         t.join();
+ 
+     for (int i = 0; i < total; ++i)
+         assert(taken[i].load() == 1 && "Value lost or popped twice");
+     assert(!outOfOrder.load() && "A producer's values arrived out of order");
+     assert(queue.size() == 0 && "Values left in the queue");
+ 
+     cout << "[Queue Gauntlet] Test complete!" << endl;
+     cout << "[Queue Gauntlet] Every value popped exactly once, in each producer's order!" << endl;
+ }
+ 
+ void runSpillGauntlet(int operations) {
+     // Tiny blocks and windows so even short runs spill and reload many blocks
+     SpillingDeque<int, 16> spillDeque(".", 2);
+     deque<int> refDeque;
+     int maxResident = 0;
+ 
+     cout << "\n[Spill Gauntlet] " << operations << " operations, "
+          << spillDeque.hot_blocks() << " hot blocks per end..." << endl;
+ 
+     for (int i = 0; i < operations; ++i) {
+         // First half mostly grows the deque, second half mostly drains it
+         bool growing = (rand() % 100) < (i < operations / 2 ? 65 : 35);
+         int value = rand() % 1000;
+         if (growing || refDeque.empty()) {
+             if (rand() % 2) {
+                 spillDeque.push_back(value);
+                 refDeque.push_back(value);
+             } else {
+                 spillDeque.push_front(value);
+                 refDeque.push_front(value);
+             }
+         } else if (rand() % 2) {
+             spillDeque.pop_back();
+             refDeque.pop_back();
+         } else {
+             spillDeque.pop_front();
+             refDeque.pop_front();
+         }
+ 
+         assert(spillDeque.size() == (long long)refDeque.size() && "Spill size mismatch");
+         if (!refDeque.empty()) {
+             assert(spillDeque.front() == refDeque.front() && "Spill front mismatch");
+             assert(spillDeque.back() == refDeque.back() && "Spill back mismatch");
+             int idx = rand() % refDeque.size();
+             assert(spillDeque[idx] == refDeque[idx] && "Spill operator[] mismatch");
+         }
+         maxResident = max(maxResident, spillDeque.resident_blocks());
+         assert(spillDeque.resident_blocks() <= 2 * spillDeque.hot_blocks() && "Too many resident blocks");
+     }
+ 
+     cout << "[Spill Gauntlet] Test complete!" << endl;
+     cout << "  Final size: " << spillDeque.size() << ", most resident blocks: " << maxResident
+          << ", spills: " << spillDeque.block_spills() << ", loads: " << spillDeque.block_loads() << endl;
+     cout << "[Spill Gauntlet] Memory stayed within the hot windows!" << endl;
+ }
+ 
+ /**
+  * @struct OpMix
+  * @brief Percentages of each single-element operation in a benchmark mix (they sum to 100).
+  */
+ struct OpMix {
+     const char* name;
+     int pushBack, pushFront, popBack, popFront, access;
+ };
+ 
+ const OpMix OP_MIXES[] = {
+     {"gauntlet", 30, 30, 15, 15, 10},
+     {"fifo", 50, 0, 0, 50, 0},
+     {"lifo", 50, 0, 50, 0, 0},
+     {"front-heavy", 10, 50, 10, 30, 0},
+     {"read-mostly", 8, 8, 2, 2, 80}
+ };
+ 
+ /**
+  * @struct Trace
+  * @brief A pre-generated operation sequence, so both containers replay identical work.
+  */
+ struct Trace {
+     vector<unsigned char> ops;
+     vector<int> values;
+ };
+ 
+ Trace makeTrace(const OpMix& mix, int operations, unsigned seed) {
+     mt19937 rng(seed);
+     uniform_int_distribution<int> percent(0, 99);
+     Trace trace;
+     trace.ops.resize(operations);
+     trace.values.resize(operations);
+     for (int i = 0; i < operations; ++i) {
+         int r = percent(rng);
+         if ((r -= mix.pushBack) < 0) trace.ops[i] = PUSH_BACK;
+         else if ((r -= mix.pushFront) < 0) trace.ops[i] = PUSH_FRONT;
+         else if ((r -= mix.popBack) < 0) trace.ops[i] = POP_BACK;
+         else if ((r -= mix.popFront) < 0) trace.ops[i] = POP_FRONT;
+         else trace.ops[i] = ACCESS_INDEX;
+         trace.values[i] = static_cast<int>(rng() & 0x7fffffff);
+     }
+     return trace;
+ }
+ 
+ /**
+  * @struct ReplayResult
+  * @brief Time, heap allocations and a result checksum from one trace replay.
+  */
+ struct ReplayResult {
+     long long ns = 0;
+     long long allocations = 0;
+     long long checksum = 0;
+ };
+ 
+ template <typename Container>
+ ReplayResult replay(const Trace& trace) {
+     ReplayResult result;
+     long long allocationsBefore = threadAllocations;
+     auto start = chrono::steady_clock::now();
+     {
+         Container container;
+         long long checksum = 0;
+         int n = static_cast<int>(trace.ops.size());
+         for (int i = 0; i < n; ++i) {
+             int value = trace.values[i];
+             switch (trace.ops[i]) {
+                 case PUSH_BACK: container.push_back(value); break;
+                 case PUSH_FRONT: container.push_front(value); break;
+                 case POP_BACK:
+                     if (!container.empty()) { checksum += container.back(); container.pop_back(); }
+                     break;
+                 case POP_FRONT:
+                     if (!container.empty()) { checksum += container.front(); container.pop_front(); }
+                     break;
+                 default:
+                     if (!container.empty()) checksum += container[value % container.size()];
+                     break;
+             }
+         }
+         result.checksum = checksum + static_cast<long long>(container.size());
+     }
+     result.ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+     result.allocations = threadAllocations - allocationsBefore;
+     return result;
+ }
+ 
+ void runBenchmark(int operations, int seedCount, unsigned baseSeed, int threadCount) {
+     const int mixCount = sizeof(OP_MIXES) / sizeof(OP_MIXES[0]);
+     vector<ReplayResult> dequeResults(mixCount * seedCount), stdResults(mixCount * seedCount);
+ 
+     cout << "\n[Deque Benchmark] " << operations << " operations x " << seedCount << " seeds per mix, "
+          << threadCount << " thread(s), base seed " << baseSeed << endl;
+ 
+     // Workers claim (mix, seed) jobs; each job replays the same trace on both containers
+     atomic<int> nextJob(0);
+     atomic<bool> mismatch(false);
+     vector<thread> workers;
+     for (int w = 0; w < threadCount; ++w) {
+         workers.emplace_back([&]() {
+             for (int job = nextJob++; job < mixCount * seedCount; job = nextJob++) {
+                 Trace trace = makeTrace(OP_MIXES[job / seedCount], operations, baseSeed + job % seedCount);
+                 dequeResults[job] = replay<Deque<int>>(trace);
+                 stdResults[job] = replay<deque<int>>(trace);
+                 if (dequeResults[job].checksum != stdResults[job].checksum)
+                     mismatch = true;
+             }
+         });
+     }
+     for (thread& worker : workers)
+         worker.join();
+ 
+     cout << left << setw(13) << "  mix" << right
+          << setw(14) << "Deque ns/op" << setw(14) << "std ns/op"
+          << setw(16) << "Deque allocs/k" << setw(14) << "std allocs/k" << endl;
+     cout << fixed << setprecision(2);
+     for (int m = 0; m < mixCount; ++m) {
+         long long dequeNs = 0, stdNs = 0, dequeAllocs = 0, stdAllocs = 0;
+         for (int s = 0; s < seedCount; ++s) {
+             dequeNs += dequeResults[m * seedCount + s].ns;
+             stdNs += stdResults[m * seedCount + s].ns;
+             dequeAllocs += dequeResults[m * seedCount + s].allocations;
+             stdAllocs += stdResults[m * seedCount + s].allocations;
+         }
+         double totalOps = static_cast<double>(operations) * seedCount;
+         cout << "  " << left << setw(11) << OP_MIXES[m].name << right
+              << setw(14) << dequeNs / totalOps << setw(14) << stdNs / totalOps
+              << setw(16) << dequeAllocs * 1000.0 / totalOps << setw(14) << stdAllocs * 1000.0 / totalOps << endl;
+     }
+     cout.unsetf(ios::floatfield);
+ 
+     assert(!mismatch && "Deque and std::deque disagreed on a benchmark trace");
+     cout << "[Deque Benchmark] Results match std::deque on every trace." << endl;
+ }
+ 
+ void printUsage(const char* program) {
+     cout << "Usage: " << program << "                          interactive Gauntlet\n"
+          << "       " << program << " --ops N --seed S [--seed S ...] [--json]\n"
+          << "       " << program << " --bench [--ops N] [--seeds K] [--threads T] [--seed S]\n";
+ }
+ 
+ int main(int argc, char* argv[]) {
+     if (argc > 1) {
+         int operationCount = 100000;
+         int seedCount = 4;
+         int threadCount = max(1u, thread::hardware_concurrency());
+         bool benchmark = false;
+         vector<unsigned> seeds;
+ 
+         for (int i = 1; i < argc; ++i) {
+             bool hasValue = i + 1 < argc;
+             if (strcmp(argv[i], "--bench") == 0) benchmark = true;
+             else if (strcmp(argv[i], "--json") == 0) gauntletStatsFormat = StatsFormat::JSON;
+             else if (strcmp(argv[i], "--ops") == 0 && hasValue) operationCount = atoi(argv[++i]);
+             else if (strcmp(argv[i], "--seed") == 0 && hasValue) seeds.push_back(static_cast<unsigned>(strtoul(argv[++i], nullptr, 10)));
+             else if (strcmp(argv[i], "--seeds") == 0 && hasValue) seedCount = atoi(argv[++i]);
+             else if (strcmp(argv[i], "--threads") == 0 && hasValue) threadCount = atoi(argv[++i]);
+             else {
+                 printUsage(argv[0]);
+                 return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+             }
+         }
+         if (operationCount <= 0 || seedCount <= 0 || threadCount <= 0) {
+             printUsage(argv[0]);
+             return 1;
+         }
+ 
+         if (benchmark) {
+             runBenchmark(operationCount, seedCount, seeds.empty() ? 1u : seeds[0], threadCount);
+             return 0;
+         }
+ 
+         if (seeds.empty())
+             seeds.push_back(static_cast<unsigned>(time(0)));
+         for (unsigned seed : seeds) {
+             cout << "Running " << operationCount << " random operations with seed = " << seed << endl;
+             srand(seed);
+             runDequeGauntlet(operationCount);
+             runStealGauntlet(operationCount);
+             runQueueGauntlet(operationCount);
+             runSpillGauntlet(operationCount);
+         }
+         return 0;
+     }
+ 
+     cout << "===== Deque Gauntlet Test Driver =====" << endl;
+ 
+     int operationCount;
+     cout << "Enter number of operations to perform per run: ";
+     cin >> operationCount;
+ 
+     // Initial random seed
+     int lastUsedSeed = static_cast<int>(time(0));
+     srand(lastUsedSeed);
+     cout << "Initial dry run of " << operationCount << " random operations with seed = " << lastUsedSeed << endl;
+     runDequeGauntlet(operationCount);
+     runStealGauntlet(operationCount);
+     runQueueGauntlet(operationCount);
+     runSpillGauntlet(operationCount);
+ 
+     while (true) {
+         cout << "\nChoose test mode:\n";
+         cout << "  1. Reproduce last run (seed = " << lastUsedSeed << ")\n";
+         cout << "  2. New random run\n";
+         cout << "  3. Quit\n";
+         cout << "Enter choice: ";
+ 
+         int choice;
+         cin >> choice;
+ 
+         if (choice == 1) {
+             cout << "Re-running with previous seed: " << lastUsedSeed << endl;
+             srand(lastUsedSeed);
+             runDequeGauntlet(operationCount);
+             runStealGauntlet(operationCount);
+             runQueueGauntlet(operationCount);
+             runSpillGauntlet(operationCount);
+         } else if (choice == 2) {
+             lastUsedSeed = static_cast<int>(time(0));
+             cout << "Running new random run with seed: " << lastUsedSeed << endl;
+             srand(lastUsedSeed);
+             runDequeGauntlet(operationCount);
+             runStealGauntlet(operationCount);
+             runQueueGauntlet(operationCount);
+             runSpillGauntlet(operationCount);
+         } else if (choice == 3) {
+             cout << "Exiting. Goodbye!" << endl;
+             break;
+         } else {
+             cout << "Invalid option. Try again.\n";
+         }
+     }
+ 
+     return 0;
+ }
  
\ No newline at end of file
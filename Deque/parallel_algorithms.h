@@ -0,0 +1,458 @@
+/**
+ * @file parallel_algorithms.h
+ * @author Odin's Ravens
+ * @date April 25, 2025
+ * @brief Header-only parallel for_each, reduce, transform and find over a Deque.
+ *
+ * Work is split along block boundaries: each task gets a run of whole segments (see
+ * Deque::segment()), so it walks plain contiguous arrays and no two tasks ever touch
+ * the same block. Tasks run on a small fixed thread pool; the calling thread joins in
+ * rather than sleeping. std::execution policies are not used because libstdc++ only
+ * parallelizes them when linked against TBB.
+ *
+ *     ParallelPool pool(8);
+ *     parallel_for_each(dq, [](int& x) { x *= 2; }, pool);
+ *     long long sum = parallel_reduce(dq, 0LL, std::plus<long long>(), pool);
+ *
+ * Course: CSCI 325 — Data Structures and Algorithms
+ */
+
+#ifndef PARALLEL_ALGORITHMS_H
+#define PARALLEL_ALGORITHMS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "deque.h"
+
+/**
+ * @class ParallelPool
+ * @brief A fixed set of worker threads that run numbered tasks in parallel.
+ *
+ * run() publishes a job, the workers and the caller claim task numbers from a shared
+ * counter until none are left, and run() returns once every task has finished. One
+ * job runs at a time; concurrent callers wait their turn. A run() issued from inside a
+ * task executes serially on that thread instead of deadlocking.
+ *
+ * A worker can wake so late that the job it woke for has finished and the next one
+ * is being published. Each worker therefore copies the job under the mutex, and the
+ * claim counter carries the job's generation next to the task number, so a claim
+ * against an old job fails instead of running a task of the new one.
+ */
+class ParallelPool {
+public:
+    /**
+     * @brief Starts the pool.
+     * @param threads Threads that work on a job, counting the caller, so threads - 1
+     *        workers are started. Values below 1 are treated as 1.
+     */
+    explicit ParallelPool(int threads = hardwareThreads())
+        : job{nullptr, nullptr, 0, 0}, nextClaim(0), pending(0), stopping(false) {
+        for (int i = 1; i < threads; ++i)
+            workers.emplace_back([this] { workerLoop(); });
+    }
+
+    /**
+     * @brief Destructor. Stops and joins the workers.
+     */
+    ~ParallelPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    ParallelPool(const ParallelPool&) = delete;
+    ParallelPool& operator=(const ParallelPool&) = delete;
+
+    /**
+     * @brief Gets the number of threads that work on a job, including the caller.
+     * @return The thread count.
+     */
+    int thread_count() const { return static_cast<int>(workers.size()) + 1; }
+
+    /**
+     * @brief Calls task(i) for every i in [0, tasks) and waits for all of them.
+     * @param tasks Number of tasks.
+     * @param task Called concurrently from several threads; must be safe to do so.
+     * @throws The first exception a task threw, after every task has finished.
+     */
+    template <typename F>
+    void run(int tasks, F&& task) {
+        if (tasks <= 0) return;
+        if (workers.empty() || tasks == 1 || insideTask()) {
+            for (int i = 0; i < tasks; ++i)
+                task(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> serial(runMutex);
+        Job current;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job.invoke = [](void* f, int i) { (*static_cast<typename std::remove_reference<F>::type*>(f))(i); };
+            job.context = const_cast<void*>(static_cast<const void*>(&task));
+            job.taskCount = tasks;
+            ++job.generation;
+            nextClaim.store(claimOf(job.generation, 0), std::memory_order_relaxed);
+            pending.store(tasks, std::memory_order_relaxed);
+            failure = nullptr;
+            current = job;
+        }
+        wake.notify_all();
+        drain(current);
+
+        // Wait for the last task; workers still holding this job can no longer claim any
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+        if (failure) {
+            std::exception_ptr error = failure;
+            failure = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * @brief Gets the number of hardware threads, or 1 if it is unknown.
+     * @return The hardware thread count.
+     */
+    static int hardwareThreads() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n == 0 ? 1 : static_cast<int>(n);
+    }
+
+private:
+    std::vector<std::thread> workers;
+
+    // Held by run() for the whole job, so jobs from different callers don't overlap
+    std::mutex runMutex;
+
+    /**
+     * @struct Job
+     * @brief A type-erased call to run()'s task, the number of tasks, and the job's
+     *        generation, bumped for every job so sleeping workers know there is a new one.
+     */
+    struct Job {
+        void (*invoke)(void*, int);
+        void* context;
+        int taskCount;
+        std::uint32_t generation;
+    };
+
+    // Guards job, stopping and failure
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    // The current job; threads work from copies taken under mutex
+    Job job;
+
+    // The current job's generation (high 32 bits) and next task number to claim (low 32
+    // bits), and its tasks not yet finished
+    std::atomic<std::uint64_t> nextClaim;
+    std::atomic<int> pending;
+
+    bool stopping;
+
+    // First exception thrown by a task of the current job
+    std::exception_ptr failure;
+
+    /**
+     * @brief Gets the flag that marks the current thread as running a pool task.
+     */
+    static bool& insideTask() {
+        thread_local bool inside = false;
+        return inside;
+    }
+
+    /**
+     * @brief Packs a generation and a task number into a claim counter value.
+     */
+    static std::uint64_t claimOf(std::uint32_t generation, int task) {
+        return (static_cast<std::uint64_t>(generation) << 32) | static_cast<std::uint32_t>(task);
+    }
+
+    /**
+     * @brief Claims and runs tasks of a job until none are left, or until a newer job
+     *        has replaced it.
+     * @param current The job, as copied under mutex.
+     */
+    void drain(const Job& current) {
+        insideTask() = true;
+        std::uint64_t claim = nextClaim.load(std::memory_order_relaxed);
+        for (;;) {
+            // A claim counter of another generation means this job is over
+            if (claim >> 32 != current.generation) break;
+            int i = static_cast<int>(claim & 0xFFFFFFFFu);
+            if (i >= current.taskCount) break;
+            if (!nextClaim.compare_exchange_weak(claim, claim + 1, std::memory_order_relaxed)) continue;
+            try {
+                current.invoke(current.context, i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) failure = std::current_exception();
+            }
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+            claim = nextClaim.load(std::memory_order_relaxed);
+        }
+        insideTask() = false;
+    }
+
+    /**
+     * @brief Body of each worker thread: sleeps until a job is published, then helps.
+     */
+    void workerLoop() {
+        std::uint32_t seen = 0;
+        for (;;) {
+            Job current;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || job.generation != seen; });
+                if (stopping) return;
+                seen = job.generation;
+                current = job;
+            }
+            drain(current);
+        }
+    }
+};
+
+/**
+ * @brief Gets the process-wide pool the parallel algorithms use by default.
+ * @return A pool with one thread per hardware thread, started on first use.
+ */
+inline ParallelPool& defaultParallelPool() {
+    static ParallelPool pool;
+    return pool;
+}
+
+// Fewest elements worth handing to a task; smaller deques run on the calling thread
+const int PARALLEL_GRAIN = 1 << 14;
+
+/**
+ * @brief Picks how many tasks to split a deque into.
+ * @param elements Number of elements.
+ * @param segments Number of segments; each task gets at least one.
+ * @param pool The pool the tasks will run on.
+ * @return The task count, 0 for an empty deque.
+ */
+inline int parallelTaskCount(int elements, int segments, const ParallelPool& pool) {
+    if (segments == 0) return 0;
+    // A few tasks per thread so one slow task doesn't leave the others idle
+    int tasks = std::min(segments, pool.thread_count() * 4);
+    return std::max(1, std::min(tasks, elements / PARALLEL_GRAIN));
+}
+
+/**
+ * @brief Runs task(t, firstSegment, lastSegment) for each of tasks contiguous runs of
+ *        segments, so the runs together cover [0, segments) in order.
+ */
+template <typename F>
+void runSegmentTasks(int tasks, int segments, ParallelPool& pool, F task) {
+    pool.run(tasks, [&](int t) {
+        int first = static_cast<int>(static_cast<long long>(segments) * t / tasks);
+        int last = static_cast<int>(static_cast<long long>(segments) * (t + 1) / tasks);
+        task(t, first, last);
+    });
+}
+
+/**
+ * @brief Gets the index of a segment's first element.
+ * @param dq The deque.
+ * @param s Segment number, less than dq.segment_count().
+ * @return The element index.
+ */
+template <typename T, int BlockSize, typename Allocator>
+int segmentStart(const Deque<T, BlockSize, Allocator>& dq, int s) {
+    return s == 0 ? 0 : dq.segment(0).second + (s - 1) * BlockSize;
+}
+
+/**
+ * @brief Gets the contiguous run starting at an element: its address and the number of
+ *        elements from there to the end of its segment.
+ * @param dq The deque.
+ * @param index Element index, less than dq.size().
+ * @return The element's address and the run length.
+ */
+template <typename T, int BlockSize, typename Allocator>
+std::pair<T*, int> segmentRunAt(Deque<T, BlockSize, Allocator>& dq, int index) {
+    std::pair<T*, int> seg = dq.segment(0);
+    if (index < seg.second) return std::pair<T*, int>(seg.first + index, seg.second - index);
+    int past = index - seg.second;
+    seg = dq.segment(1 + past / BlockSize);
+    int offset = past % BlockSize;
+    return std::pair<T*, int>(seg.first + offset, seg.second - offset);
+}
+
+/**
+ * @brief Calls f on every element, in parallel.
+ * @param dq The deque.
+ * @param f Called as f(T&) concurrently from several threads; the order is unspecified.
+ * @param pool The pool to run on.
+ */
+template <typename T, int BlockSize, typename Allocator, typename F>
+void parallel_for_each(Deque<T, BlockSize, Allocator>& dq, F f, ParallelPool& pool = defaultParallelPool()) {
+    int segments = dq.segment_count();
+    int tasks = parallelTaskCount(dq.size(), segments, pool);
+    runSegmentTasks(tasks, segments, pool, [&](int, int first, int last) {
+        for (int s = first; s < last; ++s) {
+            std::pair<T*, int> seg = dq.segment(s);
+            for (int i = 0; i < seg.second; ++i)
+                f(seg.first[i]);
+        }
+    });
+}
+
+/**
+ * @brief Folds every element into init with op, in parallel. Each task folds its own
+ *        range left to right, starting from a copy of init, then the partial results
+ *        are folded in order, so op must be associative but need not be commutative.
+ * @param dq The deque.
+ * @param init An identity of op (0 for a sum, 1 for a product): every task starts
+ *        from it, so any other value would be counted once per task. Returned as-is
+ *        for an empty deque.
+ * @param op Called as op(U, const T&) and op(U, U).
+ * @param pool The pool to run on.
+ * @return The folded value.
+ */
+template <typename T, int BlockSize, typename Allocator, typename U, typename Op>
+U parallel_reduce(const Deque<T, BlockSize, Allocator>& dq, U init, Op op,
+                  ParallelPool& pool = defaultParallelPool()) {
+    int segments = dq.segment_count();
+    int tasks = parallelTaskCount(dq.size(), segments, pool);
+    std::vector<std::optional<U>> partials(tasks);
+    runSegmentTasks(tasks, segments, pool, [&](int t, int first, int last) {
+        U acc = init;
+        for (int s = first; s < last; ++s) {
+            std::pair<const T*, int> seg = dq.segment(s);
+            for (int i = 0; i < seg.second; ++i)
+                acc = op(std::move(acc), seg.first[i]);
+        }
+        partials[t].emplace(std::move(acc));
+    });
+
+    if (partials.empty()) return init;
+    U result = std::move(*partials[0]);
+    for (int t = 1; t < tasks; ++t)
+        result = op(std::move(result), std::move(*partials[t]));
+    return result;
+}
+
+/**
+ * @brief Writes f(src[i]) to dst[i] for every element, in parallel. Tasks split along
+ *        src's blocks; dst may use a different block size. src and dst may be the same
+ *        deque.
+ * @param src The input deque.
+ * @param dst The output deque; must already hold src.size() elements.
+ * @param f Called as f(const T&) concurrently from several threads.
+ * @param pool The pool to run on.
+ */
+template <typename T, int BlockSize, typename Allocator, typename U, int OutBlockSize, typename OutAllocator,
+          typename F>
+void parallel_transform(const Deque<T, BlockSize, Allocator>& src, Deque<U, OutBlockSize, OutAllocator>& dst, F f,
+                        ParallelPool& pool = defaultParallelPool()) {
+    assert(dst.size() == src.size() && "parallel_transform() needs dst sized like src");
+    int segments = src.segment_count();
+    int tasks = parallelTaskCount(src.size(), segments, pool);
+    runSegmentTasks(tasks, segments, pool, [&](int, int first, int last) {
+        int index = segmentStart(src, first);
+        for (int s = first; s < last; ++s) {
+            std::pair<const T*, int> seg = src.segment(s);
+            // Copy in runs that are contiguous in both deques
+            for (int done = 0; done < seg.second;) {
+                std::pair<U*, int> out = segmentRunAt(dst, index + done);
+                int len = std::min(seg.second - done, out.second);
+                for (int i = 0; i < len; ++i)
+                    out.first[i] = f(seg.first[done + i]);
+                done += len;
+            }
+            index += seg.second;
+        }
+    });
+}
+
+/**
+ * @brief Finds the index of the first element satisfying pred, in parallel. A task
+ *        stops as soon as some other task has matched earlier in the deque.
+ * @param dq The deque.
+ * @param pred Called as pred(const T&) concurrently from several threads.
+ * @param pool The pool to run on.
+ * @return The lowest matching index, or dq.size() if nothing matched.
+ */
+template <typename T, int BlockSize, typename Allocator, typename Pred>
+int parallelFindIndex(const Deque<T, BlockSize, Allocator>& dq, Pred pred, ParallelPool& pool) {
+    int segments = dq.segment_count();
+    int tasks = parallelTaskCount(dq.size(), segments, pool);
+    std::atomic<int> found(dq.size());
+    runSegmentTasks(tasks, segments, pool, [&](int, int first, int last) {
+        int index = segmentStart(dq, first);
+        for (int s = first; s < last; ++s) {
+            if (found.load(std::memory_order_relaxed) < index) return;
+            std::pair<const T*, int> seg = dq.segment(s);
+            for (int i = 0; i < seg.second; ++i) {
+                if (!pred(seg.first[i])) continue;
+                int hit = index + i;
+                int best = found.load(std::memory_order_relaxed);
+                while (hit < best && !found.compare_exchange_weak(best, hit, std::memory_order_relaxed)) {
+                }
+                return;
+            }
+            index += seg.second;
+        }
+    });
+    return found.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Finds the first element satisfying pred, in parallel.
+ * @param dq The deque.
+ * @param pred Called as pred(const T&) concurrently from several threads.
+ * @param pool The pool to run on.
+ * @return An iterator to the first match, or end().
+ */
+template <typename T, int BlockSize, typename Allocator, typename Pred>
+typename Deque<T, BlockSize, Allocator>::iterator
+parallel_find_if(Deque<T, BlockSize, Allocator>& dq, Pred pred, ParallelPool& pool = defaultParallelPool()) {
+    return dq.begin() + parallelFindIndex(dq, pred, pool);
+}
+
+template <typename T, int BlockSize, typename Allocator, typename Pred>
+typename Deque<T, BlockSize, Allocator>::const_iterator
+parallel_find_if(const Deque<T, BlockSize, Allocator>& dq, Pred pred, ParallelPool& pool = defaultParallelPool()) {
+    return dq.begin() + parallelFindIndex(dq, pred, pool);
+}
+
+/**
+ * @brief Finds the first element equal to value, in parallel.
+ * @param dq The deque.
+ * @param value The value to look for.
+ * @param pool The pool to run on.
+ * @return An iterator to the first match, or end().
+ */
+template <typename T, int BlockSize, typename Allocator, typename V>
+typename Deque<T, BlockSize, Allocator>::iterator
+parallel_find(Deque<T, BlockSize, Allocator>& dq, const V& value, ParallelPool& pool = defaultParallelPool()) {
+    return parallel_find_if(dq, [&value](const T& x) { return x == value; }, pool);
+}
+
+template <typename T, int BlockSize, typename Allocator, typename V>
+typename Deque<T, BlockSize, Allocator>::const_iterator
+parallel_find(const Deque<T, BlockSize, Allocator>& dq, const V& value, ParallelPool& pool = defaultParallelPool()) {
+    return parallel_find_if(dq, [&value](const T& x) { return x == value; }, pool);
+}
+
+#endif
@@ -0,0 +1,541 @@
+/**
+ * @file ring_queue.h
+ * @author Odin's Ravens
+ * @date April 25, 2025
+ * @brief Header-only bounded lock-free ring queues for producer/consumer pipelines.
+ *
+ * Two fixed-capacity flavours sit alongside the unbounded Deque:
+ * - SpscRingQueue: one producer thread, one consumer thread. Each side owns one
+ *   index and keeps a cached copy of the other, so the shared cache lines are only
+ *   touched when the cached copy says the queue looks full (or empty).
+ * - MpmcRingQueue: any number of producers and consumers, after Dmitry Vyukov's
+ *   bounded MPMC queue. Every cell carries a sequence number that says whose turn it is.
+ *
+ * Both round the capacity up to a power of two, keep head and tail on separate cache
+ * lines, offer batch enqueue/dequeue, and provide blocking push()/pop() that spin
+ * briefly and then yield while waiting. Storage is uninitialized, like the Deque's
+ * blocks: elements are constructed on push and destroyed on pop.
+ *
+ * Course: CSCI 325 — Data Structures and Algorithms
+ */
+
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "deque.h"
+
+/**
+ * @brief Waits a little longer each call: a short spin, then yields the CPU.
+ * @param spins Number of times the caller has waited so far; incremented here.
+ */
+inline void ringQueueBackoff(int& spins) {
+    if (++spins > 64)
+        std::this_thread::yield();
+}
+
+/**
+ * @brief Rounds a requested capacity up to a power of two (at least 2).
+ * @param requested The requested capacity.
+ * @return The capacity actually used.
+ */
+inline std::size_t ringQueueCapacity(std::size_t requested) {
+    std::size_t capacity = 2;
+    while (capacity < requested)
+        capacity *= 2;
+    return capacity;
+}
+
+/**
+ * @class SpscRingQueue
+ * @brief Bounded lock-free single-producer/single-consumer ring queue.
+ *
+ * Push calls may only come from one producer thread and pop calls from one consumer thread.
+ *
+ * @tparam T The element type.
+ */
+template <typename T>
+class SpscRingQueue {
+private:
+    // Number of slots (a power of two) and the matching index mask
+    const std::size_t capacity;
+    const std::size_t mask;
+
+    // Uninitialized slot storage
+    T* slots;
+
+    // Consumer side: next slot to pop, and the producer's tail as last seen by the consumer
+    alignas(DEQUE_CACHE_LINE) std::atomic<std::size_t> head;
+    std::size_t cachedTail;
+
+    // Producer side: next slot to push, and the consumer's head as last seen by the producer
+    alignas(DEQUE_CACHE_LINE) std::atomic<std::size_t> tail;
+    std::size_t cachedHead;
+
+    /**
+     * @brief Gets the number of free slots from the producer's point of view.
+     * @param t The producer's current tail.
+     * @param wanted Refresh the cached head only if fewer than this many are free.
+     * @return The number of free slots.
+     */
+    std::size_t freeSlots(std::size_t t, std::size_t wanted);
+
+    /**
+     * @brief Gets the number of filled slots from the consumer's point of view.
+     * @param h The consumer's current head.
+     * @param wanted Refresh the cached tail only if fewer than this many are filled.
+     * @return The number of filled slots.
+     */
+    std::size_t filledSlots(std::size_t h, std::size_t wanted);
+
+public:
+    /**
+     * @brief Constructs an empty queue.
+     * @param requestedCapacity Minimum number of elements it must hold (rounded up to a power of two).
+     */
+    explicit SpscRingQueue(std::size_t requestedCapacity);
+
+    /**
+     * @brief Destructor. Destroys any remaining elements.
+     */
+    ~SpscRingQueue();
+
+    SpscRingQueue(const SpscRingQueue&) = delete;
+    SpscRingQueue& operator=(const SpscRingQueue&) = delete;
+
+    /**
+     * @brief Adds an element if there is room. Producer thread only.
+     * @param value The value to add.
+     * @return True if the element was added; false if the queue was full.
+     */
+    template <typename U>
+    bool try_push(U&& value);
+
+    /**
+     * @brief Removes the oldest element if there is one. Consumer thread only.
+     * @param out Receives the element on success.
+     * @return True if an element was removed; false if the queue was empty.
+     */
+    bool try_pop(T& out);
+
+    /**
+     * @brief Adds up to n elements, as many as there is room for. Producer thread only.
+     * @param values First element to copy.
+     * @param n Number of elements offered.
+     * @return Number of elements added (a prefix of values).
+     */
+    std::size_t try_push_n(const T* values, std::size_t n);
+
+    /**
+     * @brief Removes up to n of the oldest elements. Consumer thread only.
+     * @param out Array with room for n elements.
+     * @param n Most elements to remove.
+     * @return Number of elements removed.
+     */
+    std::size_t try_pop_n(T* out, std::size_t n);
+
+    /**
+     * @brief Adds an element, waiting while the queue is full. Producer thread only.
+     * @param value The value to add.
+     */
+    template <typename U>
+    void push(U&& value);
+
+    /**
+     * @brief Removes the oldest element, waiting while the queue is empty. Consumer thread only.
+     * @param out Receives the element.
+     */
+    void pop(T& out);
+
+    /**
+     * @brief Gets an estimate of the number of queued elements.
+     * @return The approximate size (exact when neither side is active).
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Gets the number of elements the queue can hold.
+     * @return The capacity (a power of two).
+     */
+    std::size_t max_size() const;
+};
+
+/**
+ * @class MpmcRingQueue
+ * @brief Bounded lock-free multi-producer/multi-consumer ring queue.
+ *
+ * @tparam T The element type.
+ */
+template <typename T>
+class MpmcRingQueue {
+private:
+    /**
+     * @struct Cell
+     * @brief One slot: a sequence number that says whose turn it is, and the element storage.
+     *
+     * sequence == position: free for the producer claiming that position.
+     * sequence == position + 1: holds an element for the consumer claiming that position.
+     */
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T* element() { return std::launder(reinterpret_cast<T*>(&storage)); }
+    };
+
+    // Number of cells (a power of two) and the matching index mask
+    const std::size_t capacity;
+    const std::size_t mask;
+
+    // Cell array
+    Cell* cells;
+
+    // Next position producers claim, on its own cache line
+    alignas(DEQUE_CACHE_LINE) std::atomic<std::size_t> enqueuePos;
+
+    // Next position consumers claim, on its own cache line
+    alignas(DEQUE_CACHE_LINE) std::atomic<std::size_t> dequeuePos;
+
+public:
+    /**
+     * @brief Constructs an empty queue.
+     * @param requestedCapacity Minimum number of elements it must hold (rounded up to a power of two).
+     */
+    explicit MpmcRingQueue(std::size_t requestedCapacity);
+
+    /**
+     * @brief Destructor. Destroys any remaining elements. No thread may still be using the queue.
+     */
+    ~MpmcRingQueue();
+
+    MpmcRingQueue(const MpmcRingQueue&) = delete;
+    MpmcRingQueue& operator=(const MpmcRingQueue&) = delete;
+
+    /**
+     * @brief Adds an element if there is room.
+     * @param value The value to add.
+     * @return True if the element was added; false if the queue was full.
+     */
+    template <typename U>
+    bool try_push(U&& value);
+
+    /**
+     * @brief Removes the oldest element if there is one.
+     * @param out Receives the element on success.
+     * @return True if an element was removed; false if the queue was empty.
+     */
+    bool try_pop(T& out);
+
+    /**
+     * @brief Adds up to n elements, claiming a run of free cells with a single CAS.
+     * @param values First element to copy.
+     * @param n Number of elements offered.
+     * @return Number of elements added (a prefix of values).
+     */
+    std::size_t try_push_n(const T* values, std::size_t n);
+
+    /**
+     * @brief Removes up to n elements, claiming a run of filled cells with a single CAS.
+     * @param out Array with room for n elements.
+     * @param n Most elements to remove.
+     * @return Number of elements removed, in queue order.
+     */
+    std::size_t try_pop_n(T* out, std::size_t n);
+
+    /**
+     * @brief Adds an element, waiting while the queue is full.
+     * @param value The value to add.
+     */
+    template <typename U>
+    void push(U&& value);
+
+    /**
+     * @brief Removes the oldest element, waiting while the queue is empty.
+     * @param out Receives the element.
+     */
+    void pop(T& out);
+
+    /**
+     * @brief Gets an estimate of the number of queued elements.
+     * @return The approximate size (exact when no thread is active).
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Gets the number of elements the queue can hold.
+     * @return The capacity (a power of two).
+     */
+    std::size_t max_size() const;
+};
+
+template <typename T>
+SpscRingQueue<T>::SpscRingQueue(std::size_t requestedCapacity)
+    : capacity(ringQueueCapacity(requestedCapacity)), mask(capacity - 1),
+      head(0), cachedTail(0), tail(0), cachedHead(0) {
+    slots = static_cast<T*>(::operator new(sizeof(T) * capacity, std::align_val_t(alignof(T))));
+}
+
+template <typename T>
+SpscRingQueue<T>::~SpscRingQueue() {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    for (std::size_t h = head.load(std::memory_order_relaxed); h != t; ++h)
+        slots[h & mask].~T();
+    ::operator delete(slots, std::align_val_t(alignof(T)));
+}
+
+template <typename T>
+std::size_t SpscRingQueue<T>::freeSlots(std::size_t t, std::size_t wanted) {
+    std::size_t available = capacity - (t - cachedHead);
+    if (available < wanted) {
+        cachedHead = head.load(std::memory_order_acquire);
+        available = capacity - (t - cachedHead);
+    }
+    return available;
+}
+
+template <typename T>
+std::size_t SpscRingQueue<T>::filledSlots(std::size_t h, std::size_t wanted) {
+    std::size_t available = cachedTail - h;
+    if (available < wanted) {
+        cachedTail = tail.load(std::memory_order_acquire);
+        available = cachedTail - h;
+    }
+    return available;
+}
+
+template <typename T>
+template <typename U>
+bool SpscRingQueue<T>::try_push(U&& value) {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    if (freeSlots(t, 1) == 0) return false;
+
+    ::new (static_cast<void*>(slots + (t & mask))) T(std::forward<U>(value));
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool SpscRingQueue<T>::try_pop(T& out) {
+    std::size_t h = head.load(std::memory_order_relaxed);
+    if (filledSlots(h, 1) == 0) return false;
+
+    T* slot = slots + (h & mask);
+    out = std::move(*slot);
+    slot->~T();
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+std::size_t SpscRingQueue<T>::try_push_n(const T* values, std::size_t n) {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    std::size_t count = freeSlots(t, n);
+    if (count > n) count = n;
+
+    for (std::size_t i = 0; i < count; ++i)
+        ::new (static_cast<void*>(slots + ((t + i) & mask))) T(values[i]);
+    tail.store(t + count, std::memory_order_release);
+    return count;
+}
+
+template <typename T>
+std::size_t SpscRingQueue<T>::try_pop_n(T* out, std::size_t n) {
+    std::size_t h = head.load(std::memory_order_relaxed);
+    std::size_t count = filledSlots(h, n);
+    if (count > n) count = n;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        T* slot = slots + ((h + i) & mask);
+        out[i] = std::move(*slot);
+        slot->~T();
+    }
+    head.store(h + count, std::memory_order_release);
+    return count;
+}
+
+template <typename T>
+template <typename U>
+void SpscRingQueue<T>::push(U&& value) {
+    int spins = 0;
+    while (!try_push(std::forward<U>(value)))
+        ringQueueBackoff(spins);
+}
+
+template <typename T>
+void SpscRingQueue<T>::pop(T& out) {
+    int spins = 0;
+    while (!try_pop(out))
+        ringQueueBackoff(spins);
+}
+
+template <typename T>
+std::size_t SpscRingQueue<T>::size() const {
+    // head first: it never passes the tail read after it, so the difference can't wrap
+    std::size_t start = head.load(std::memory_order_acquire);
+    std::size_t end = tail.load(std::memory_order_acquire);
+    return std::min(end - start, capacity);
+}
+
+template <typename T>
+std::size_t SpscRingQueue<T>::max_size() const {
+    return capacity;
+}
+
+template <typename T>
+MpmcRingQueue<T>::MpmcRingQueue(std::size_t requestedCapacity)
+    : capacity(ringQueueCapacity(requestedCapacity)), mask(capacity - 1),
+      enqueuePos(0), dequeuePos(0) {
+    cells = new Cell[capacity];
+    for (std::size_t i = 0; i < capacity; ++i)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+MpmcRingQueue<T>::~MpmcRingQueue() {
+    std::size_t end = enqueuePos.load(std::memory_order_relaxed);
+    for (std::size_t pos = dequeuePos.load(std::memory_order_relaxed); pos != end; ++pos)
+        cells[pos & mask].element()->~T();
+    delete[] cells;
+}
+
+template <typename T>
+template <typename U>
+bool MpmcRingQueue<T>::try_push(U&& value) {
+    std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[pos & mask];
+        std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - pos);
+
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                ::new (static_cast<void*>(&cell.storage)) T(std::forward<U>(value));
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // The cell still holds the element from one lap ago: full
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+bool MpmcRingQueue<T>::try_pop(T& out) {
+    std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[pos & mask];
+        std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+
+        if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                T* element = cell.element();
+                out = std::move(*element);
+                element->~T();
+                cell.sequence.store(pos + capacity, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // Nothing published at this position yet: empty
+            return false;
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+std::size_t MpmcRingQueue<T>::try_push_n(const T* values, std::size_t n) {
+    std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        // Count the run of cells free for positions pos, pos + 1, ...
+        std::size_t count = 0;
+        while (count < n && count < capacity &&
+               cells[(pos + count) & mask].sequence.load(std::memory_order_acquire) == pos + count)
+            ++count;
+
+        if (count == 0) {
+            std::size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+            if (static_cast<std::ptrdiff_t>(seq - pos) < 0) return 0;
+            pos = enqueuePos.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (enqueuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+            for (std::size_t i = 0; i < count; ++i) {
+                Cell& cell = cells[(pos + i) & mask];
+                ::new (static_cast<void*>(&cell.storage)) T(values[i]);
+                cell.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+            return count;
+        }
+    }
+}
+
+template <typename T>
+std::size_t MpmcRingQueue<T>::try_pop_n(T* out, std::size_t n) {
+    std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        // Count the run of cells published for positions pos, pos + 1, ...
+        std::size_t count = 0;
+        while (count < n && count < capacity &&
+               cells[(pos + count) & mask].sequence.load(std::memory_order_acquire) == pos + count + 1)
+            ++count;
+
+        if (count == 0) {
+            std::size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+            if (static_cast<std::ptrdiff_t>(seq - (pos + 1)) < 0) return 0;
+            pos = dequeuePos.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (dequeuePos.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+            for (std::size_t i = 0; i < count; ++i) {
+                Cell& cell = cells[(pos + i) & mask];
+                T* element = cell.element();
+                out[i] = std::move(*element);
+                element->~T();
+                cell.sequence.store(pos + i + capacity, std::memory_order_release);
+            }
+            return count;
+        }
+    }
+}
+
+template <typename T>
+template <typename U>
+void MpmcRingQueue<T>::push(U&& value) {
+    int spins = 0;
+    while (!try_push(std::forward<U>(value)))
+        ringQueueBackoff(spins);
+}
+
+template <typename T>
+void MpmcRingQueue<T>::pop(T& out) {
+    int spins = 0;
+    while (!try_pop(out))
+        ringQueueBackoff(spins);
+}
+
+template <typename T>
+std::size_t MpmcRingQueue<T>::size() const {
+    std::size_t end = enqueuePos.load(std::memory_order_acquire);
+    std::size_t start = dequeuePos.load(std::memory_order_acquire);
+    return end > start ? end - start : 0;
+}
+
+template <typename T>
+std::size_t MpmcRingQueue<T>::max_size() const {
+    return capacity;
+}
+
+#endif
@@ -0,0 +1,596 @@
+/**
+ * @file spilling_deque.h
+ * @author Odin's Ravens
+ * @date April 25, 2025
+ * @brief Header-only deque that pages its cold middle blocks out to a memory-mapped file.
+ *
+ * Only a window of blocks at each end stays on the heap. When an end grows past its
+ * window, the block at the inner edge of the window is copied into a slot of a backing
+ * file and its heap memory is reused, so resident memory stays bounded no matter how
+ * long the queue gets. As an end shrinks toward the spilled blocks, the kernel is asked
+ * to read the next one ahead (madvise WILLNEED), and it is copied back to the heap when
+ * it becomes the end block.
+ *
+ * A window has to grow by hotBlocks - 1 blocks between a load and the next spill at the
+ * same end, so pushing and popping across one block edge never thrashes, and push/pop
+ * at both ends stay amortized O(1).
+ *
+ * The backing file is created in a caller-chosen directory and unlinked at once, so
+ * it disappears when the deque is destroyed or the process exits.
+ *
+ * Course: CSCI 325 — Data Structures and Algorithms
+ */
+
+#ifndef SPILLING_DEQUE_H
+#define SPILLING_DEQUE_H
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "deque.h"
+
+/**
+ * @class SpillingDeque
+ * @brief A double-ended queue for backlogs larger than RAM.
+ *
+ * Push and pop at both ends like Deque. Elements in spilled blocks can still be read
+ * through operator[] (the read goes through the file mapping).
+ *
+ * @tparam T The element type. Must be trivially copyable, because blocks are copied
+ *         to and from the backing file as raw bytes.
+ * @tparam BlockSize Number of elements per block; must be a power of two.
+ */
+template <typename T, int BlockSize = BlockBytes<T>::value>
+class SpillingDeque {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SpillingDeque elements must be trivially copyable");
+    static_assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0,
+                  "SpillingDeque BlockSize must be a power of two");
+
+private:
+    // Number of elements per block, and the shift/mask that split a position
+    static const int BLOCK_SIZE = BlockSize;
+    static const int BLOCK_SHIFT = dequeLog2(BlockSize);
+    static const long long BLOCK_MASK = BlockSize - 1;
+
+    // Bytes and alignment of one in-memory block
+    static const std::size_t BLOCK_BYTES = sizeof(T) * BlockSize;
+    static const std::size_t BLOCK_ALIGN = alignof(T) > DEQUE_CACHE_LINE ? alignof(T) : DEQUE_CACHE_LINE;
+
+    // File slots mapped at a time; the file grows one segment of slots at a time
+    static const long long SEGMENT_SLOTS = 256;
+
+    // A window this many blocks deep or shallower prefetches the next spilled block
+    static const int PREFETCH_DISTANCE = 2;
+
+    /**
+     * @struct Block
+     * @brief One block of the deque: on the heap (data) or in a file slot (slot).
+     */
+    struct Block {
+        // Heap storage while resident, nullptr while spilled
+        T* data;
+
+        // File slot while spilled, -1 while resident
+        long long slot;
+    };
+
+    // Blocks from front to back; spilled blocks are exactly [spillBegin, spillEnd)
+    Deque<Block> blocks;
+    int spillBegin;
+    int spillEnd;
+
+    // Index within the front block where the front element starts
+    int frontIndex;
+
+    // Total number of elements
+    long long count;
+
+    // Most blocks kept on the heap at each end
+    int hotBlocks;
+
+    // Backing file, its mapped segments, and file slots free for reuse
+    int fd;
+    std::size_t slotBytes;
+    std::vector<char*> segments;
+    std::vector<long long> freeSlots;
+    long long slotCount;
+
+    // One heap block kept for reuse between a spill and the next new block
+    T* spare;
+
+    // Blocks written to and read back from the backing file
+    long long spills;
+    long long loads;
+
+    /**
+     * @brief Gets a heap block, reusing the spare if there is one.
+     * @return Uninitialized storage for BLOCK_SIZE elements.
+     */
+    T* acquireBlock();
+
+    /**
+     * @brief Returns a heap block, keeping it as the spare if that slot is free.
+     * @param block The block to release.
+     */
+    void releaseBlock(T* block);
+
+    /**
+     * @brief Gets the mapped address of a file slot.
+     * @param slot Slot number.
+     * @return Pointer to the first element stored in that slot.
+     */
+    T* slotAddress(long long slot) const;
+
+    /**
+     * @brief Takes a free file slot, growing the file by one segment if needed.
+     * @return The slot number.
+     */
+    long long acquireSlot();
+
+    /**
+     * @brief Writes a resident block to a file slot and frees its heap memory.
+     * @param index Position of the block in blocks.
+     */
+    void spill(int index);
+
+    /**
+     * @brief Reads a spilled block back onto the heap and frees its file slot.
+     * @param index Position of the block in blocks.
+     */
+    void load(int index);
+
+    /**
+     * @brief Asks the kernel to start reading a spilled block ahead of its load.
+     * @param index Position of the block in blocks.
+     */
+    void prefetch(int index) const;
+
+    /**
+     * @brief Adds an empty block at the back, spilling the back window's inner block
+     *        if the window is full.
+     */
+    void addBackBlock();
+
+    /**
+     * @brief Adds an empty block at the front, spilling the front window's inner block
+     *        if the window is full.
+     */
+    void addFrontBlock();
+
+    /**
+     * @brief Drops the (emptied) front block, loading the next one if it was spilled.
+     */
+    void removeFrontBlock();
+
+    /**
+     * @brief Drops the (emptied) back block, loading the previous one if it was spilled.
+     */
+    void removeBackBlock();
+
+    /**
+     * @brief Computes the address of the element at a logical index.
+     * @param index Index of the element (0-based).
+     * @return Pointer to the element, on the heap or in the file mapping.
+     */
+    T* slot(long long index) const;
+
+public:
+    /**
+     * @brief Constructs an empty deque with its backing file in the given directory.
+     * @param directory Directory for the (immediately unlinked) backing file.
+     * @param hotBlocks Most blocks kept on the heap at each end; at least 2.
+     * @throws std::system_error if the backing file cannot be created.
+     */
+    explicit SpillingDeque(const std::string& directory = ".", int hotBlocks = 4);
+
+    /**
+     * @brief Destructor. Frees all heap blocks, unmaps and closes the backing file.
+     */
+    ~SpillingDeque();
+
+    SpillingDeque(const SpillingDeque&) = delete;
+    SpillingDeque& operator=(const SpillingDeque&) = delete;
+
+    /**
+     * @brief Adds an element to the front of the deque.
+     * @param value The value to add.
+     * @throws std::system_error if the backing file cannot grow.
+     */
+    void push_front(const T& value);
+
+    /**
+     * @brief Adds an element to the back of the deque.
+     * @param value The value to add.
+     * @throws std::system_error if the backing file cannot grow.
+     */
+    void push_back(const T& value);
+
+    /**
+     * @brief Removes the front element from the deque.
+     */
+    void pop_front();
+
+    /**
+     * @brief Removes the back element from the deque.
+     */
+    void pop_back();
+
+    /**
+     * @brief Accesses the front element (always resident).
+     * @return Reference to the value at the front of the deque.
+     */
+    T& front();
+
+    /**
+     * @brief Accesses the back element (always resident).
+     * @return Reference to the value at the back of the deque.
+     */
+    T& back();
+
+    /**
+     * @brief Reads the element at a specific index, from the heap or the file mapping.
+     * @param index Index of the element (0-based).
+     * @return Reference to the element, invalidated by any push or pop.
+     */
+    const T& operator[](long long index) const;
+
+    /**
+     * @brief Checks whether the deque is empty.
+     * @return True if the deque is empty; false otherwise.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Gets the current number of elements in the deque.
+     * @return The number of stored elements.
+     */
+    long long size() const;
+
+    /**
+     * @brief Gets the number of elements per block.
+     * @return The compile-time block size (a power of two).
+     */
+    static constexpr int block_size() { return BLOCK_SIZE; }
+
+    /**
+     * @brief Gets the most blocks kept on the heap at each end.
+     * @return The hot window size in blocks.
+     */
+    int hot_blocks() const;
+
+    /**
+     * @brief Gets the number of blocks currently on the heap (at most 2 * hot_blocks()).
+     * @return The number of resident blocks.
+     */
+    int resident_blocks() const;
+
+    /**
+     * @brief Gets the number of blocks currently in the backing file.
+     * @return The number of spilled blocks.
+     */
+    int spilled_blocks() const;
+
+    /**
+     * @brief Gets how many blocks have been written to the backing file so far.
+     * @return The number of spills.
+     */
+    long long block_spills() const;
+
+    /**
+     * @brief Gets how many blocks have been read back from the backing file so far.
+     * @return The number of loads.
+     */
+    long long block_loads() const;
+
+    /**
+     * @brief Gets the current size of the backing file.
+     * @return The file size in bytes.
+     */
+    long long backing_file_bytes() const;
+};
+
+template <typename T, int BlockSize>
+SpillingDeque<T, BlockSize>::SpillingDeque(const std::string& directory, int hotBlocks)
+    : spillBegin(0), spillEnd(0), frontIndex(0), count(0), hotBlocks(hotBlocks),
+      slotCount(0), spare(nullptr), spills(0), loads(0) {
+    assert(hotBlocks >= 2 && "SpillingDeque needs at least 2 hot blocks per end");
+
+    std::string path = directory + "/spilling_deque.XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    fd = mkstemp(name.data());
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "SpillingDeque: cannot create " + path);
+    unlink(name.data());
+
+    // Slots are whole pages so each can be mapped, advised and dropped on its own
+    std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    slotBytes = (BLOCK_BYTES + page - 1) / page * page;
+}
+
+template <typename T, int BlockSize>
+SpillingDeque<T, BlockSize>::~SpillingDeque() {
+    for (int i = 0; i < blocks.size(); ++i) {
+        if (blocks[i].data != nullptr)
+            ::operator delete(blocks[i].data, std::align_val_t(BLOCK_ALIGN));
+    }
+    if (spare != nullptr)
+        ::operator delete(spare, std::align_val_t(BLOCK_ALIGN));
+    for (char* segment : segments)
+        munmap(segment, SEGMENT_SLOTS * slotBytes);
+    close(fd);
+}
+
+template <typename T, int BlockSize>
+T* SpillingDeque<T, BlockSize>::acquireBlock() {
+    if (spare != nullptr) {
+        T* block = spare;
+        spare = nullptr;
+        return block;
+    }
+    return static_cast<T*>(::operator new(BLOCK_BYTES, std::align_val_t(BLOCK_ALIGN)));
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::releaseBlock(T* block) {
+    if (spare == nullptr)
+        spare = block;
+    else
+        ::operator delete(block, std::align_val_t(BLOCK_ALIGN));
+}
+
+template <typename T, int BlockSize>
+T* SpillingDeque<T, BlockSize>::slotAddress(long long slot) const {
+    return reinterpret_cast<T*>(segments[slot / SEGMENT_SLOTS] + (slot % SEGMENT_SLOTS) * slotBytes);
+}
+
+template <typename T, int BlockSize>
+long long SpillingDeque<T, BlockSize>::acquireSlot() {
+    if (!freeSlots.empty()) {
+        long long slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    if (slotCount % SEGMENT_SLOTS == 0) {
+        // Extend the file and map the new segment; earlier segments never move
+        off_t offset = static_cast<off_t>(segments.size() * SEGMENT_SLOTS * slotBytes);
+        std::size_t length = SEGMENT_SLOTS * slotBytes;
+        if (ftruncate(fd, offset + static_cast<off_t>(length)) != 0)
+            throw std::system_error(errno, std::generic_category(), "SpillingDeque: cannot grow backing file");
+        void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+        if (mapped == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), "SpillingDeque: cannot map backing file");
+        segments.push_back(static_cast<char*>(mapped));
+    }
+    return slotCount++;
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::spill(int index) {
+    Block& block = blocks[index];
+    long long slot = acquireSlot();
+    std::memcpy(static_cast<void*>(slotAddress(slot)), block.data, BLOCK_BYTES);
+
+    // The page stays in the page cache as a dirty file page, which the kernel can
+    // write back and evict; unmapping it here keeps it out of our resident set
+    madvise(slotAddress(slot), slotBytes, MADV_DONTNEED);
+
+    releaseBlock(block.data);
+    block.data = nullptr;
+    block.slot = slot;
+    spills++;
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::load(int index) {
+    Block& block = blocks[index];
+    block.data = acquireBlock();
+    std::memcpy(static_cast<void*>(block.data), slotAddress(block.slot), BLOCK_BYTES);
+    madvise(slotAddress(block.slot), slotBytes, MADV_DONTNEED);
+
+    freeSlots.push_back(block.slot);
+    block.slot = -1;
+    loads++;
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::prefetch(int index) const {
+    madvise(slotAddress(blocks[index].slot), slotBytes, MADV_WILLNEED);
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::addBackBlock() {
+    // Spill first, so a failed spill leaves the deque unchanged and the new block
+    // can reuse the heap memory it frees
+    int n = blocks.size() + 1;
+    if (spillBegin < spillEnd) {
+        if (n - spillEnd > hotBlocks) {
+            spill(spillEnd);
+            ++spillEnd;
+        }
+    } else if (n > 2 * hotBlocks) {
+        // Nothing spilled yet: split into a full front window and a full back window
+        spill(n - 1 - hotBlocks);
+        spillBegin = n - 1 - hotBlocks;
+        spillEnd = spillBegin + 1;
+    }
+    blocks.push_back(Block{acquireBlock(), -1});
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::addFrontBlock() {
+    // Indices are before the new block is added, which shifts them all up by one
+    int n = blocks.size() + 1;
+    if (spillBegin < spillEnd) {
+        if (spillBegin + 1 > hotBlocks) {
+            spill(spillBegin - 1);
+            --spillBegin;
+        }
+    } else if (n > 2 * hotBlocks) {
+        spill(hotBlocks - 1);
+        spillBegin = hotBlocks - 1;
+        spillEnd = hotBlocks;
+    }
+    blocks.push_front(Block{acquireBlock(), -1});
+    if (spillBegin < spillEnd) {
+        ++spillBegin;
+        ++spillEnd;
+    }
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::removeFrontBlock() {
+    releaseBlock(blocks.front().data);
+    blocks.pop_front();
+    if (spillBegin == spillEnd) return;
+
+    // The released block is now the spare, so loading cannot fail
+    --spillBegin;
+    --spillEnd;
+    if (spillBegin == 0) {
+        load(0);
+        spillBegin = 1;
+    }
+    if (spillBegin == spillEnd)
+        spillBegin = spillEnd = 0;
+    else if (spillBegin <= PREFETCH_DISTANCE)
+        prefetch(spillBegin);
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::removeBackBlock() {
+    releaseBlock(blocks.back().data);
+    blocks.pop_back();
+    if (spillBegin == spillEnd) return;
+
+    int n = blocks.size();
+    if (spillEnd == n) {
+        load(n - 1);
+        spillEnd = n - 1;
+    }
+    if (spillBegin == spillEnd)
+        spillBegin = spillEnd = 0;
+    else if (n - spillEnd <= PREFETCH_DISTANCE)
+        prefetch(spillEnd - 1);
+}
+
+template <typename T, int BlockSize>
+T* SpillingDeque<T, BlockSize>::slot(long long index) const {
+    long long absolute = frontIndex + index;
+    const Block& block = blocks[static_cast<int>(absolute >> BLOCK_SHIFT)];
+    T* base = block.data != nullptr ? block.data : slotAddress(block.slot);
+    return base + (absolute & BLOCK_MASK);
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::push_front(const T& value) {
+    if (frontIndex == 0) {
+        addFrontBlock();
+        frontIndex = BLOCK_SIZE;
+    }
+    --frontIndex;
+    blocks.front().data[frontIndex] = value;
+    count++;
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::push_back(const T& value) {
+    long long end = frontIndex + count;
+    if ((end >> BLOCK_SHIFT) == blocks.size()) addBackBlock();
+    blocks.back().data[end & BLOCK_MASK] = value;
+    count++;
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::pop_front() {
+    assert(!empty() && "pop_front() called on empty deque");
+
+    ++frontIndex;
+    --count;
+    if (count == 0 || frontIndex == BLOCK_SIZE) {
+        removeFrontBlock();
+        frontIndex = 0;
+    }
+}
+
+template <typename T, int BlockSize>
+void SpillingDeque<T, BlockSize>::pop_back() {
+    assert(!empty() && "pop_back() called on empty deque");
+
+    --count;
+    if (count == 0) {
+        removeBackBlock();
+        frontIndex = 0;
+    } else if (((frontIndex + count) & BLOCK_MASK) == 0) {
+        removeBackBlock();
+    }
+}
+
+template <typename T, int BlockSize>
+T& SpillingDeque<T, BlockSize>::front() {
+    assert(!empty() && "front() called on empty deque");
+    return blocks.front().data[frontIndex];
+}
+
+template <typename T, int BlockSize>
+T& SpillingDeque<T, BlockSize>::back() {
+    assert(!empty() && "back() called on empty deque");
+    return blocks.back().data[(frontIndex + count - 1) & BLOCK_MASK];
+}
+
+template <typename T, int BlockSize>
+const T& SpillingDeque<T, BlockSize>::operator[](long long index) const {
+    assert(index >= 0 && index < count && "operator[] out of bounds");
+    return *slot(index);
+}
+
+template <typename T, int BlockSize>
+bool SpillingDeque<T, BlockSize>::empty() const {
+    return count == 0;
+}
+
+template <typename T, int BlockSize>
+long long SpillingDeque<T, BlockSize>::size() const {
+    return count;
+}
+
+template <typename T, int BlockSize>
+int SpillingDeque<T, BlockSize>::hot_blocks() const {
+    return hotBlocks;
+}
+
+template <typename T, int BlockSize>
+int SpillingDeque<T, BlockSize>::resident_blocks() const {
+    return blocks.size() - spilled_blocks();
+}
+
+template <typename T, int BlockSize>
+int SpillingDeque<T, BlockSize>::spilled_blocks() const {
+    return spillEnd - spillBegin;
+}
+
+template <typename T, int BlockSize>
+long long SpillingDeque<T, BlockSize>::block_spills() const {
+    return spills;
+}
+
+template <typename T, int BlockSize>
+long long SpillingDeque<T, BlockSize>::block_loads() const {
+    return loads;
+}
+
+template <typename T, int BlockSize>
+long long SpillingDeque<T, BlockSize>::backing_file_bytes() const {
+    return static_cast<long long>(segments.size() * SEGMENT_SLOTS * slotBytes);
+}
+
+#endif
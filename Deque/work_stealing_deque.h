@@ -0,0 +1,297 @@
+/**
+ * @file work_stealing_deque.h
+ * @author Odin's Ravens
+ * @date April 25, 2025
+ * @brief Header-only Chase-Lev work-stealing deque built on the Deque blockmap.
+ *
+ * One owner thread pushes and pops at the back (bottom) without locks, while any
+ * number of thief threads steal from the front (top) with a compare-and-swap.
+ * Memory orderings follow Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient
+ * Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ *
+ * Storage is a circular blockmap: logical slot i lives in block (i >> shift) modulo
+ * the map capacity. Growing allocates a map twice as large and re-slots the existing
+ * block pointers, so elements are never copied and thieves holding the old map still
+ * read the same blocks. Retired maps are kept until the deque is destroyed.
+ *
+ * Course: CSCI 325 — Data Structures and Algorithms
+ */
+
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include "deque.h"
+
+/**
+ * @class WorkStealingDeque
+ * @brief A lock-free single-owner, multi-thief deque for per-worker task queues.
+ *
+ * push() and pop() may only be called from the owner thread; steal(), size() and
+ * empty() may be called from any thread.
+ *
+ * @tparam T The element type. Must be trivially copyable (task pointers or handles),
+ *         because thieves may read a slot that the owner is about to reuse.
+ * @tparam BlockSize Number of elements per block; must be a power of two.
+ */
+template <typename T, int BlockSize = BlockBytes<T>::value>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "WorkStealingDeque elements must be trivially copyable");
+    static_assert(BlockSize > 0 && (BlockSize & (BlockSize - 1)) == 0,
+                  "WorkStealingDeque BlockSize must be a power of two");
+
+private:
+    // Number of elements per block, and the shift/mask that split a slot position
+    static const int BLOCK_SIZE = BlockSize;
+    static const int BLOCK_SHIFT = dequeLog2(BlockSize);
+    static const long long BLOCK_MASK = BlockSize - 1;
+
+    // Number of blocks in a new deque's blockmap (a power of two)
+    static const long long INITIAL_BLOCKS = 4;
+
+    /**
+     * @struct Blockmap
+     * @brief A circular map of block pointers; capacity is always a power of two.
+     */
+    struct Blockmap {
+        // Array of capacity block pointers
+        std::atomic<T>** blocks;
+
+        // Number of blocks in the map
+        long long capacity;
+
+        // The map this one replaced, freed when the deque is destroyed
+        Blockmap* retired;
+
+        /**
+         * @brief Gets the slot for a logical position.
+         * @param i Logical position (top or bottom index).
+         * @return The atomic slot holding that position.
+         */
+        std::atomic<T>& at(long long i) const {
+            return blocks[(i >> BLOCK_SHIFT) & (capacity - 1)][i & BLOCK_MASK];
+        }
+    };
+
+    // Steal end; only ever increases. Padded so thieves and the owner do not
+    // false-share the two indices.
+    alignas(DEQUE_CACHE_LINE) std::atomic<long long> top;
+
+    // Owner end: one past the last pushed element
+    alignas(DEQUE_CACHE_LINE) std::atomic<long long> bottom;
+
+    // Current blockmap; swapped by the owner when it grows
+    alignas(DEQUE_CACHE_LINE) std::atomic<Blockmap*> map;
+
+    /**
+     * @brief Allocates one block of element slots.
+     * @return Pointer to BLOCK_SIZE slots.
+     */
+    static std::atomic<T>* allocateBlock();
+
+    /**
+     * @brief Doubles the blockmap, re-slotting the existing blocks. Owner only.
+     * @param old The current blockmap.
+     * @param t Top index read by the owner (may be stale, which is conservative).
+     * @param b Bottom index.
+     * @return The new blockmap, already published.
+     */
+    Blockmap* grow(Blockmap* old, long long t, long long b);
+
+public:
+    /**
+     * @brief Constructs an empty work-stealing deque.
+     */
+    WorkStealingDeque();
+
+    /**
+     * @brief Destructor. Frees all blocks and blockmaps. No thread may still be using the deque.
+     */
+    ~WorkStealingDeque();
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief Pushes an element onto the back. Owner thread only.
+     * @param value The value to add.
+     */
+    void push(const T& value);
+
+    /**
+     * @brief Pops the most recently pushed element. Owner thread only.
+     * @param out Receives the element on success.
+     * @return True if an element was popped; false if the deque was empty.
+     */
+    bool pop(T& out);
+
+    /**
+     * @brief Steals the oldest element from the front. Safe from any thread.
+     * @param out Receives the element on success.
+     * @return True if an element was stolen; false if the deque was empty or another
+     *         thread won the race for the same element.
+     */
+    bool steal(T& out);
+
+    /**
+     * @brief Gets an estimate of the number of elements (exact when no thread is active).
+     * @return The approximate number of stored elements.
+     */
+    long long size() const;
+
+    /**
+     * @brief Checks whether the deque appears empty.
+     * @return True if no elements were visible at the time of the call.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Gets the number of blocks in the current blockmap.
+     * @return The current blockmap capacity.
+     */
+    long long blockmap_capacity() const;
+};
+
+template <typename T, int BlockSize>
+std::atomic<T>* WorkStealingDeque<T, BlockSize>::allocateBlock() {
+    return new std::atomic<T>[BLOCK_SIZE];
+}
+
+template <typename T, int BlockSize>
+WorkStealingDeque<T, BlockSize>::WorkStealingDeque() : top(0), bottom(0) {
+    Blockmap* initial = new Blockmap;
+    initial->capacity = INITIAL_BLOCKS;
+    initial->blocks = new std::atomic<T>*[INITIAL_BLOCKS];
+    for (long long i = 0; i < INITIAL_BLOCKS; ++i)
+        initial->blocks[i] = allocateBlock();
+    initial->retired = nullptr;
+    map.store(initial, std::memory_order_relaxed);
+}
+
+template <typename T, int BlockSize>
+WorkStealingDeque<T, BlockSize>::~WorkStealingDeque() {
+    // Every block lives in the current map; retired maps only own their pointer arrays
+    Blockmap* current = map.load(std::memory_order_relaxed);
+    for (long long i = 0; i < current->capacity; ++i)
+        delete[] current->blocks[i];
+
+    while (current != nullptr) {
+        Blockmap* next = current->retired;
+        delete[] current->blocks;
+        delete current;
+        current = next;
+    }
+}
+
+template <typename T, int BlockSize>
+typename WorkStealingDeque<T, BlockSize>::Blockmap*
+WorkStealingDeque<T, BlockSize>::grow(Blockmap* old, long long t, long long b) {
+    Blockmap* bigger = new Blockmap;
+    bigger->capacity = old->capacity * 2;
+    bigger->blocks = new std::atomic<T>*[bigger->capacity];
+    bigger->retired = old;
+    for (long long i = 0; i < bigger->capacity; ++i)
+        bigger->blocks[i] = nullptr;
+
+    // Blocks holding live positions [t, b] keep their contents and move to the slot
+    // their logical block number maps to in the bigger map
+    bool* moved = new bool[old->capacity]();
+    for (long long block = t >> BLOCK_SHIFT; block <= (b >> BLOCK_SHIFT); ++block) {
+        long long from = block & (old->capacity - 1);
+        bigger->blocks[block & (bigger->capacity - 1)] = old->blocks[from];
+        moved[from] = true;
+    }
+
+    // The remaining old blocks fill the free slots first, then fresh blocks
+    long long next = 0;
+    for (long long i = 0; i < bigger->capacity; ++i) {
+        if (bigger->blocks[i] != nullptr) continue;
+        while (next < old->capacity && moved[next]) ++next;
+        bigger->blocks[i] = next < old->capacity ? old->blocks[next++] : allocateBlock();
+    }
+    delete[] moved;
+
+    map.store(bigger, std::memory_order_release);
+    return bigger;
+}
+
+template <typename T, int BlockSize>
+void WorkStealingDeque<T, BlockSize>::push(const T& value) {
+    long long b = bottom.load(std::memory_order_relaxed);
+    long long t = top.load(std::memory_order_acquire);
+    Blockmap* m = map.load(std::memory_order_relaxed);
+
+    // Keep the live range within capacity - 1 blocks' worth of slots, so it never
+    // spans more logical blocks than the map has physical ones
+    if (b - t >= (m->capacity - 1) * BLOCK_SIZE)
+        m = grow(m, t, b);
+
+    m->at(b).store(value, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+template <typename T, int BlockSize>
+bool WorkStealingDeque<T, BlockSize>::pop(T& out) {
+    long long b = bottom.load(std::memory_order_relaxed) - 1;
+    Blockmap* m = map.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // Already empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    out = m->at(b).load(std::memory_order_relaxed);
+    if (t == b) {
+        // Last element: race the thieves for it
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                               std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+template <typename T, int BlockSize>
+bool WorkStealingDeque<T, BlockSize>::steal(T& out) {
+    long long t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b) return false;
+
+    Blockmap* m = map.load(std::memory_order_acquire);
+    T value = m->at(t).load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed))
+        return false;
+
+    out = value;
+    return true;
+}
+
+template <typename T, int BlockSize>
+long long WorkStealingDeque<T, BlockSize>::size() const {
+    long long b = bottom.load(std::memory_order_relaxed);
+    long long t = top.load(std::memory_order_relaxed);
+    return b > t ? b - t : 0;
+}
+
+template <typename T, int BlockSize>
+bool WorkStealingDeque<T, BlockSize>::empty() const {
+    return size() == 0;
+}
+
+template <typename T, int BlockSize>
+long long WorkStealingDeque<T, BlockSize>::blockmap_capacity() const {
+    return map.load(std::memory_order_relaxed)->capacity;
+}
+
+#endif
@@ -0,0 +1,206 @@
+/**
+ * @file Accumulator.cpp
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Implementation of the running totals
+ *
+ * one template for every sum type; 32-bit totals of unweighted frames use the
+ * vector kernels, the rest plain loops specialized by sample width
+ */
+
+
+#include "Accumulator.h"
+#include <cmath>
+#include <type_traits>
+
+using namespace std;
+
+/**
+ * @brief Reads sample k of a P6 layout raster
+ */
+template <size_t SampleBytes>
+static inline uint32_t sampleAt(const unsigned char* rgb, size_t k) {
+  return SampleBytes == 1 ? rgb[k] : (static_cast<uint32_t>(rgb[2 * k]) << 8) | rgb[2 * k + 1];
+}
+
+
+template <typename Sum>
+class PlaneAccumulator : public Accumulator {
+ private:
+  template <typename Other> friend class PlaneAccumulator;
+
+  typedef vector<Sum, AlignedAllocator<Sum>> SumPlane;
+  static const bool FLOATING = is_floating_point<Sum>::value;
+
+  SumPlane sums[3]; // red, green, blue
+  SumPlane errors[3]; // Kahan compensation, floating types only
+
+  /**
+   * @brief Adds one value to a sum, carrying the rounding error of floating
+   * sums to the next addition
+   */
+  inline void addValue(int channel, size_t i, Sum value) {
+    if (FLOATING) {
+      Sum& sum = sums[channel][i];
+      Sum& error = errors[channel][i];
+      Sum y = value - error;
+      Sum t = sum + y;
+      error = (t - sum) - y;
+      sum = t;
+    } else {
+      sums[channel][i] += value;
+    }
+  }
+
+  template <size_t SampleBytes>
+  void addSamples(const unsigned char* rgb, size_t count, Sum weight) {
+    for (size_t i = 0; i < count; i++) {
+      for (int c = 0; c < 3; c++) {
+        Sum value = static_cast<Sum>(sampleAt<SampleBytes>(rgb, i * 3 + c));
+        addValue(c, i, FLOATING ? value * weight : value);
+      }
+    }
+  }
+
+  template <typename Other>
+  void mergeFrom(const PlaneAccumulator<Other>& other) {
+    for (int c = 0; c < 3; c++) {
+      for (size_t i = 0; i < size(); i++) {
+        addValue(c, i, static_cast<Sum>(other.sums[c][i]));
+        if (FLOATING && PlaneAccumulator<Other>::FLOATING) {
+          // the other sum is too large by its error
+          addValue(c, i, -static_cast<Sum>(other.errors[c][i]));
+        }
+      }
+    }
+  }
+
+ public:
+  SumType type() const override {
+    return is_same<Sum, uint32_t>::value ? SUM_UINT32 : is_same<Sum, uint64_t>::value ? SUM_UINT64
+         : is_same<Sum, float>::value ? SUM_FLOAT : SUM_DOUBLE;
+  }
+
+  size_t size() const override { return sums[0].size(); }
+
+  void assign(size_t count) override {
+    for (int c = 0; c < 3; c++) {
+      sums[c].assign(count, 0);
+      if (FLOATING) {
+        errors[c].assign(count, 0);
+      }
+    }
+  }
+
+  unique_ptr<Accumulator> emptyLike() const override {
+    unique_ptr<Accumulator> empty(new PlaneAccumulator<Sum>());
+    empty->assign(size());
+    return empty;
+  }
+
+  void add(const unsigned char* rgb, size_t count, size_t sampleBytes, double weight) override {
+    if (is_same<Sum, uint32_t>::value) {
+      // the fast path: split straight into the 32-bit planes with the vector kernels
+      const StackKernels& kernels = bestKernels();
+      uint32_t* planes[3];
+      for (int c = 0; c < 3; c++) {
+        planes[c] = reinterpret_cast<uint32_t*>(sums[c].data());
+      }
+      (sampleBytes == 1 ? kernels.add8 : kernels.add16)(rgb, count, planes[0], planes[1], planes[2]);
+    } else if (sampleBytes == 1) {
+      addSamples<1>(rgb, count, static_cast<Sum>(weight));
+    } else {
+      addSamples<2>(rgb, count, static_cast<Sum>(weight));
+    }
+  }
+
+  void merge(const Accumulator& other) override {
+    switch (other.type()) {
+      case SUM_UINT32: mergeFrom(static_cast<const PlaneAccumulator<uint32_t>&>(other)); break;
+      case SUM_UINT64: mergeFrom(static_cast<const PlaneAccumulator<uint64_t>&>(other)); break;
+      case SUM_FLOAT: mergeFrom(static_cast<const PlaneAccumulator<float>&>(other)); break;
+      default: mergeFrom(static_cast<const PlaneAccumulator<double>&>(other)); break;
+    }
+  }
+
+  void average(double totalWeight, Plane& red, Plane& green, Plane& blue) const override {
+    Plane* out[3] = {&red, &green, &blue};
+    uint64_t divisor = totalWeight >= 1 ? static_cast<uint64_t>(llround(totalWeight)) : 1;
+    for (int c = 0; c < 3; c++) {
+      out[c]->resize(size());
+      uint32_t* values = out[c]->data();
+      if (is_same<Sum, uint32_t>::value) {
+        for (size_t i = 0; i < size(); i++) {
+          values[i] = static_cast<uint32_t>(sums[c][i]);
+        }
+        bestKernels().divide(values, size(), static_cast<uint32_t>(divisor));
+      } else if (!FLOATING) {
+        for (size_t i = 0; i < size(); i++) {
+          values[i] = static_cast<uint32_t>(static_cast<uint64_t>(sums[c][i]) / divisor);
+        }
+      } else {
+        double scale = totalWeight > 0 ? 1.0 / totalWeight : 0;
+        for (size_t i = 0; i < size(); i++) {
+          values[i] = static_cast<uint32_t>(llround(max(0.0, static_cast<double>(sums[c][i]) * scale)));
+        }
+      }
+    }
+  }
+
+  size_t sumBytes() const override { return sizeof(Sum); }
+  bool floating() const override { return FLOATING; }
+  const void* plane(int index) const override { return index < 3 ? sums[index].data() : errors[index - 3].data(); }
+  void* plane(int index) override { return index < 3 ? sums[index].data() : errors[index - 3].data(); }
+};
+
+
+/**
+ * @brief Gets the name of a sum type, as the --sum option spells it
+ *
+ * @param type The sum type
+ * @return The name
+ */
+const char* sumTypeName(SumType type) {
+  switch (type) {
+    case SUM_UINT32: return "uint32";
+    case SUM_UINT64: return "uint64";
+    case SUM_FLOAT: return "float";
+    case SUM_DOUBLE: return "double";
+    default: return "auto";
+  }
+}
+
+
+/**
+ * @brief Creates zeroed totals
+ *
+ * @param type The sum type; SUM_AUTO gives uint32
+ * @param count Pixels per channel
+ * @return The totals
+ */
+unique_ptr<Accumulator> makeAccumulator(SumType type, size_t count) {
+  unique_ptr<Accumulator> totals;
+  switch (type) {
+    case SUM_UINT64: totals.reset(new PlaneAccumulator<uint64_t>()); break;
+    case SUM_FLOAT: totals.reset(new PlaneAccumulator<float>()); break;
+    case SUM_DOUBLE: totals.reset(new PlaneAccumulator<double>()); break;
+    default: totals.reset(new PlaneAccumulator<uint32_t>()); break;
+  }
+  totals->assign(count);
+  return totals;
+}
+
+
+/**
+ * @brief Copies totals into a different sum type, e.g. to widen 32-bit totals
+ * before they would overflow
+ *
+ * @param from The totals to copy
+ * @param type The new sum type
+ * @return The converted totals
+ */
+unique_ptr<Accumulator> convertAccumulator(const Accumulator& from, SumType type) {
+  unique_ptr<Accumulator> to = makeAccumulator(type, from.size());
+  to->merge(from);
+  return to;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file Accumulator.h
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Header file for the running totals
+ *
+ * per-channel sums in a choice of widths: 32 and 64-bit integers, or float and
+ * double with Kahan compensation for weighted frames
+ */
+
+
+#ifndef ACCUMULATOR_H
+#define ACCUMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Kernels.h"
+
+using namespace std;
+
+// how the running totals are stored
+enum SumType {
+  SUM_AUTO,    // the narrowest type that is exact for the job (see narrowestSum)
+  SUM_UINT32,  // the SIMD kernels' 32-bit lanes
+  SUM_UINT64,
+  SUM_FLOAT,   // Kahan-compensated
+  SUM_DOUBLE   // Kahan-compensated
+};
+
+/**
+ * @brief The narrowest sum type that adds frames samples of up to maxColor
+ * without error. Unweighted sums are integers, so uint32 is exact until
+ * frames * maxColor passes 2^32 - 1 (16.8 million 8-bit frames, 65537 16-bit
+ * ones) and uint64 after that; weighted sums need floating point.
+ *
+ * @param frames The number of frames the totals will hold
+ * @param maxColor The largest sample value
+ * @param weighted True if frames carry weights
+ * @return The sum type
+ */
+constexpr SumType narrowestSum(uint64_t frames, uint32_t maxColor, bool weighted) {
+  return weighted ? SUM_DOUBLE : frames * maxColor <= UINT32_MAX ? SUM_UINT32 : SUM_UINT64;
+}
+
+static_assert(narrowestSum(16843009, 255, false) == SUM_UINT32, "8-bit stacks stay in 32-bit lanes");
+static_assert(narrowestSum(65538, 65535, false) == SUM_UINT64, "large 16-bit stacks widen");
+
+class Accumulator {
+ public:
+  virtual ~Accumulator() {}
+
+  virtual SumType type() const = 0;
+  virtual size_t size() const = 0; // pixels per channel
+  virtual void assign(size_t count) = 0; // resizes to count pixels, all zero
+  virtual unique_ptr<Accumulator> emptyLike() const = 0; // same type and size, all zero
+
+  // adds count interleaved RGB pixels, 1 byte or 2 bytes most significant first
+  // per sample (P6 layout), each times weight (always 1 for the integer types)
+  virtual void add(const unsigned char* rgb, size_t count, size_t sampleBytes, double weight) = 0;
+
+  // adds another accumulator of the same size, of any type
+  virtual void merge(const Accumulator& other) = 0;
+
+  // writes sum / totalWeight: truncated like integer division for the integer
+  // types, rounded to nearest for the floating ones
+  virtual void average(double totalWeight, Plane& red, Plane& green, Plane& blue) const = 0;
+
+  // raw access for checkpoints: sumBytes() bytes per value; planes 0 to 2 are
+  // the red, green and blue sums and, for the floating types, 3 to 5 their
+  // Kahan compensation (how much each sum is too large by)
+  virtual size_t sumBytes() const = 0;
+  virtual bool floating() const = 0;
+  int planeCount() const { return floating() ? 6 : 3; }
+  virtual const void* plane(int index) const = 0;
+  virtual void* plane(int index) = 0;
+};
+
+const char* sumTypeName(SumType type); // uint32, uint64, float or double
+unique_ptr<Accumulator> makeAccumulator(SumType type, size_t count); // zeroed totals of a concrete type
+unique_ptr<Accumulator> convertAccumulator(const Accumulator& from, SumType type); // the same totals in another type
+
+#endif // ACCUMULATOR_H
@@ -0,0 +1,85 @@
+/**
+ * @file BoundedQueue.h
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Header file for BoundedQueue
+ * 
+ * blocking first-in first-out queue with a fixed capacity, used to hand frames
+ * between the stages of the batch pipeline
+ */
+
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+template <typename T>
+class BoundedQueue {
+ private:
+  deque<T> items;
+  size_t capacity; // most items held before push blocks
+  bool closed; // no more pushes; pops drain what is left
+  mutex lock;
+  condition_variable notFull, notEmpty;
+
+ public:
+  explicit BoundedQueue(size_t maxItems) : capacity(maxItems > 0 ? maxItems : 1), closed(false) {}
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  /**
+   * @brief Adds an item, waiting while the queue is full
+   *
+   * @param item The item to add
+   * @return True if added, false if the queue was closed
+   */
+  bool push(T item) {
+    unique_lock<mutex> guard(lock);
+    notFull.wait(guard, [this] { return closed || items.size() < capacity; });
+    if (closed) {
+      return false;
+    }
+    items.push_back(move(item));
+    notEmpty.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Takes the oldest item, waiting while the queue is empty and open
+   *
+   * @param item Receives the item
+   * @return True if an item was taken, false once the queue is closed and empty
+   */
+  bool pop(T& item) {
+    unique_lock<mutex> guard(lock);
+    notEmpty.wait(guard, [this] { return closed || !items.empty(); });
+    if (items.empty()) {
+      return false;
+    }
+    item = move(items.front());
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Ends the queue: waiting and later pushes fail, pops drain the rest
+   */
+  void close() {
+    lock_guard<mutex> guard(lock);
+    closed = true;
+    notFull.notify_all();
+    notEmpty.notify_all();
+  }
+
+};
+
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,260 @@
+/**
+ * @file Checkpoint.cpp
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Implementation of the accumulator checkpoint
+ * 
+ * reading and writing the checkpoint file described in Checkpoint.h
+ */
+
+
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+const char CHECKPOINT_MAGIC[8] = {'S', 'T', 'A', 'C', 'K', 'C', 'K', 'P'};
+const size_t CHECKPOINT_HEADER_SIZE = 48;
+const size_t CHECKPOINT_V1_HEADER_SIZE = 40;
+
+/**
+ * @brief Stores a 32-bit value least significant byte first
+ *
+ * @param out Where to store the four bytes
+ * @param value The value
+ */
+static void put32(unsigned char* out, uint32_t value) {
+  out[0] = static_cast<unsigned char>(value);
+  out[1] = static_cast<unsigned char>(value >> 8);
+  out[2] = static_cast<unsigned char>(value >> 16);
+  out[3] = static_cast<unsigned char>(value >> 24);
+}
+
+
+/**
+ * @brief Loads a 32-bit value stored least significant byte first
+ *
+ * @param in The four bytes
+ * @return The value
+ */
+static uint32_t get32(const unsigned char* in) {
+  return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+
+/**
+ * @brief Stores a 64-bit value least significant byte first
+ *
+ * @param out Where to store the eight bytes
+ * @param value The value
+ */
+static void put64(unsigned char* out, uint64_t value) {
+  put32(out, static_cast<uint32_t>(value));
+  put32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+
+/**
+ * @brief Loads a 64-bit value stored least significant byte first
+ *
+ * @param in The eight bytes
+ * @return The value
+ */
+static uint64_t get64(const unsigned char* in) {
+  return get32(in) | (static_cast<uint64_t>(get32(in + 4)) << 32);
+}
+
+
+/**
+ * @brief Computes a CRC-32 (the IEEE polynomial used by zip and PNG) a byte at
+ * a time from a 256-entry table
+ *
+ * @param data The bytes
+ * @param size The number of bytes
+ * @param crc The CRC of the bytes before these, to checksum in pieces
+ * @return The CRC of everything so far
+ */
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc) {
+  static uint32_t table[256];
+  static bool ready = [] {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+    return true;
+  }();
+  (void)ready;
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+
+/**
+ * @brief Saves the running totals. The file is written next to filepath under
+ * a temporary name and renamed over it, so an interrupted run leaves the old
+ * checkpoint in place.
+ *
+ * @param filepath Where to save the checkpoint
+ * @param header The image header, frame count and total weight
+ * @param totals The sums
+ * @return True if saved, false otherwise
+ */
+bool writeCheckpoint(const string& filepath, const CheckpointHeader& header, const Accumulator& totals) {
+  unsigned char head[CHECKPOINT_HEADER_SIZE] = {};
+  memcpy(head, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+  put32(head + 8, CHECKPOINT_VERSION);
+  put32(head + 12, CHECKPOINT_HEADER_SIZE);
+  put32(head + 16, header.width);
+  put32(head + 20, header.height);
+  put32(head + 24, header.maxColor);
+  put32(head + 28, header.frames);
+  head[32] = header.magic.size() > 0 ? header.magic[0] : 'P';
+  head[33] = header.magic.size() > 1 ? header.magic[1] : '3';
+  head[34] = static_cast<unsigned char>(totals.sumBytes());
+  head[35] = totals.floating() ? 1 : 0;
+  uint64_t weightBits;
+  memcpy(&weightBits, &header.totalWeight, sizeof(weightBits));
+  put64(head + 36, weightBits);
+  put32(head + 44, crc32(head, 44));
+
+  string temporary = filepath + ".tmp";
+  ofstream file(temporary, ios::binary);
+  if (!file) {
+    cerr << "Error: Cannot create checkpoint " << temporary << endl;
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(head), sizeof(head));
+
+  // the sums (and compensation) go out in blocks, converted to little-endian
+  // on the way
+  const size_t block = 1 << 14;
+  size_t sumBytes = totals.sumBytes();
+  vector<unsigned char> buffer(block * sumBytes);
+  uint32_t crc = 0;
+  for (int p = 0; p < totals.planeCount(); p++) {
+    const unsigned char* values = static_cast<const unsigned char*>(totals.plane(p));
+    for (size_t start = 0; start < totals.size(); start += block) {
+      size_t count = min(block, totals.size() - start);
+      for (size_t i = 0; i < count; i++) {
+        const unsigned char* sum = values + (start + i) * sumBytes;
+        if (sumBytes == 4) {
+          uint32_t value;
+          memcpy(&value, sum, 4);
+          put32(buffer.data() + i * 4, value);
+        } else {
+          uint64_t value;
+          memcpy(&value, sum, 8);
+          put64(buffer.data() + i * 8, value);
+        }
+      }
+      crc = crc32(buffer.data(), count * sumBytes, crc);
+      file.write(reinterpret_cast<const char*>(buffer.data()), count * sumBytes);
+    }
+  }
+  unsigned char tail[4];
+  put32(tail, crc);
+  file.write(reinterpret_cast<const char*>(tail), sizeof(tail));
+  file.close();
+
+  if (!file || rename(temporary.c_str(), filepath.c_str()) != 0) {
+    cerr << "Error: Cannot write checkpoint " << filepath << endl;
+    remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+
+/**
+ * @brief Loads running totals saved by writeCheckpoint(), rejecting files of
+ * an unknown version, the wrong size, or with either checksum wrong
+ *
+ * @param filepath The checkpoint to load
+ * @param header Receives the image header, frame count and total weight
+ * @return The sums, in the type they were saved in, or null on failure
+ */
+unique_ptr<Accumulator> readCheckpoint(const string& filepath, CheckpointHeader& header) {
+  MappedFile file;
+  if (!file.open(filepath)) {
+    cerr << "Error: Cannot open checkpoint " << filepath << endl;
+    return nullptr;
+  }
+  const unsigned char* head = file.data();
+  if (file.size() < CHECKPOINT_V1_HEADER_SIZE || memcmp(head, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+    cerr << "Error: " << filepath << " is not a stack checkpoint" << endl;
+    return nullptr;
+  }
+  uint32_t version = get32(head + 8);
+  if (version != 1 && version != CHECKPOINT_VERSION) {
+    cerr << "Error: Checkpoint " << filepath << " is version " << version << ", this build reads versions 1 to "
+         << CHECKPOINT_VERSION << endl;
+    return nullptr;
+  }
+
+  size_t headerSize = version == 1 ? CHECKPOINT_V1_HEADER_SIZE : CHECKPOINT_HEADER_SIZE;
+  size_t crcAt = headerSize - 4;
+  if (file.size() < headerSize || get32(head + crcAt) != crc32(head, crcAt) || get32(head + 12) != headerSize) {
+    cerr << "Error: Checkpoint " << filepath << " has a damaged header" << endl;
+    return nullptr;
+  }
+
+  header.width = get32(head + 16);
+  header.height = get32(head + 20);
+  header.maxColor = get32(head + 24);
+  header.frames = get32(head + 28);
+  header.magic = string(reinterpret_cast<const char*>(head + 32), 2);
+  size_t sumBytes = head[34];
+  bool floating = version > 1 && head[35] == 1;
+  header.totalWeight = header.frames;
+  if (version > 1) {
+    uint64_t weightBits = get64(head + 36);
+    memcpy(&header.totalWeight, &weightBits, sizeof(weightBits));
+  }
+  if ((sumBytes != 4 && sumBytes != 8) || (version > 1 && head[35] > 1) || (version == 1 && sumBytes != 4)) {
+    cerr << "Error: Checkpoint " << filepath << " has a damaged header" << endl;
+    return nullptr;
+  }
+
+  size_t count = static_cast<size_t>(header.width) * header.height;
+  size_t planeBytes = count * sumBytes;
+  int planes = floating ? 6 : 3; // floating sums are followed by their compensation
+  if (file.size() != headerSize + planeBytes * planes + 4) {
+    cerr << "Error: Checkpoint " << filepath << " is " << file.size() << " bytes, expected "
+         << headerSize + planeBytes * planes + 4 << endl;
+    return nullptr;
+  }
+  const unsigned char* sums = head + headerSize;
+  if (get32(sums + planeBytes * planes) != crc32(sums, planeBytes * planes)) {
+    cerr << "Error: Checkpoint " << filepath << " is corrupt (checksum mismatch)" << endl;
+    return nullptr;
+  }
+
+  SumType type = floating ? (sumBytes == 4 ? SUM_FLOAT : SUM_DOUBLE) : (sumBytes == 4 ? SUM_UINT32 : SUM_UINT64);
+  unique_ptr<Accumulator> totals = makeAccumulator(type, count);
+  for (int p = 0; p < planes; p++) {
+    unsigned char* out = static_cast<unsigned char*>(totals->plane(p));
+    for (size_t i = 0; i < count; i++) {
+      if (sumBytes == 4) {
+        uint32_t value = get32(sums + i * 4);
+        memcpy(out + i * 4, &value, 4);
+      } else {
+        uint64_t value = get64(sums + i * 8);
+        memcpy(out + i * 8, &value, 8);
+      }
+    }
+    sums += planeBytes;
+  }
+  return totals;
+}
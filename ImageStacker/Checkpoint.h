@@ -0,0 +1,56 @@
+/**
+ * @file Checkpoint.h
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Header file for the accumulator checkpoint
+ * 
+ * saves and restores the running totals, so frames that arrive later can be
+ * added without reading the earlier ones again
+ *
+ * File layout, version 2 (every number little-endian):
+ *   0  "STACKCKP"
+ *   8  u32 version (2)
+ *  12  u32 header size (48, where the sums start)
+ *  16  u32 width, u32 height, u32 max color, u32 frames added
+ *  32  2 bytes input format ("P3" or "P6"), u8 bytes per sum (4 or 8),
+ *      u8 sum kind (0 unsigned integer, 1 IEEE floating point)
+ *  36  f64 total weight of the frames (the frame count when unweighted)
+ *  44  u32 CRC-32 of bytes 0 to 43
+ *  48  width * height sums for red, then green, then blue; floating sums are
+ *      followed by as many Kahan compensation terms (the amount each sum is
+ *      too large by), for red, then green, then blue
+ * end  u32 CRC-32 of the sums and compensation
+ *
+ * Version 1 files (40-byte header without the sum kind or total weight, CRC-32
+ * at 36, 32-bit unsigned sums) are still read.
+ */
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include "Accumulator.h"
+
+using namespace std;
+
+const uint32_t CHECKPOINT_VERSION = 2;
+
+// everything a checkpoint records besides the sums
+struct CheckpointHeader {
+  string magic; // format of the first image, P3 or P6
+  uint32_t width, height, maxColor;
+  uint32_t frames; // images added to the sums
+  double totalWeight; // sum of the frames' weights
+};
+
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0); // CRC-32 (IEEE), chainable
+bool writeCheckpoint(const string& filepath, const CheckpointHeader& header,
+                     const Accumulator& totals); // replaces filepath atomically
+unique_ptr<Accumulator> readCheckpoint(const string& filepath,
+                                       CheckpointHeader& header); // checks version, size and checksums
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,363 @@
+/**
+ * @file Kernels.cpp
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Implementation of the stacking kernels
+ *
+ * Scalar, SSE2 and AVX2 versions of the accumulate and average loops. The SIMD
+ * versions are compiled with per-function target attributes, so the program
+ * still runs on CPUs without them; bestKernels() picks one at run time.
+ */
+
+
+#include "Kernels.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STACKER_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/**
+ * @brief Multiplier and shift that turn division by a constant into a multiply
+ * (Granlund and Montgomery): n / d == (t + ((n - t) >> 1)) >> shift, where
+ * t is the high half of n * multiplier. Exact for every 32-bit n and d >= 2.
+ */
+struct Divider {
+  uint32_t multiplier;
+  int shift;
+
+  explicit Divider(uint32_t d) {
+    int bits = 0; // ceil(log2(d))
+    while ((uint64_t(1) << bits) < d) {
+      bits++;
+    }
+    multiplier = static_cast<uint32_t>(((uint64_t(1) << 32) * ((uint64_t(1) << bits) - d)) / d + 1);
+    shift = bits - 1;
+  }
+
+  uint32_t divide(uint32_t n) const {
+    uint32_t t = static_cast<uint32_t>((uint64_t(n) * multiplier) >> 32);
+    return (t + ((n - t) >> 1)) >> shift;
+  }
+};
+
+
+// ---------------------------------------------------------------- scalar
+
+static void add8Scalar(const unsigned char* rgb, size_t count, uint32_t* red, uint32_t* green, uint32_t* blue) {
+  for (size_t i = 0; i < count; i++, rgb += 3) {
+    red[i] += rgb[0];
+    green[i] += rgb[1];
+    blue[i] += rgb[2];
+  }
+}
+
+static void add16Scalar(const unsigned char* rgb, size_t count, uint32_t* red, uint32_t* green, uint32_t* blue) {
+  for (size_t i = 0; i < count; i++, rgb += 6) {
+    red[i] += (rgb[0] << 8) | rgb[1];
+    green[i] += (rgb[2] << 8) | rgb[3];
+    blue[i] += (rgb[4] << 8) | rgb[5];
+  }
+}
+
+static void divideScalar(uint32_t* plane, size_t count, uint32_t divisor) {
+  if (divisor <= 1) {
+    return;
+  }
+  Divider d(divisor);
+  for (size_t i = 0; i < count; i++) {
+    plane[i] = d.divide(plane[i]);
+  }
+}
+
+static const StackKernels SCALAR_KERNELS = {"scalar", add8Scalar, add16Scalar, divideScalar};
+
+
+#ifdef STACKER_X86
+
+// ---------------------------------------------------------------- SSE2
+
+/**
+ * @brief Zero-extends 8 16-bit lanes to 32 bits and adds them to plane[0..7]
+ */
+__attribute__((target("sse2")))
+static inline void addWords8Sse2(__m128i words, uint32_t* plane) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i* out = reinterpret_cast<__m128i*>(plane);
+  _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), _mm_unpacklo_epi16(words, zero)));
+  _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(words, zero)));
+}
+
+/**
+ * @brief 16 pixels per step. SSE2 has no byte shuffle, so the three channels are
+ * separated with four rounds of unpacks (each round halves the interleave).
+ */
+__attribute__((target("sse2")))
+static void add8Sse2(const unsigned char* rgb, size_t count, uint32_t* red, uint32_t* green, uint32_t* blue) {
+  size_t i = 0;
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= count; i += 16, rgb += 48) {
+    __m128i t00 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb));
+    __m128i t01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 16));
+    __m128i t02 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 32));
+
+    __m128i t10 = _mm_unpacklo_epi8(t00, _mm_unpackhi_epi64(t01, t01));
+    __m128i t11 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t00, t00), t02);
+    __m128i t12 = _mm_unpacklo_epi8(t01, _mm_unpackhi_epi64(t02, t02));
+
+    __m128i t20 = _mm_unpacklo_epi8(t10, _mm_unpackhi_epi64(t11, t11));
+    __m128i t21 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t10, t10), t12);
+    __m128i t22 = _mm_unpacklo_epi8(t11, _mm_unpackhi_epi64(t12, t12));
+
+    __m128i t30 = _mm_unpacklo_epi8(t20, _mm_unpackhi_epi64(t21, t21));
+    __m128i t31 = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t20, t20), t22);
+    __m128i t32 = _mm_unpacklo_epi8(t21, _mm_unpackhi_epi64(t22, t22));
+
+    __m128i r = _mm_unpacklo_epi8(t30, _mm_unpackhi_epi64(t31, t31));
+    __m128i g = _mm_unpacklo_epi8(_mm_unpackhi_epi64(t30, t30), t32);
+    __m128i b = _mm_unpacklo_epi8(t31, _mm_unpackhi_epi64(t32, t32));
+
+    addWords8Sse2(_mm_unpacklo_epi8(r, zero), red + i);
+    addWords8Sse2(_mm_unpackhi_epi8(r, zero), red + i + 8);
+    addWords8Sse2(_mm_unpacklo_epi8(g, zero), green + i);
+    addWords8Sse2(_mm_unpackhi_epi8(g, zero), green + i + 8);
+    addWords8Sse2(_mm_unpacklo_epi8(b, zero), blue + i);
+    addWords8Sse2(_mm_unpackhi_epi8(b, zero), blue + i + 8);
+  }
+  add8Scalar(rgb, count - i, red + i, green + i, blue + i);
+}
+
+/**
+ * @brief 8 pixels per step: swap each sample's bytes, then separate the channels
+ * with three rounds of 16-bit unpacks.
+ */
+__attribute__((target("sse2")))
+static void add16Sse2(const unsigned char* rgb, size_t count, uint32_t* red, uint32_t* green, uint32_t* blue) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8, rgb += 48) {
+    __m128i t00 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb));
+    __m128i t01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 16));
+    __m128i t02 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 32));
+    t00 = _mm_or_si128(_mm_slli_epi16(t00, 8), _mm_srli_epi16(t00, 8));
+    t01 = _mm_or_si128(_mm_slli_epi16(t01, 8), _mm_srli_epi16(t01, 8));
+    t02 = _mm_or_si128(_mm_slli_epi16(t02, 8), _mm_srli_epi16(t02, 8));
+
+    __m128i t10 = _mm_unpacklo_epi16(t00, _mm_unpackhi_epi64(t01, t01));
+    __m128i t11 = _mm_unpacklo_epi16(_mm_unpackhi_epi64(t00, t00), t02);
+    __m128i t12 = _mm_unpacklo_epi16(t01, _mm_unpackhi_epi64(t02, t02));
+
+    __m128i t20 = _mm_unpacklo_epi16(t10, _mm_unpackhi_epi64(t11, t11));
+    __m128i t21 = _mm_unpacklo_epi16(_mm_unpackhi_epi64(t10, t10), t12);
+    __m128i t22 = _mm_unpacklo_epi16(t11, _mm_unpackhi_epi64(t12, t12));
+
+    addWords8Sse2(_mm_unpacklo_epi16(t20, _mm_unpackhi_epi64(t21, t21)), red + i);
+    addWords8Sse2(_mm_unpacklo_epi16(_mm_unpackhi_epi64(t20, t20), t22), green + i);
+    addWords8Sse2(_mm_unpacklo_epi16(t21, _mm_unpackhi_epi64(t22, t22)), blue + i);
+  }
+  add16Scalar(rgb, count - i, red + i, green + i, blue + i);
+}
+
+/**
+ * @brief 4 lanes per step with the Divider multiply; SSE2 only multiplies the
+ * even lanes, so the odd lanes are shifted down and multiplied separately.
+ */
+__attribute__((target("sse2")))
+static void divideSse2(uint32_t* plane, size_t count, uint32_t divisor) {
+  if (divisor <= 1) {
+    return;
+  }
+  Divider d(divisor);
+  __m128i multiplier = _mm_set1_epi32(static_cast<int>(d.multiplier));
+  __m128i oddMask = _mm_set_epi32(-1, 0, -1, 0);
+  __m128i shift = _mm_cvtsi32_si128(d.shift);
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i* p = reinterpret_cast<__m128i*>(plane + i);
+    __m128i n = _mm_loadu_si128(p);
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(n, multiplier), 32);
+    __m128i odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(n, 32), multiplier), oddMask);
+    __m128i t = _mm_or_si128(even, odd);
+    __m128i q = _mm_add_epi32(t, _mm_srli_epi32(_mm_sub_epi32(n, t), 1));
+    _mm_storeu_si128(p, _mm_srl_epi32(q, shift));
+  }
+  for (; i < count; i++) {
+    plane[i] = d.divide(plane[i]);
+  }
+}
+
+static const StackKernels SSE2_KERNELS = {"sse2", add8Sse2, add16Sse2, divideSse2};
+
+
+// ---------------------------------------------------------------- AVX2
+
+/**
+ * @brief Builds the byte-shuffle control that gathers one channel out of the
+ * 16-byte part of an interleaved RGB run that starts at byte base
+ *
+ * @param sampleBytes 1 for 8-bit samples, 2 for 16-bit (which are also byte swapped)
+ * @param channel 0 red, 1 green, 2 blue
+ * @param base Offset of the 16-byte part within the run
+ * @param control Receives the 16 control bytes (0x80 zeroes an output byte)
+ */
+static void channelShuffle(int sampleBytes, int channel, int base, unsigned char control[16]) {
+  for (int j = 0; j < 16; j++) {
+    int sample = j / sampleBytes;
+    int source = (sample * 3 + channel) * sampleBytes;
+    if (sampleBytes == 2) {
+      source += 1 - j % 2; // low output byte comes from the second (low) input byte
+    }
+    control[j] = (source >= base && source < base + 16) ? static_cast<unsigned char>(source - base) : 0x80;
+  }
+}
+
+/**
+ * @brief Gathers one channel of an interleaved run held in three registers
+ */
+__attribute__((target("avx2")))
+static inline __m128i gatherChannel(__m128i t0, __m128i t1, __m128i t2, const __m128i control[3]) {
+  return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(t0, control[0]), _mm_shuffle_epi8(t1, control[1])),
+                      _mm_shuffle_epi8(t2, control[2]));
+}
+
+/**
+ * @brief 16 pixels per step: byte shuffles separate the channels, then each
+ * channel is widened 8 lanes at a time into 256-bit adds.
+ */
+__attribute__((target("avx2")))
+static void add8Avx2(const unsigned char* rgb, size_t count, uint32_t* red, uint32_t* green, uint32_t* blue) {
+  __m128i control[3][3];
+  for (int c = 0; c < 3; c++) {
+    for (int k = 0; k < 3; k++) {
+      unsigned char bytes[16];
+      channelShuffle(1, c, 16 * k, bytes);
+      control[c][k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    }
+  }
+  uint32_t* planes[3] = {red, green, blue};
+
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16, rgb += 48) {
+    __m128i t0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb));
+    __m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 16));
+    __m128i t2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 32));
+    for (int c = 0; c < 3; c++) {
+      __m128i samples = gatherChannel(t0, t1, t2, control[c]);
+      __m256i* out = reinterpret_cast<__m256i*>(planes[c] + i);
+      _mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out), _mm256_cvtepu8_epi32(samples)));
+      _mm256_storeu_si256(out + 1, _mm256_add_epi32(_mm256_loadu_si256(out + 1),
+                                                    _mm256_cvtepu8_epi32(_mm_srli_si128(samples, 8))));
+    }
+  }
+  add8Scalar(rgb, count - i, red + i, green + i, blue + i);
+}
+
+/**
+ * @brief 8 pixels per step: the same byte shuffles also swap each sample to
+ * little endian, then 8 16-bit lanes are widened into one 256-bit add.
+ */
+__attribute__((target("avx2")))
+static void add16Avx2(const unsigned char* rgb, size_t count, uint32_t* red, uint32_t* green, uint32_t* blue) {
+  __m128i control[3][3];
+  for (int c = 0; c < 3; c++) {
+    for (int k = 0; k < 3; k++) {
+      unsigned char bytes[16];
+      channelShuffle(2, c, 16 * k, bytes);
+      control[c][k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    }
+  }
+  uint32_t* planes[3] = {red, green, blue};
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8, rgb += 48) {
+    __m128i t0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb));
+    __m128i t1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 16));
+    __m128i t2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + 32));
+    for (int c = 0; c < 3; c++) {
+      __m256i* out = reinterpret_cast<__m256i*>(planes[c] + i);
+      __m256i samples = _mm256_cvtepu16_epi32(gatherChannel(t0, t1, t2, control[c]));
+      _mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out), samples));
+    }
+  }
+  add16Scalar(rgb, count - i, red + i, green + i, blue + i);
+}
+
+/**
+ * @brief 8 lanes per step, same scheme as divideSse2
+ */
+__attribute__((target("avx2")))
+static void divideAvx2(uint32_t* plane, size_t count, uint32_t divisor) {
+  if (divisor <= 1) {
+    return;
+  }
+  Divider d(divisor);
+  __m256i multiplier = _mm256_set1_epi32(static_cast<int>(d.multiplier));
+  __m256i oddMask = _mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+  __m128i shift = _mm_cvtsi32_si128(d.shift);
+
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i* p = reinterpret_cast<__m256i*>(plane + i);
+    __m256i n = _mm256_loadu_si256(p);
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(n, multiplier), 32);
+    __m256i odd = _mm256_and_si256(_mm256_mul_epu32(_mm256_srli_epi64(n, 32), multiplier), oddMask);
+    __m256i t = _mm256_or_si256(even, odd);
+    __m256i q = _mm256_add_epi32(t, _mm256_srli_epi32(_mm256_sub_epi32(n, t), 1));
+    _mm256_storeu_si256(p, _mm256_srl_epi32(q, shift));
+  }
+  for (; i < count; i++) {
+    plane[i] = d.divide(plane[i]);
+  }
+}
+
+static const StackKernels AVX2_KERNELS = {"avx2", add8Avx2, add16Avx2, divideAvx2};
+
+#endif // STACKER_X86
+
+
+/**
+ * @brief Lists the kernel sets this CPU can run
+ *
+ * @return The sets, slowest first; scalar is always present
+ */
+vector<const StackKernels*> supportedKernels() {
+  vector<const StackKernels*> kernels;
+  kernels.push_back(&SCALAR_KERNELS);
+#ifdef STACKER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    kernels.push_back(&SSE2_KERNELS);
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back(&AVX2_KERNELS);
+  }
+#endif
+  return kernels;
+}
+
+
+/**
+ * @brief Picks the kernels the stacker uses: the fastest supported set, or the
+ * one named by the STACKER_KERNELS environment variable (scalar, sse2, avx2)
+ *
+ * @return The chosen set, decided on the first call
+ */
+const StackKernels& bestKernels() {
+  static const StackKernels* chosen = [] {
+    vector<const StackKernels*> kernels = supportedKernels();
+    const char* requested = getenv("STACKER_KERNELS");
+    if (requested != nullptr) {
+      for (const StackKernels* k : kernels) {
+        if (strcmp(k->name, requested) == 0) {
+          return k;
+        }
+      }
+    }
+    return kernels.back();
+  }();
+  return *chosen;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file Kernels.h
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Header file for the stacking kernels
+ *
+ * planar accumulator storage and the vectorized loops that fill and average it
+ */
+
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+// Planes start on a cache line so the vector loops never straddle one
+const size_t PLANE_ALIGNMENT = 64;
+
+template <typename T>
+struct AlignedAllocator {
+  typedef T value_type;
+
+  AlignedAllocator() {}
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(::operator new(count * sizeof(T), align_val_t(PLANE_ALIGNMENT)));
+  }
+  void deallocate(T* p, size_t) {
+    ::operator delete(p, align_val_t(PLANE_ALIGNMENT));
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U>&) const { return true; }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+// One channel of running totals
+typedef vector<uint32_t, AlignedAllocator<uint32_t>> Plane;
+
+// A set of kernels built for one instruction set
+struct StackKernels {
+  const char* name;
+
+  // adds count interleaved RGB pixels of 8-bit samples to three planes
+  void (*add8)(const unsigned char* rgb, size_t count, uint32_t* red, uint32_t* green, uint32_t* blue);
+
+  // the same for 16-bit samples stored most significant byte first (P6)
+  void (*add16)(const unsigned char* rgb, size_t count, uint32_t* red, uint32_t* green, uint32_t* blue);
+
+  // plane[i] /= divisor, truncating exactly like integer division
+  void (*divide)(uint32_t* plane, size_t count, uint32_t divisor);
+};
+
+vector<const StackKernels*> supportedKernels(); // every set this CPU can run, slowest first
+const StackKernels& bestKernels(); // the set the stacker uses
+
+#endif // KERNELS_H
@@ -0,0 +1,144 @@
+/**
+ * @file MappedFile.cpp
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Implementation of MappedFile
+ * 
+ * Implementation of the read-only file view
+ */
+
+
+#include "MappedFile.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * @brief Constructor for an empty view
+ */
+MappedFile::MappedFile() : bytes(nullptr), length(0), mapped(false) {}
+
+
+/**
+ * @brief Destructor, unmaps the file
+ */
+MappedFile::~MappedFile() {
+  close();
+}
+
+
+/**
+ * @brief Maps a whole file read-only. Files that cannot be mapped (pipes, some
+ * network file systems) are read into memory with bulk reads instead.
+ *
+ * @param filepath The path of the file to open
+ * @return True if the file was opened, false otherwise
+ */
+bool MappedFile::open(const string& filepath) {
+  close();
+
+  int fd = ::open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view != MAP_FAILED) {
+      // the file is read front to back once, so ask for aggressive readahead
+      madvise(view, info.st_size, MADV_SEQUENTIAL);
+      bytes = static_cast<const unsigned char*>(view);
+      length = info.st_size;
+      mapped = true;
+      ::close(fd);
+      return true;
+    }
+  }
+
+  // fall back to reading everything in large chunks
+  const size_t chunk = 1 << 20;
+  ssize_t got = 0;
+  do {
+    buffer.resize(length + chunk);
+    got = read(fd, buffer.data() + length, chunk);
+    if (got > 0) {
+      length += got;
+    }
+  } while (got > 0);
+  ::close(fd);
+
+  if (got < 0) {
+    buffer.clear();
+    length = 0;
+    return false;
+  }
+  buffer.resize(length);
+  bytes = buffer.data();
+  return true;
+}
+
+
+/**
+ * @brief Tells the kernel a range will not be read again, so its pages stop
+ * counting toward memory use. Pages from the one holding offset up to the last
+ * page that ends inside the range are dropped; reading them again later is
+ * still allowed (they are fetched from the file again).
+ *
+ * @param offset Start of the range
+ * @param count Length of the range in bytes
+ */
+void MappedFile::release(size_t offset, size_t count) {
+  if (!mapped || offset >= length) {
+    return;
+  }
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t first = offset / page * page;
+  size_t last = min(offset + count, length) / page * page;
+  if (first < last) {
+    madvise(const_cast<unsigned char*>(bytes) + first, last - first, MADV_DONTNEED);
+  }
+}
+
+
+/**
+ * @brief Releases the mapping or buffer
+ */
+void MappedFile::close() {
+  if (mapped) {
+    munmap(const_cast<unsigned char*>(bytes), length);
+  }
+  buffer.clear();
+  buffer.shrink_to_fit();
+  bytes = nullptr;
+  length = 0;
+  mapped = false;
+}
+
+
+/**
+ * @brief Reads the whole file into memory ahead of use: asks the kernel to start
+ * readahead for the mapping, then touches one byte per page so the disk reads
+ * happen on the calling thread rather than on whichever thread parses the data.
+ * Files that were not mapped are already in memory.
+ *
+ * @return The number of bytes made resident
+ */
+size_t MappedFile::prefetch() {
+  if (!mapped) {
+    return length;
+  }
+  madvise(const_cast<unsigned char*>(bytes), length, MADV_WILLNEED);
+
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  unsigned char touched = 0;
+  for (size_t i = 0; i < length; i += page) {
+    touched ^= *static_cast<const volatile unsigned char*>(bytes + i);
+  }
+  (void)touched;
+  return length;
+}
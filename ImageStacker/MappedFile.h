@@ -0,0 +1,44 @@
+/**
+ * @file MappedFile.h
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Header file for MappedFile
+ * 
+ * read-only view of a whole file, memory-mapped when possible
+ */
+
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class MappedFile {
+ private:
+  const unsigned char* bytes; // start of the file contents
+  size_t length;
+  bool mapped; // true if bytes points at an mmap, false if at buffer
+  vector<unsigned char> buffer; // fallback copy when the file cannot be mapped
+
+ public:
+  MappedFile();
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const string& filepath); // maps (or bulk reads) the whole file
+  void close(); // unmaps the file
+  void release(size_t offset, size_t count); // drops cached pages of a range already read
+  size_t prefetch(); // starts readahead and faults the whole file in
+
+  const unsigned char* data() const { return bytes; }
+  size_t size() const { return length; }
+
+};
+
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,94 @@
+/**
+ * @file PpmScanner.cpp
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Implementation of PpmScanner
+ * 
+ * Implementation of the P3 sample reader
+ */
+
+
+#include "PpmScanner.h"
+
+using namespace std;
+
+/**
+ * @brief Constructor
+ *
+ * @param data The whole file
+ * @param size The number of bytes in data
+ * @param pos Position of the first sample (just past the header)
+ * @param useSwar Whether to use the 8-bytes-at-a-time digit parser
+ */
+PpmScanner::PpmScanner(const unsigned char* data, size_t size, size_t pos, bool useSwar)
+  : data(data), size(size), pos(pos), useSwar(useSwar) {}
+
+
+/**
+ * @brief Parses a number one digit at a time. Used near the end of the file, for
+ * numbers of 8 digits or more, and when the fast parser is turned off.
+ *
+ * @param maxValue The largest value allowed
+ * @param value Receives the number
+ * @return True if a valid sample was read, false otherwise
+ */
+bool PpmScanner::readLongNumber(int maxValue, int& value) {
+  size_t start = pos;
+  long long number = 0;
+  while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+    // stop growing once past maxValue, but keep consuming the digits
+    if (number <= maxValue) {
+      number = number * 10 + (data[pos] - '0');
+    }
+    pos++;
+  }
+
+  if (pos == start) {
+    return fail(pos, string("unexpected character '") + static_cast<char>(data[pos]) + "'");
+  }
+  if (pos < size && !isSpace(data[pos]) && data[pos] != '#') {
+    return fail(pos, string("unexpected character '") + static_cast<char>(data[pos]) + "'");
+  }
+  if (number > maxValue) {
+    return fail(start, "sample " + string(reinterpret_cast<const char*>(data + start), pos - start)
+                + " is larger than max color " + to_string(maxValue));
+  }
+  value = static_cast<int>(number);
+  return true;
+}
+
+
+/**
+ * @brief Finds the line and column of a byte, counting from 1. Only called for
+ * error messages, so the fast path never tracks lines.
+ *
+ * @param where Position of the byte
+ * @param line Receives the line number
+ * @param column Receives the column number
+ */
+void PpmScanner::location(size_t where, int& line, int& column) const {
+  line = 1;
+  size_t lineStart = 0;
+  for (size_t i = 0; i < where && i < size; i++) {
+    if (data[i] == '\n') {
+      line++;
+      lineStart = i + 1;
+    }
+  }
+  column = static_cast<int>(where - lineStart) + 1;
+}
+
+
+/**
+ * @brief Records an error as "line L, column C: what"
+ *
+ * @param where Position of the offending byte
+ * @param what Description of the problem
+ * @return Always false, so callers can return fail(...)
+ */
+bool PpmScanner::fail(size_t where, const string& what) {
+  int line = 0, column = 0;
+  location(where, line, column);
+  message = "line " + to_string(line) + ", column " + to_string(column) + ": " + what;
+  return false;
+}
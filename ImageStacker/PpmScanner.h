@@ -0,0 +1,112 @@
+/**
+ * @file PpmScanner.h
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Header file for PpmScanner
+ * 
+ * fast reader for the ASCII samples of a P3 image
+ */
+
+
+#ifndef PPMSCANNER_H
+#define PPMSCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+class PpmScanner {
+ private:
+  const unsigned char* data; // the whole file
+  size_t size;
+  size_t pos; // next byte to look at
+  bool useSwar; // parse up to 7 digits at once with 64-bit arithmetic
+  string message; // description of the first error
+
+  bool fail(size_t where, const string& what); // records an error at a position
+  bool readLongNumber(int maxValue, int& value); // digit-by-digit fallback
+
+  static bool isSpace(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+ public:
+  PpmScanner(const unsigned char* data, size_t size, size_t pos, bool useSwar = true);
+
+  inline bool readSample(int maxValue, int& value); // reads the next sample
+  const string& error() const { return message; }
+  size_t position() const { return pos; }
+  void location(size_t where, int& line, int& column) const; // 1-based line and column of a byte
+
+};
+
+
+/**
+ * @brief Reads the next sample: skips whitespace and # comments, then parses a
+ * decimal number no larger than maxValue that must end at whitespace, a comment
+ * or the end of the file.
+ *
+ * @param maxValue The largest value allowed
+ * @param value Receives the sample
+ * @return True if a valid sample was read, false otherwise (see error())
+ */
+inline bool PpmScanner::readSample(int maxValue, int& value) {
+  while (pos < size) {
+    unsigned char c = data[pos];
+    if (isSpace(c)) {
+      pos++;
+    } else if (c == '#') {
+      // a comment runs to the end of the line
+      const void* end = memchr(data + pos, '\n', size - pos);
+      pos = end ? static_cast<const unsigned char*>(end) - data : size;
+    } else {
+      break;
+    }
+  }
+  if (pos >= size) {
+    return fail(pos, "unexpected end of file, expected a sample");
+  }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (useSwar && size - pos >= 8) {
+    // Load 8 bytes, turn '0'..'9' into 0..9 and flag every other byte; the
+    // number's digits are the bytes before the first flagged one
+    uint64_t chunk;
+    memcpy(&chunk, data + pos, 8);
+    uint64_t digits = chunk ^ 0x3030303030303030ULL;
+    uint64_t notDigit = (((digits & 0x7f7f7f7f7f7f7f7fULL) + 0x7676767676767676ULL) | digits)
+                        & 0x8080808080808080ULL;
+    if (notDigit != 0) {
+      int length = __builtin_ctzll(notDigit) >> 3;
+      if (length == 0) {
+        return fail(pos, string("unexpected character '") + static_cast<char>(data[pos]) + "'");
+      }
+
+      // Push the digits to the top so the empty low bytes act as leading zeros,
+      // then combine pairs, quads and the two halves with three multiplies
+      digits <<= 8 * (8 - length);
+      digits = (digits * 10) + (digits >> 8);
+      digits = (((digits & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32)))
+                + (((digits >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32)))) >> 32;
+
+      unsigned char next = data[pos + length];
+      if (!isSpace(next) && next != '#') {
+        return fail(pos + length, string("unexpected character '") + static_cast<char>(next) + "'");
+      }
+      if (digits > static_cast<uint64_t>(maxValue)) {
+        return fail(pos, "sample " + string(reinterpret_cast<const char*>(data + pos), length)
+                    + " is larger than max color " + to_string(maxValue));
+      }
+      value = static_cast<int>(digits);
+      pos += length;
+      return true;
+    }
+  }
+#endif
+
+  return readLongNumber(maxValue, value);
+}
+
+
+#endif // PPMSCANNER_H
@@ -0,0 +1,519 @@
+/**
+ * @file Registration.cpp
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Implementation of frame registration
+ *
+ * Phase correlation in two passes: a coarse one over the whole frame, box
+ * averaged down to at most 256 pixels a side, finds the shift to within a
+ * pixel or two of the full image; a fine one over a full-resolution block in
+ * the middle of the frame refines it. Both correlate tapered luminance through
+ * an iterative radix-2 FFT whose butterflies run across whole rows at a time,
+ * so the inner loops are contiguous and vectorize.
+ */
+
+
+#include "Registration.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+using namespace std;
+
+// a correlation peak below this is noise, not a match
+static const double MIN_PEAK = 0.05;
+
+// width of the Gaussian that rolls off the whitened spectrum, in cycles per
+// pixel: whitening alone lets pixel noise outvote the stars
+static const double PASSBAND = 0.08;
+
+/**
+ * @brief Gets the smallest power of two no less than n
+ */
+static int powerOfTwoAbove(int n) {
+  int p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+
+/**
+ * @brief Gets the largest power of two no more than n (n >= 1)
+ */
+static int powerOfTwoBelow(int n) {
+  int p = 1;
+  while (p * 2 <= n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+
+/**
+ * @brief Butterflies between two runs of count elements: a += w * b and
+ * b = a - w * b. The runs never overlap, which the restrict qualifiers tell
+ * the compiler.
+ */
+template <int Count>
+static inline void butterflies(float* __restrict ar, float* __restrict ai, float* __restrict br,
+                               float* __restrict bi, float wr, float wi) {
+  for (int x = 0; x < Count; x++) {
+    float tr = br[x] * wr - bi[x] * wi;
+    float ti = br[x] * wi + bi[x] * wr;
+    br[x] = ar[x] - tr;
+    bi[x] = ai[x] - ti;
+    ar[x] += tr;
+    ai[x] += ti;
+  }
+}
+
+
+/**
+ * @brief One pass of butterflies between two whole rows. Blocks of a fixed
+ * eight elements unroll into vector instructions even at -O2, which will not
+ * vectorize a loop of unknown length.
+ */
+static void butterflyRows(float* ar, float* ai, float* br, float* bi, int length, float wr, float wi) {
+  int x = 0;
+  for (; x + 8 <= length; x += 8) {
+    butterflies<8>(ar + x, ai + x, br + x, bi + x, wr, wi);
+  }
+  for (; x < length; x++) {
+    butterflies<1>(ar + x, ai + x, br + x, bi + x, wr, wi);
+  }
+}
+
+
+/**
+ * @brief Transforms every column of a rows x rowLength array at once: the
+ * bit-reversal permutation swaps whole rows and each butterfly combines two
+ * whole rows. Unscaled in both directions.
+ *
+ * @param re Real parts, row-major
+ * @param im Imaginary parts, row-major
+ * @param rowLength Columns in the array
+ * @param rows Length of each transform, a power of two
+ * @param inverse True for the inverse transform
+ */
+static void fftColumns(float* re, float* im, int rowLength, int rows, bool inverse) {
+  for (int i = 1, j = 0; i < rows; i++) {
+    int bit = rows >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      swap_ranges(re + size_t(i) * rowLength, re + size_t(i + 1) * rowLength, re + size_t(j) * rowLength);
+      swap_ranges(im + size_t(i) * rowLength, im + size_t(i + 1) * rowLength, im + size_t(j) * rowLength);
+    }
+  }
+
+  vector<float> cosines(rows / 2), sines(rows / 2);
+  for (int k = 0; k < rows / 2; k++) {
+    double angle = 2 * M_PI * k / rows;
+    cosines[k] = static_cast<float>(cos(angle));
+    sines[k] = static_cast<float>(inverse ? sin(angle) : -sin(angle));
+  }
+
+  for (int length = 2; length <= rows; length <<= 1) {
+    int half = length / 2;
+    int step = rows / length;
+    for (int start = 0; start < rows; start += length) {
+      for (int k = 0; k < half; k++) {
+        size_t a = size_t(start + k) * rowLength;
+        size_t b = a + size_t(half) * rowLength;
+        butterflyRows(re + a, im + a, re + b, im + b, rowLength, cosines[k * step], sines[k * step]);
+      }
+    }
+  }
+}
+
+
+/**
+ * @brief Transposes a rows x columns array in place (through a copy), in
+ * 16 x 16 blocks so both sides stay in cache
+ */
+static void transpose(vector<float>& values, vector<float>& scratch, int columns, int rows) {
+  const int block = 16;
+  scratch.resize(values.size());
+  for (int top = 0; top < rows; top += block) {
+    for (int left = 0; left < columns; left += block) {
+      for (int y = top; y < min(top + block, rows); y++) {
+        for (int x = left; x < min(left + block, columns); x++) {
+          scratch[size_t(x) * rows + y] = values[size_t(y) * columns + x];
+        }
+      }
+    }
+  }
+  values.swap(scratch);
+}
+
+
+/**
+ * @brief Two-dimensional FFT, unscaled both ways. To save two transposes the
+ * forward transform leaves the spectrum transposed (frequency (u, v) at
+ * u * height + v) and the inverse transform expects it that way, returning
+ * the plane row-major again.
+ *
+ * @param re Real parts
+ * @param im Imaginary parts
+ * @param width Plane width, a power of two
+ * @param height Plane height, a power of two
+ * @param inverse True for the inverse transform
+ */
+void fft2d(vector<float>& re, vector<float>& im, int width, int height, bool inverse) {
+  vector<float> scratch;
+  if (!inverse) {
+    fftColumns(re.data(), im.data(), width, height, false);
+    transpose(re, scratch, width, height);
+    transpose(im, scratch, width, height);
+    fftColumns(re.data(), im.data(), height, width, false);
+  } else {
+    fftColumns(re.data(), im.data(), height, width, true);
+    transpose(re, scratch, height, width);
+    transpose(im, scratch, height, width);
+    fftColumns(re.data(), im.data(), width, height, true);
+  }
+}
+
+
+/**
+ * @brief Sizes a correlation window and builds its taper. The window's
+ * content fills span pixels each way; the rest, up to the power of two, is
+ * zero padding.
+ */
+void Registration::setUpWindow(Window& window, int factor, int spanX, int spanY) {
+  window.factor = factor;
+  window.spanX = spanX;
+  window.spanY = spanY;
+  window.width = powerOfTwoAbove(spanX);
+  window.height = powerOfTwoAbove(spanY);
+  window.taper.resize(size_t(spanX) * spanY);
+  for (int v = 0; v < spanY; v++) {
+    double hy = 0.5 - 0.5 * cos(2 * M_PI * (v + 0.5) / spanY);
+    for (int u = 0; u < spanX; u++) {
+      double hx = 0.5 - 0.5 * cos(2 * M_PI * (u + 0.5) / spanX);
+      window.taper[size_t(v) * spanX + u] = static_cast<float>(hx * hy);
+    }
+  }
+
+  // the low-pass, laid out like fft2d's transposed spectrum
+  window.passband.resize(size_t(window.width) * window.height);
+  window.passbandSum = 0;
+  for (int u = 0; u < window.width; u++) {
+    double fu = double(u > window.width / 2 ? u - window.width : u) / window.width;
+    for (int v = 0; v < window.height; v++) {
+      double fv = double(v > window.height / 2 ? v - window.height : v) / window.height;
+      float gain = static_cast<float>(exp(-(fu * fu + fv * fv) / (2 * PASSBAND * PASSBAND)));
+      window.passband[size_t(u) * window.height + v] = gain;
+      window.passbandSum += gain;
+    }
+  }
+}
+
+
+/**
+ * @brief Fills a window from a frame: luminance box-averaged over factor x
+ * factor pixels, centred on a point, less its mean, times the taper. Pixels
+ * past the frame's edges repeat the edge.
+ *
+ * @param rgb The frame's samples (P6 layout)
+ * @param window The window to fill
+ * @param centerX Full-resolution column the window is centred on
+ * @param centerY Full-resolution row the window is centred on
+ * @param re Filled with the window's values
+ * @param im Filled with zeros
+ */
+void Registration::extract(const unsigned char* rgb, const Window& window, int centerX, int centerY,
+                           vector<float>& re, vector<float>& im) const {
+  int f = window.factor;
+  int left = centerX - window.spanX * f / 2;
+  int top = centerY - window.spanY * f / 2;
+
+  vector<int> columns(size_t(window.spanX) * f);
+  for (size_t i = 0; i < columns.size(); i++) {
+    columns[i] = min(max(left + static_cast<int>(i), 0), frameWidth - 1);
+  }
+
+  vector<float> box(size_t(window.spanX) * window.spanY, 0);
+  for (int v = 0; v < window.spanY; v++) {
+    float* row = box.data() + size_t(v) * window.spanX;
+    for (int dy = 0; dy < f; dy++) {
+      int y = min(max(top + v * f + dy, 0), frameHeight - 1);
+      const unsigned char* line = rgb + size_t(y) * frameWidth * 3 * sampleBytes;
+      for (int u = 0; u < window.spanX; u++) {
+        uint32_t sum = 0;
+        for (int dx = 0; dx < f; dx++) {
+          size_t k = size_t(columns[size_t(u) * f + dx]) * 3;
+          if (sampleBytes == 1) {
+            sum += line[k] + 2 * line[k + 1] + line[k + 2];
+          } else {
+            sum += ((line[2 * k] << 8) | line[2 * k + 1]) + 2 * ((line[2 * k + 2] << 8) | line[2 * k + 3])
+                 + ((line[2 * k + 4] << 8) | line[2 * k + 5]);
+          }
+        }
+        row[u] += static_cast<float>(sum);
+      }
+    }
+  }
+
+  double mean = 0;
+  for (float value : box) {
+    mean += value;
+  }
+  mean /= box.size();
+
+  re.assign(size_t(window.width) * window.height, 0);
+  im.assign(re.size(), 0);
+  for (int v = 0; v < window.spanY; v++) {
+    for (int u = 0; u < window.spanX; u++) {
+      size_t i = size_t(v) * window.spanX + u;
+      re[size_t(v) * window.width + u] = static_cast<float>((box[i] - mean) * window.taper[i]);
+    }
+  }
+}
+
+
+/**
+ * @brief Offset of a peak from its sample, from the parabola through the
+ * sample and its neighbours on either side; the low-passed peak is smooth
+ * enough for the fit to hold to a few hundredths of a pixel
+ */
+static double subpixelOffset(double before, double peak, double after) {
+  double curvature = before - 2 * peak + after;
+  return curvature < 0 ? 0.5 * (before - after) / curvature : 0;
+}
+
+
+/**
+ * @brief Phase-correlates a frame's window with the reference's: whitens the
+ * cross-power spectrum so every frequency votes equally, rolls off the
+ * noise-dominated high frequencies, transforms it back and finds the peak
+ *
+ * @param window The window, holding the reference's spectrum
+ * @param re The frame's window, as extract() left it; overwritten
+ * @param im Zeros; overwritten
+ * @return The shift in full-resolution pixels, and the peak's height
+ */
+FrameShift Registration::correlate(const Window& window, vector<float>& re, vector<float>& im) const {
+  fft2d(re, im, window.width, window.height, false);
+  for (size_t i = 0; i < re.size(); i++) {
+    float cr = re[i] * window.re[i] + im[i] * window.im[i];
+    float ci = im[i] * window.re[i] - re[i] * window.im[i];
+    float magnitude = sqrt(cr * cr + ci * ci);
+    float gain = magnitude > 0 ? window.passband[i] / magnitude : 0;
+    re[i] = cr * gain;
+    im[i] = ci * gain;
+  }
+  fft2d(re, im, window.width, window.height, true);
+
+  int w = window.width, h = window.height;
+  size_t best = 0;
+  for (size_t i = 1; i < re.size(); i++) {
+    if (re[i] > re[best]) {
+      best = i;
+    }
+  }
+  int px = static_cast<int>(best % w), py = static_cast<int>(best / w);
+  auto at = [&](int x, int y) { return static_cast<double>(re[size_t((y + h) % h) * w + (x + w) % w]); };
+
+  double peak = at(px, py);
+  double x = (px > w / 2 ? px - w : px) + subpixelOffset(at(px - 1, py), peak, at(px + 1, py));
+  double y = (py > h / 2 ? py - h : py) + subpixelOffset(at(px, py - 1), peak, at(px, py + 1));
+  return FrameShift{x * window.factor, y * window.factor, peak / window.passbandSum};
+}
+
+
+/**
+ * @brief Builds the reference spectra both passes correlate against
+ *
+ * @param rgb The reference frame's samples (P6 layout)
+ * @param sampleBytes Bytes per sample, 1 or 2
+ * @param width Frame width
+ * @param height Frame height
+ * @param coarseSize Most window pixels along either side of the coarse pass
+ * @param fineSize Most pixels along either side of the fine pass
+ */
+Registration::Registration(const unsigned char* rgb, size_t sampleBytes, int width, int height,
+                           int coarseSize, int fineSize) {
+  this->sampleBytes = sampleBytes;
+  frameWidth = width;
+  frameHeight = height;
+
+  int factor = max(1, (max(width, height) + coarseSize - 1) / coarseSize);
+  setUpWindow(coarse, factor, (width + factor - 1) / factor, (height + factor - 1) / factor);
+  int side = powerOfTwoBelow(max(1, min(fineSize, min(width, height))));
+  setUpWindow(fine, 1, side, side);
+
+  extract(rgb, coarse, width / 2, height / 2, coarse.re, coarse.im);
+  fft2d(coarse.re, coarse.im, coarse.width, coarse.height, false);
+  extract(rgb, fine, width / 2, height / 2, fine.re, fine.im);
+  fft2d(fine.re, fine.im, fine.width, fine.height, false);
+}
+
+
+/**
+ * @brief Estimates how far a frame has moved from the reference. The coarse
+ * pass finds the shift over the whole frame; the fine pass then correlates
+ * the reference's middle block with the frame's block at that shift, and its
+ * answer replaces the coarse one when it is a clear, nearby peak.
+ *
+ * @param rgb The frame's samples, the same size and sample width as the reference
+ * @return The shift; x and y are 0 with peak 0 when nothing matched
+ */
+FrameShift Registration::estimate(const unsigned char* rgb) const {
+  vector<float> re, im;
+  extract(rgb, coarse, frameWidth / 2, frameHeight / 2, re, im);
+  FrameShift shift = correlate(coarse, re, im);
+  if (shift.peak < MIN_PEAK) {
+    return FrameShift{0, 0, 0};
+  }
+
+  int baseX = static_cast<int>(lround(shift.x)), baseY = static_cast<int>(lround(shift.y));
+  extract(rgb, fine, frameWidth / 2 + baseX, frameHeight / 2 + baseY, re, im);
+  FrameShift residual = correlate(fine, re, im);
+  double reach = coarse.factor + 1.0;
+  if (residual.peak >= MIN_PEAK && fabs(residual.x) <= reach && fabs(residual.y) <= reach) {
+    shift = FrameShift{baseX + residual.x, baseY + residual.y, residual.peak};
+  }
+  return shift;
+}
+
+
+// Bilinear weights are fixed point. 8-bit samples blend in 16-bit lanes, which
+// SSE2 multiplies eight at a time, with weights of 8 fraction bits (1/512 of a
+// pixel at worst); 16-bit samples blend in 32 bits with 15.
+template <size_t SampleBytes>
+struct Blend {
+  typedef typename conditional<SampleBytes == 1, uint16_t, uint32_t>::type Lane;
+  static const int WEIGHT_BITS = SampleBytes == 1 ? 8 : 15;
+};
+
+/**
+ * @brief Reads sample k of a P6 layout row
+ */
+template <size_t SampleBytes>
+static inline uint32_t sampleAt(const unsigned char* row, size_t k) {
+  return SampleBytes == 1 ? row[k] : (static_cast<uint32_t>(row[2 * k]) << 8) | row[2 * k + 1];
+}
+
+
+/**
+ * @brief Writes sample k of a P6 layout row
+ */
+template <size_t SampleBytes>
+static inline void storeSample(unsigned char* row, size_t k, uint32_t value) {
+  if (SampleBytes == 1) {
+    row[k] = static_cast<unsigned char>(value);
+  } else {
+    row[2 * k] = static_cast<unsigned char>(value >> 8);
+    row[2 * k + 1] = static_cast<unsigned char>(value);
+  }
+}
+
+
+/**
+ * @brief Blends count samples from four runs: the source pixel and its right
+ * neighbour on the row above and below the output's position
+ */
+template <size_t SampleBytes, int Count>
+static inline void blendSamples(const unsigned char* __restrict topLeft, const unsigned char* __restrict topRight,
+                                const unsigned char* __restrict bottomLeft,
+                                const unsigned char* __restrict bottomRight, unsigned char* __restrict out,
+                                const typename Blend<SampleBytes>::Lane* weights) {
+  typedef typename Blend<SampleBytes>::Lane Lane;
+  const int bits = Blend<SampleBytes>::WEIGHT_BITS;
+  for (int k = 0; k < Count; k++) {
+    Lane value = static_cast<Lane>(weights[0] * static_cast<Lane>(sampleAt<SampleBytes>(topLeft, k))
+                                   + weights[1] * static_cast<Lane>(sampleAt<SampleBytes>(topRight, k))
+                                   + weights[2] * static_cast<Lane>(sampleAt<SampleBytes>(bottomLeft, k))
+                                   + weights[3] * static_cast<Lane>(sampleAt<SampleBytes>(bottomRight, k))
+                                   + (Lane(1) << (bits - 1)));
+    storeSample<SampleBytes>(out, k, value >> bits);
+  }
+}
+
+
+/**
+ * @brief Bilinearly resamples one frame so out(x, y) = in(x + dx, y + dy),
+ * repeating edge pixels where that falls outside the frame. The shift is the
+ * same everywhere, so inside the frame each output row is a blend of two
+ * source rows at fixed offsets; only the columns near the edges need clamping.
+ */
+template <size_t SampleBytes>
+static void shiftSamples(const unsigned char* rgb, int width, int height, double dx, double dy, unsigned char* out) {
+  int ix = static_cast<int>(floor(dx)), iy = static_cast<int>(floor(dy));
+  double fx = dx - ix, fy = dy - iy;
+  typedef typename Blend<SampleBytes>::Lane Lane;
+  const double one = 1 << Blend<SampleBytes>::WEIGHT_BITS;
+  Lane weights[4];
+  weights[0] = static_cast<Lane>(lround((1 - fx) * (1 - fy) * one));
+  weights[1] = static_cast<Lane>(lround(fx * (1 - fy) * one));
+  weights[2] = static_cast<Lane>(lround((1 - fx) * fy * one));
+  weights[3] = static_cast<Lane>(one - weights[0] - weights[1] - weights[2]); // so a flat frame stays flat
+
+  // columns whose source pixel and right neighbour are both inside the frame
+  int first = min(max(-ix, 0), width);
+  int last = max(min(width - 1 - ix, width), first);
+
+  size_t pixelBytes = 3 * SampleBytes;
+  size_t rowBytes = size_t(width) * pixelBytes;
+  for (int y = 0; y < height; y++) {
+    const unsigned char* top = rgb + size_t(min(max(y + iy, 0), height - 1)) * rowBytes;
+    const unsigned char* bottom = rgb + size_t(min(max(y + iy + 1, 0), height - 1)) * rowBytes;
+    unsigned char* line = out + size_t(y) * rowBytes;
+
+    auto blendEdge = [&](int x) {
+      size_t left = size_t(min(max(x + ix, 0), width - 1)) * pixelBytes;
+      size_t right = size_t(min(max(x + ix + 1, 0), width - 1)) * pixelBytes;
+      blendSamples<SampleBytes, 3>(top + left, top + right, bottom + left, bottom + right,
+                                   line + size_t(x) * pixelBytes, weights);
+    };
+    for (int x = 0; x < first; x++) {
+      blendEdge(x);
+    }
+    for (int x = last; x < width; x++) {
+      blendEdge(x);
+    }
+
+    // the interior, in blocks of a fixed size so the loop vectorizes; output
+    // byte at comes from source bytes at + shift and at + shift + pixelBytes
+    ptrdiff_t shift = static_cast<ptrdiff_t>(ix) * static_cast<ptrdiff_t>(pixelBytes);
+    size_t k = size_t(first) * 3, end = size_t(last) * 3;
+    for (; k + 16 <= end; k += 16) {
+      size_t at = k * SampleBytes;
+      blendSamples<SampleBytes, 16>(top + at + shift, top + at + shift + pixelBytes, bottom + at + shift,
+                                    bottom + at + shift + pixelBytes, line + at, weights);
+    }
+    for (; k < end; k++) {
+      size_t at = k * SampleBytes;
+      blendSamples<SampleBytes, 1>(top + at + shift, top + at + shift + pixelBytes, bottom + at + shift,
+                                   bottom + at + shift + pixelBytes, line + at, weights);
+    }
+  }
+}
+
+
+/**
+ * @brief Moves a frame back by its estimated shift, so its content lines up
+ * with the reference's
+ *
+ * @param rgb The frame's samples (P6 layout)
+ * @param sampleBytes Bytes per sample, 1 or 2
+ * @param width Frame width
+ * @param height Frame height
+ * @param shift The frame's shift from estimate()
+ * @param out Resized and filled with the shifted samples, in the same layout
+ */
+void shiftFrame(const unsigned char* rgb, size_t sampleBytes, int width, int height, const FrameShift& shift,
+                vector<unsigned char>& out) {
+  out.resize(size_t(width) * height * 3 * sampleBytes);
+  if (sampleBytes == 1) {
+    shiftSamples<1>(rgb, width, height, shift.x, shift.y, out.data());
+  } else {
+    shiftSamples<2>(rgb, width, height, shift.x, shift.y, out.data());
+  }
+}
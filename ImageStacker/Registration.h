@@ -0,0 +1,60 @@
+/**
+ * @file Registration.h
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Header file for frame registration
+ *
+ * estimates how far each frame has drifted from a reference frame by phase
+ * correlation, and shifts frames back before they are stacked
+ */
+
+
+#ifndef REGISTRATION_H
+#define REGISTRATION_H
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// translation of a frame against the reference, in full-resolution pixels
+struct FrameShift {
+  double x, y; // the frame's content sits this far right and down of the reference's
+  double peak; // height of the correlation peak as a share of a perfect match's
+};
+
+class Registration {
+ private:
+  // one correlation window: a power-of-two block of box-averaged luminance
+  struct Window {
+    int factor; // full-resolution pixels per window pixel, each way
+    int spanX, spanY; // pixels of the window with content in them, the rest zero padding
+    int width, height; // window size in window pixels, powers of two
+    vector<float> taper; // Hann window, spanX * spanY
+    vector<float> passband; // low-pass gain per frequency, laid out like the spectrum
+    double passbandSum; // the peak's height for a perfect match
+    vector<float> re, im; // the reference's spectrum (transposed, see fft2d)
+  };
+
+  size_t sampleBytes;
+  int frameWidth, frameHeight;
+  Window coarse; // the whole frame, downsampled
+  Window fine; // the middle of the frame at full resolution
+
+  void setUpWindow(Window& window, int factor, int spanX, int spanY); // sizes a window and its taper
+  void extract(const unsigned char* rgb, const Window& window, int centerX, int centerY,
+               vector<float>& re, vector<float>& im) const; // tapered luminance around a point
+  FrameShift correlate(const Window& window, vector<float>& re, vector<float>& im) const; // peak of the correlation
+
+ public:
+  Registration(const unsigned char* rgb, size_t sampleBytes, int width, int height,
+               int coarseSize = 256, int fineSize = 256); // analyses the reference frame
+  FrameShift estimate(const unsigned char* rgb) const; // shift of a frame of the same size
+
+};
+
+void fft2d(vector<float>& re, vector<float>& im, int width, int height, bool inverse); // radix-2, in place
+void shiftFrame(const unsigned char* rgb, size_t sampleBytes, int width, int height, const FrameShift& shift,
+                vector<unsigned char>& out); // resamples a frame so it lines up with the reference
+
+#endif // REGISTRATION_H
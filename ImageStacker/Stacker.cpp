@@ -9,117 +9,1493 @@
 
 
 #include "Stacker.h"
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include "PpmScanner.h"
+#include "StreamingClip.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <memory>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include "BoundedQueue.h"
+#include <thread>
 
 using namespace std;
 
+/**
+ * @brief Skips whitespace and # comments in a ppm header
+ *
+ * @param data The file contents
+ * @param size The number of bytes in data
+ * @param pos Position to start at, moved past the skipped bytes
+ */
+static void skipHeaderSpace(const unsigned char* data, size_t size, size_t& pos) {
+  while (pos < size) {
+    if (data[pos] == '#') {
+      // a comment runs to the end of the line
+      while (pos < size && data[pos] != '\n' && data[pos] != '\r') {
+        pos++;
+      }
+    } else if (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r'
+               || data[pos] == '\v' || data[pos] == '\f') {
+      pos++;
+    } else {
+      return;
+    }
+  }
+}
+
+
+/**
+ * @brief Reads one decimal number from a ppm header
+ *
+ * @param data The file contents
+ * @param size The number of bytes in data
+ * @param pos Position to start at, moved past the number
+ * @param value Receives the number
+ * @return True if a number was found, false otherwise
+ */
+static bool readHeaderNumber(const unsigned char* data, size_t size, size_t& pos, int& value) {
+  skipHeaderSpace(data, size, pos);
+  if (pos >= size || data[pos] < '0' || data[pos] > '9') {
+    return false;
+  }
+
+  long long number = 0;
+  while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+    number = number * 10 + (data[pos] - '0');
+    if (number > INT_MAX) {
+      return false;
+    }
+    pos++;
+  }
+  value = static_cast<int>(number);
+  return true;
+}
+
+
+/**
+ * @brief Median of a pixel's values across the frames; for an even count, the
+ * truncated average of the two middle values
+ *
+ * @param values The values, reordered by the call
+ * @param count The number of values
+ * @return The median
+ */
+static uint32_t medianOf(uint16_t* values, int count) {
+  uint16_t* middle = values + count / 2;
+  nth_element(values, middle, values + count);
+  if (count % 2 == 1) {
+    return *middle;
+  }
+  uint16_t below = *max_element(values, middle);
+  return (static_cast<uint32_t>(below) + *middle) / 2;
+}
+
+
+/**
+ * @brief Kappa-sigma clipped mean: drops values more than kappa standard
+ * deviations from the mean of the values still kept, until nothing more is
+ * dropped or the rounds run out, then averages what is left. The values are
+ * sorted first, so the kept values are always one contiguous run.
+ *
+ * @param values The values, sorted by the call
+ * @param count The number of values
+ * @param kappa The threshold in standard deviations
+ * @param iterations The most clipping rounds
+ * @return The truncated mean of the kept values
+ */
+static uint32_t sigmaClippedMean(uint16_t* values, int count, double kappa, int iterations) {
+  sort(values, values + count);
+  int low = 0, high = count;
+  for (int round = 0; round < iterations && high - low > 2; round++) {
+    double sum = 0, squares = 0;
+    for (int i = low; i < high; i++) {
+      sum += values[i];
+      squares += static_cast<double>(values[i]) * values[i];
+    }
+    double mean = sum / (high - low);
+    double sigma = sqrt(max(0.0, squares / (high - low) - mean * mean));
+    if (sigma == 0) {
+      break;
+    }
+
+    int newLow = low, newHigh = high;
+    while (newLow < newHigh && values[newLow] < mean - kappa * sigma) {
+      newLow++;
+    }
+    while (newHigh > newLow && values[newHigh - 1] > mean + kappa * sigma) {
+      newHigh--;
+    }
+    if ((newLow == low && newHigh == high) || newLow == newHigh) {
+      break; // nothing dropped, or a kappa so small everything would be
+    }
+    low = newLow;
+    high = newHigh;
+  }
+
+  uint64_t total = 0;
+  for (int i = low; i < high; i++) {
+    total += values[i];
+  }
+  return static_cast<uint32_t>(total / (high - low));
+}
+
+
+/**
+ * @brief Winsorized mean: clamps values to within kappa standard deviations of
+ * the median, recomputing the median and deviation from the clamped values,
+ * until nothing changes or the rounds run out, then averages every value
+ *
+ * @param values The values, sorted and clamped by the call
+ * @param count The number of values
+ * @param kappa The threshold in standard deviations
+ * @param iterations The most clamping rounds
+ * @return The truncated mean of the clamped values
+ */
+static uint32_t winsorizedMean(uint16_t* values, int count, double kappa, int iterations) {
+  sort(values, values + count);
+  for (int round = 0; round < iterations && count > 2; round++) {
+    // clamping keeps the values sorted, so the median stays in the middle
+    double median = count % 2 == 1 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2.0;
+    double sum = 0, squares = 0;
+    for (int i = 0; i < count; i++) {
+      sum += values[i];
+      squares += static_cast<double>(values[i]) * values[i];
+    }
+    double mean = sum / count;
+    double sigma = sqrt(max(0.0, squares / count - mean * mean));
+    if (sigma == 0) {
+      break;
+    }
+
+    double lowest = max(0.0, ceil(median - kappa * sigma));
+    double highest = min(65535.0, floor(median + kappa * sigma));
+    bool changed = false;
+    for (int i = 0; i < count; i++) {
+      if (values[i] < lowest) {
+        values[i] = static_cast<uint16_t>(lowest);
+        changed = true;
+      } else if (values[i] > highest) {
+        values[i] = static_cast<uint16_t>(highest);
+        changed = true;
+      }
+    }
+    if (!changed) {
+      break;
+    }
+  }
+
+  uint64_t total = 0;
+  for (int i = 0; i < count; i++) {
+    total += values[i];
+  }
+  return static_cast<uint32_t>(total / count);
+}
+
+
+/**
+ * @struct TiledFrame
+ * @brief One input image while stackTiled() reads it a band of rows at a time
+ */
+struct TiledFrame {
+  MappedFile file;
+  string filename;
+  bool binary; // P6, so any row can be found by its offset
+  size_t offset; // position of the first sample
+  size_t released; // bytes of the mapping already handed back
+  PpmScanner scanner; // resumes P3 parsing where the last band stopped
+
+  TiledFrame() : binary(false), offset(0), released(0), scanner(nullptr, 0, 0) {}
+};
+
+
+/**
+ * @struct DecodedFrame
+ * @brief One input image on its way to the totals, in stackPipelined() or
+ * addImage()
+ */
+struct DecodedFrame {
+  string filename;
+  MappedFile file;
+  string magic;
+  size_t offset; // position of the first sample
+  vector<unsigned char> decoded; // P3 samples rewritten in the P6 layout
+  const unsigned char* samples; // P6 layout samples, in the mapping or in decoded
+  double weight; // what the frame's samples are multiplied by
+  vector<unsigned char> aligned; // the samples shifted onto the reference
+  FrameShift shift; // how far the frame had drifted from the reference
+
+  DecodedFrame() : offset(0), samples(nullptr), weight(1), shift{0, 0, 0} {}
+};
+
+
+/**
+ * @brief Gets a pixel's luminance, weighting green twice as much as red and blue
+ *
+ * @param rgb P6 layout samples
+ * @param sampleBytes 1 or 2 bytes per sample
+ * @param pixel The pixel's index
+ * @return (red + 2 green + blue) / 4
+ */
+static inline double luminanceAt(const unsigned char* rgb, size_t sampleBytes, size_t pixel) {
+  uint32_t channel[3];
+  for (int c = 0; c < 3; c++) {
+    size_t k = pixel * 3 + c;
+    channel[c] = sampleBytes == 1 ? rgb[k] : (static_cast<uint32_t>(rgb[2 * k]) << 8) | rgb[2 * k + 1];
+  }
+  return (channel[0] + 2.0 * channel[1] + channel[2]) / 4;
+}
+
+
+/**
+ * @brief Estimates a frame's noise standard deviation from its luminance with
+ * Immerkaer's method: the mean absolute response to a Laplacian-difference mask
+ * that cancels smooth image structure. Every fourth row is used, which is
+ * plenty for a weight.
+ *
+ * @param rgb P6 layout samples
+ * @param sampleBytes 1 or 2 bytes per sample
+ * @param width, height The frame size
+ * @return The estimated sigma in sample units, or 0 for frames under 3x3
+ */
+static double estimateNoise(const unsigned char* rgb, size_t sampleBytes, int width, int height) {
+  double total = 0;
+  size_t count = 0;
+  for (int y = 1; y + 1 < height; y += 4) {
+    for (int x = 1; x + 1 < width; x++) {
+      double response = 0;
+      const int mask[3][3] = {{1, -2, 1}, {-2, 4, -2}, {1, -2, 1}};
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          size_t pixel = static_cast<size_t>(y + dy) * width + (x + dx);
+          response += mask[dy + 1][dx + 1] * luminanceAt(rgb, sampleBytes, pixel);
+        }
+      }
+      total += fabs(response);
+      count++;
+    }
+  }
+  return count > 0 ? sqrt(M_PI / 2) / 6 * total / count : 0;
+}
+
+
+/**
+ * @brief Measures a frame's sharpness as the mean squared luminance gradient
+ * (central differences), on every fourth row
+ *
+ * @param rgb P6 layout samples
+ * @param sampleBytes 1 or 2 bytes per sample
+ * @param width, height The frame size
+ * @return The mean squared gradient in sample units, or 0 for frames under 3x3
+ */
+static double estimateSharpness(const unsigned char* rgb, size_t sampleBytes, int width, int height) {
+  double total = 0;
+  size_t count = 0;
+  for (int y = 1; y + 1 < height; y += 4) {
+    for (int x = 1; x + 1 < width; x++) {
+      size_t pixel = static_cast<size_t>(y) * width + x;
+      double dx = luminanceAt(rgb, sampleBytes, pixel + 1) - luminanceAt(rgb, sampleBytes, pixel - 1);
+      double dy = luminanceAt(rgb, sampleBytes, pixel + width) - luminanceAt(rgb, sampleBytes, pixel - width);
+      total += dx * dx + dy * dy;
+      count++;
+    }
+  }
+  return count > 0 ? total / count : 0;
+}
+
+// frames each pipeline stage may have waiting for the next
+const size_t PIPELINE_DEPTH = 2;
+
+typedef chrono::steady_clock Clock;
+
+/**
+ * @brief Gets the seconds elapsed since a starting time
+ *
+ * @param start The starting time
+ * @return Elapsed time in seconds
+ */
+static double elapsedSeconds(Clock::time_point start) {
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+
 /**
  * @brief Constructor with default values
  */
-Stacker::Stacker() : magic_number(""), width(0), height(0), max_color(0) {}
+Stacker::Stacker()
+  : magic_number(""), width(0), height(0), max_color(0), threads(1), mode(MODE_MEAN), kappa(3.0),
+    clipIterations(5), tileBudget(size_t(256) << 20), inputDirectory("inputImages/"),
+    outputDirectory("outputImages/"), report(), stackedFrames(0), totalWeight(0), sumType(SUM_AUTO),
+    weighting(WEIGHT_NONE), plannedFrames(0), aligning(false) {}
 
 
 
 /**
- * @brief Reads a single image and add pixel values to the accumulator.
+ * @brief Parses the header of a P3 or P6 image
  *
- * @param filename The name of the image file to read
- * @return True if the read was successful, false otherwise
+ * @param file The mapped image file
+ * @param filename The name of the image, for error messages
+ * @param fileMagic Receives the magic number ("P3" or "P6")
+ * @param fileWidth Receives the width
+ * @param fileHeight Receives the height
+ * @param fileMaxColor Receives the maximum sample value
+ * @param offset Receives the position of the first pixel sample
+ * @return True if the header is valid, false otherwise
  */
-bool Stacker::readImage(const string& filename) {
-  string filepath = "inputImages/" + filename; // looks in the inputImages directory
-  ifstream file(filepath);
-  if (!= file) {
+bool Stacker::readHeader(const MappedFile& file, const string& filename, string& fileMagic,
+                         int& fileWidth, int& fileHeight, int& fileMaxColor, size_t& offset) {
+  const unsigned char* data = file.data();
+  size_t size = file.size();
+
+  if (size < 2 || data[0] != 'P' || (data[1] != '3' && data[1] != '6')) {
+    cerr << "Error: " << filename << " is not a P3 or P6 ppm image" << endl;
+    return false;
+  }
+  fileMagic = string(reinterpret_cast<const char*>(data), 2);
+
+  size_t pos = 2;
+  if (!readHeaderNumber(data, size, pos, fileWidth) || !readHeaderNumber(data, size, pos, fileHeight)
+      || !readHeaderNumber(data, size, pos, fileMaxColor)) {
+    cerr << "Error: Image " << filename << " has a malformed header" << endl;
+    return false;
+  }
+
+  if (fileWidth <= 0 || fileHeight <= 0 || fileMaxColor <= 0 || fileMaxColor > 65535
+      || static_cast<long long>(fileWidth) * fileHeight > INT_MAX / 3) {
+    cerr << "Error: Image " << filename << " has an unsupported size or max color" << endl;
+    return false;
+  }
+
+  // a single whitespace character separates the header from the pixels
+  if (pos >= size || (data[pos] != ' ' && data[pos] != '\t' && data[pos] != '\n' && data[pos] != '\r')) {
+    cerr << "Error: Image " << filename << " has no pixel data" << endl;
+    return false;
+  }
+  offset = pos + 1;
+  return true;
+}
+
+
+/**
+ * @brief Opens an image and parses its header. The first image opened sets the
+ * size and max color of the stack; every later one must match it.
+ *
+ * @param filename The name of the image file (inside inputImages/)
+ * @param file Receives the mapped file
+ * @param fileMagic Receives the magic number ("P3" or "P6")
+ * @param offset Receives the position of the first pixel sample
+ * @return True if the image is usable, false otherwise
+ */
+bool Stacker::openImage(const string& filename, MappedFile& file, string& fileMagic, size_t& offset) {
+  string filepath = inputDirectory + filename; // looks in the inputImages directory unless told otherwise
+  if (!file.open(filepath)) {
     cerr << "Error: Cannot open file " << filepath << endl;
     return false;
   }
 
-  string fileMagic;
   int fileWidth = 0, fileHeight = 0, fileMaxColor = 0;
 
   // Read header
-  file >> fileMagic >> fileWidth >> fileMaxColor;
+  if (!readHeader(file, filename, fileMagic, fileWidth, fileHeight, fileMaxColor, offset)) {
+    return false;
+  }
 
   if (magic_number.empty()) {
       magic_number = fileMagic;
       width = fileWidth;
       height = fileHeight;
       max_color = fileMaxColor;
-      pixels.resize(width * height, {0,0,0});  // running totals
+      if (mode == MODE_MEAN && !prepareTotals()) {
+        return false;
+      }
   } else if (width != fileWidth || height != fileHeight || max_color != fileMaxColor) {
     cerr << "Error: Image " << filename << " dimensions do not match the first image!" << endl;
     return false;
   }
+  return true;
+}
+
 
-  // Read in pixel data
-  for (int i = 0; i < width * height; i++) {
-    int r, g, b;
-    file >> r >> g >> b;
-    pixels[i].red += r;
-    pixels[i].green += g;
-    pixels[i].blue += b;
+/**
+ * @brief Reads a single image and adds its pixel values, times the frame's
+ * weight, to an accumulator. Both ASCII (P3) and binary (P6) images are
+ * accepted, with 8-bit or 16-bit samples; every image must match the first
+ * one's size and max color. When aligning, the frame is shifted onto the
+ * reference first.
+ *
+ * @param filename The name of the image file to read
+ * @param sums The accumulator to add to, sized like the totals (null for the totals)
+ * @param weight Receives the frame's weight
+ * @param shift Receives how far the frame was moved (0 when not aligning)
+ * @return True if the read was successful, false otherwise
+ */
+bool Stacker::addImage(const string& filename, Accumulator* sums, double& weight, FrameShift& shift) {
+  DecodedFrame frame;
+  frame.filename = filename;
+  if (!openImage(filename, frame.file, frame.magic, frame.offset) || !decodeFrame(frame)) {
+    return false;
   }
 
-  file.close();
-  cout << "Successfully read: " << filepath << endl;
+  // the first image creates the totals in openImage(), so look them up only now
+  weight = frameWeight(frame);
+  alignFrame(frame);
+  shift = frame.shift;
+  (sums != nullptr ? *sums : *totals).add(frame.samples, static_cast<size_t>(width) * height,
+                                          max_color < 256 ? 1 : 2, weight);
   return true;
-  
 }
 
 
 /**
- * @brief Stacks multiple images by averaging pixel values
+ * @brief Reads a single image and add pixel values to the accumulator.
  *
- * @param numImages The number of images to be stacked.
+ * @param filename The name of the image file to read
+ * @return True if the read was successful, false otherwise
+ */
+bool Stacker::readImage(const string& filename) {
+  plannedFrames = max<uint64_t>(plannedFrames, stackedFrames + 1);
+  if ((totals && !prepareTotals()) || !prepareRegistration(filename)) {
+    return false;
+  }
+  double weight = 1;
+  FrameShift shift = {0, 0, 0};
+  if (!addImage(filename, nullptr, weight, shift)) {
+    return false;
+  }
+  stackedFrames++;
+  totalWeight += weight;
+
+  cout << "Successfully read: " << inputDirectory << filename << shiftNote(shift) << endl;
+  return true;
+}
+
+
+/**
+ * @brief Sets how many threads stackFiles() decodes images with, and how many
+ * parse workers stackPipelined() runs
+ *
+ * @param threadCount The number of threads; 0 uses every hardware thread
+ */
+void Stacker::setThreads(int threadCount) {
+  if (threadCount <= 0) {
+    threadCount = thread::hardware_concurrency();
+  }
+  threads = threadCount > 0 ? threadCount : 1;
+}
+
+
+/**
+ * @brief Decodes images on several threads. Each thread claims the next unread
+ * image and adds it to its own accumulator; the accumulators are then added to
+ * the totals in thread order. Integer sums make the result bit-identical to
+ * reading the images one after another (floating sums may differ in the last
+ * bits). Memory use is bounded by one accumulator and one mapped image per
+ * thread.
+ *
+ * @param filenames The images to read, after the first has been opened
+ * @return True if every image was read, false otherwise
+ */
+bool Stacker::readImagesParallel(const vector<string>& filenames) {
+  int threadCount = min(threads, static_cast<int>(filenames.size()));
+  vector<unique_ptr<Accumulator>> partials(threadCount);
+  vector<double> weights(filenames.size(), 0);
+  atomic<int> next(0);
+  atomic<bool> failed(false);
+  mutex outputMutex;
+
+  auto worker = [&](int t) {
+    partials[t] = totals->emptyLike();
+    for (int i = next++; i < static_cast<int>(filenames.size()) && !failed; i = next++) {
+      FrameShift shift = {0, 0, 0};
+      if (!addImage(filenames[i], partials[t].get(), weights[i], shift)) {
+        lock_guard<mutex> lock(outputMutex);
+        cerr << "Error: Unable to read image " << filenames[i] << endl;
+        failed = true;
+        return;
+      }
+      lock_guard<mutex> lock(outputMutex);
+      cout << "Successfully read: " << inputDirectory << filenames[i] << shiftNote(shift) << endl;
+    }
+  };
+
+  vector<thread> workers;
+  for (int t = 1; t < threadCount; t++) {
+    workers.emplace_back(worker, t);
+  }
+  worker(0);
+  for (auto& w : workers) {
+    w.join();
+  }
+  if (failed) {
+    return false;
+  }
+
+  // Reduce the per-thread totals
+  for (const auto& partial : partials) {
+    totals->merge(*partial);
+  }
+  for (double weight : weights) {
+    totalWeight += weight;
+  }
+  return true;
+}
+
+
+/**
+ * @brief Sets how the frames are combined at each pixel
+ *
+ * @param stackMode Mean, median, sigma-clipped or winsorized
+ * @param sigmaKappa Rejection threshold in standard deviations (clipping modes)
+ * @param iterations The most rejection rounds per pixel (clipping modes)
+ */
+void Stacker::setMode(StackMode stackMode, double sigmaKappa, int iterations) {
+  mode = stackMode;
+  kappa = sigmaKappa > 0 ? sigmaKappa : 3.0;
+  clipIterations = iterations > 0 ? iterations : 1;
+}
+
+
+/**
+ * @brief Sets how many bytes of frame samples the median and clipping modes may
+ * hold at once. Each band of rows takes width * 3 * 2 bytes per row per frame;
+ * at least one row is always read.
+ *
+ * @param bytes The budget in bytes
+ */
+void Stacker::setTileBudget(size_t bytes) {
+  tileBudget = bytes;
+}
+
+
+/**
+ * @brief Sets the type of the running totals. SUM_AUTO (the default) picks the
+ * narrowest exact one when the first image is read and widens it if a later
+ * stack would overflow it.
+ *
+ * @param type uint32, uint64, float, double, or SUM_AUTO
+ */
+void Stacker::setSumType(SumType type) {
+  sumType = type;
+}
+
+
+/**
+ * @brief Weights each frame of a mean stack by a quality metric, multiplied by
+ * any weight from setFrameWeights(). Weighted totals are floating point.
+ *
+ * @param metric WEIGHT_NOISE for 1 / sigma^2 of the estimated noise (the
+ * weighting that minimizes the noise of the mean), WEIGHT_SHARPNESS for the
+ * mean squared gradient, or WEIGHT_NONE
+ */
+void Stacker::setWeighting(WeightMetric metric) {
+  weighting = metric;
+}
+
+
+/**
+ * @brief Sets per-frame weights for a mean stack. Frames not listed weigh 1.
+ *
+ * @param weights Weight by filename, as passed to stackFiles()
+ */
+void Stacker::setFrameWeights(const map<string, double>& weights) {
+  frameWeights = weights;
+}
+
+
+/**
+ * @brief Gets the weight a frame is added with
+ *
+ * @param frame The decoded frame
+ * @return The user weight (1 if none) times the metric's weight
+ */
+double Stacker::frameWeight(const DecodedFrame& frame) const {
+  double weight = 1;
+  auto found = frameWeights.find(frame.filename);
+  if (found != frameWeights.end()) {
+    weight = found->second;
+  }
+
+  size_t sampleBytes = max_color < 256 ? 1 : 2;
+  if (weighting == WEIGHT_NOISE) {
+    // below half a step the estimate is mostly quantization
+    double sigma = max(0.5, estimateNoise(frame.samples, sampleBytes, width, height));
+    weight /= sigma * sigma;
+  } else if (weighting == WEIGHT_SHARPNESS) {
+    double scale = static_cast<double>(max_color) * max_color;
+    weight *= max(1e-9, estimateSharpness(frame.samples, sampleBytes, width, height) / scale);
+  }
+  return weight;
+}
+
+
+/**
+ * @brief Makes sure the totals can hold plannedFrames images: creates them on
+ * the first image, widens 32-bit totals that would overflow (and integer
+ * totals that now get weighted frames) when the type is SUM_AUTO, and refuses
+ * a requested type that cannot hold the stack
+ *
+ * @return True if the totals are ready, false otherwise
+ */
+bool Stacker::prepareTotals() {
+  SumType needed = narrowestSum(plannedFrames, max_color, weighted());
+  SumType wanted = sumType == SUM_AUTO ? needed : sumType;
+  if (weighted() && (wanted == SUM_UINT32 || wanted == SUM_UINT64)) {
+    cerr << "Error: Weighted frames need float or double totals, not " << sumTypeName(wanted) << endl;
+    return false;
+  }
+  if (wanted == SUM_UINT32 && needed == SUM_UINT64) {
+    cerr << "Error: " << plannedFrames << " images with max color " << max_color
+         << " would overflow 32-bit totals; use uint64, float or double" << endl;
+    return false;
+  }
+
+  if (!totals) {
+    totals = makeAccumulator(wanted, static_cast<size_t>(width) * height);
+    return true;
+  }
+  if (sumType == SUM_AUTO) {
+    // only ever widen what is already there
+    SumType current = totals->type();
+    bool integer = current == SUM_UINT32 || current == SUM_UINT64;
+    wanted = weighted() && integer ? SUM_DOUBLE : current == SUM_UINT32 ? needed : current;
+  }
+  if (totals->type() != wanted) {
+    totals = convertAccumulator(*totals, wanted);
+  }
+  return true;
+}
+
+
+/**
+ * @brief Registers the frames of a mean or stream stack before adding them:
+ * each one's drift from a reference frame is measured by phase correlation and
+ * the frame is resampled to undo it. Pixels shifted in from beyond the edge
+ * repeat the edge. The median and banded rejection modes do not align.
+ *
+ * @param enable True to align
+ * @param reference The frame to align to (looked up like the inputs); empty for
+ * the first frame of the first stack. Give the same one to every run that adds
+ * to a checkpoint, since the reference is not saved with the totals.
+ */
+void Stacker::setAlignment(bool enable, const string& reference) {
+  if (reference != referenceFile) {
+    registration.reset();
+  }
+  aligning = enable;
+  referenceFile = reference;
+}
+
+
+/**
+ * @brief Analyses the reference frame, once, when aligning. The reference is
+ * read an extra time for this, before the stack proper starts.
+ *
+ * @param firstFile The first frame of the stack, used when no reference is set
+ * @return True if there is nothing to do or the reference was read, false otherwise
+ */
+bool Stacker::prepareRegistration(const string& firstFile) {
+  if (!aligning || registration) {
+    return true;
+  }
+  DecodedFrame reference;
+  reference.filename = referenceFile.empty() ? firstFile : referenceFile;
+  if (!openImage(reference.filename, reference.file, reference.magic, reference.offset)
+      || !decodeFrame(reference)) {
+    cerr << "Error: Unable to read reference image " << reference.filename << endl;
+    return false;
+  }
+  registration.reset(new Registration(reference.samples, max_color < 256 ? 1 : 2, width, height));
+  cout << "Aligning to: " << inputDirectory << reference.filename << endl;
+  return true;
+}
+
+
+/**
+ * @brief Measures a frame's drift from the reference and points its samples
+ * at a copy shifted back into line. Frames within a hundredth of a pixel are
+ * left alone.
+ *
+ * @param frame The decoded frame
+ */
+void Stacker::alignFrame(DecodedFrame& frame) const {
+  if (!registration) {
+    return;
+  }
+  frame.shift = registration->estimate(frame.samples);
+  if (fabs(frame.shift.x) < 0.01 && fabs(frame.shift.y) < 0.01) {
+    return;
+  }
+  shiftFrame(frame.samples, max_color < 256 ? 1 : 2, width, height, frame.shift, frame.aligned);
+  frame.samples = frame.aligned.data();
+  frame.decoded = vector<unsigned char>(); // P3 samples, now copied
+}
+
+
+/**
+ * @brief Describes how far a frame was moved, for the "Successfully read" lines
+ *
+ * @param shift The frame's shift
+ * @return " (shifted by x, y)" when aligning, otherwise empty
+ */
+string Stacker::shiftNote(const FrameShift& shift) const {
+  if (!registration) {
+    return "";
+  }
+  char note[64];
+  snprintf(note, sizeof(note), " (shifted by %.2f, %.2f)", shift.x, shift.y);
+  return note;
+}
+
+
+/**
+ * @brief Sets where input images are read from and the output is saved. Each
+ * is a prefix put in front of the filename, so it should end in '/'; an empty
+ * string uses the names as given.
+ *
+ * @param input Prefix for input filenames (inputImages/ by default)
+ * @param output Prefix for the output filename (outputImages/ by default)
+ */
+void Stacker::setDirectories(const string& input, const string& output) {
+  inputDirectory = input;
+  outputDirectory = output;
+}
+
+
+/**
+ * @brief Combines one band of pixels, splitting the band across the threads
+ * set with setThreads()
+ *
+ * @param samples Each pixel's values: pixel p, channel c, frame f at (p * 3 + c) * frames + f
+ * @param frames The number of frames
+ * @param firstPixel Index of the band's first pixel in the image
+ * @param count The number of pixels in the band
+ */
+void Stacker::combineTile(vector<uint16_t>& samples, int frames, size_t firstPixel, size_t count) {
+  auto combine = [&](uint16_t* values) -> uint32_t {
+    if (mode == MODE_MEDIAN) {
+      return medianOf(values, frames);
+    } else if (mode == MODE_SIGMA_CLIP) {
+      return sigmaClippedMean(values, frames, kappa, clipIterations);
+    }
+    return winsorizedMean(values, frames, kappa, clipIterations);
+  };
+
+  auto work = [&](size_t begin, size_t end) {
+    for (size_t p = begin; p < end; p++) {
+      uint16_t* values = samples.data() + p * 3 * frames;
+      pixels.red[firstPixel + p] = combine(values);
+      pixels.green[firstPixel + p] = combine(values + frames);
+      pixels.blue[firstPixel + p] = combine(values + 2 * frames);
+    }
+  };
+
+  size_t threadCount = min(static_cast<size_t>(threads), count / 1024 + 1);
+  vector<thread> workers;
+  for (size_t t = 1; t < threadCount; t++) {
+    workers.emplace_back(work, count * t / threadCount, count * (t + 1) / threadCount);
+  }
+  work(0, count / threadCount);
+  for (auto& w : workers) {
+    w.join();
+  }
+}
+
+
+/**
+ * @brief Median and rejection stacking. These need every frame's value at a
+ * pixel at once, so the image is processed in bands of rows: for each band the
+ * matching rows are read from every frame (P6 rows straight from their offset,
+ * P3 by resuming each frame's scanner), combined, and the frames' pages for
+ * those rows are released. Peak memory is one band of samples from every frame
+ * (about the tile budget) plus the output planes, whatever the frame count.
+ * Frame weights apply to the mean only.
+ *
+ * @param filenames The images to stack (inside inputImages/)
+ * @return True if every image was read, false otherwise
+ */
+bool Stacker::stackTiled(const vector<string>& filenames) {
+  int frames = static_cast<int>(filenames.size());
+  vector<unique_ptr<TiledFrame>> sources;
+  for (const string& filename : filenames) {
+    unique_ptr<TiledFrame> frame(new TiledFrame());
+    frame->filename = filename;
+    string fileMagic;
+    if (!openImage(filename, frame->file, fileMagic, frame->offset)) {
+      cerr << "Error: Unable to read image " << filename << endl;
+      return false;
+    }
+    frame->binary = fileMagic == "P6";
+    frame->released = 0;
+    frame->scanner = PpmScanner(frame->file.data(), frame->file.size(), frame->offset);
+    sources.push_back(move(frame));
+  }
+
+  size_t sampleBytes = max_color < 256 ? 1 : 2;
+  size_t rowSamples = static_cast<size_t>(width) * 3;
+  for (const auto& frame : sources) {
+    if (frame->binary && frame->file.size() - frame->offset < rowSamples * height * sampleBytes) {
+      cerr << "Error: Image " << frame->filename << " is truncated" << endl;
+      return false;
+    }
+  }
+
+  pixels.assign(static_cast<size_t>(width) * height);
+  totals.reset();
+
+  size_t bandBytes = rowSamples * frames * sizeof(uint16_t);
+  int bandRows = static_cast<int>(max<size_t>(1, min<size_t>(height, tileBudget / bandBytes)));
+  vector<uint16_t> samples(bandRows * rowSamples * frames);
+  cout << "Stacking " << frames << " images in bands of " << bandRows << " rows" << endl;
+
+  for (int top = 0; top < height; top += bandRows) {
+    int rows = min(bandRows, height - top);
+    size_t bandSamples = rows * rowSamples;
+
+    for (int f = 0; f < frames; f++) {
+      TiledFrame& frame = *sources[f];
+      uint16_t* out = samples.data() + f;
+      size_t consumed = 0;
+      if (frame.binary) {
+        const unsigned char* in = frame.file.data() + frame.offset + top * rowSamples * sampleBytes;
+        if (sampleBytes == 1) {
+          for (size_t i = 0; i < bandSamples; i++) {
+            out[i * frames] = in[i];
+          }
+        } else {
+          for (size_t i = 0; i < bandSamples; i++) {
+            out[i * frames] = static_cast<uint16_t>((in[2 * i] << 8) | in[2 * i + 1]);
+          }
+        }
+        consumed = frame.offset + (top + rows) * rowSamples * sampleBytes;
+      } else {
+        for (size_t i = 0; i < bandSamples; i++) {
+          int value;
+          if (!frame.scanner.readSample(max_color, value)) {
+            cerr << "Error: Image " << frame.filename << " " << frame.scanner.error() << endl;
+            return false;
+          }
+          out[i * frames] = static_cast<uint16_t>(value);
+        }
+        consumed = frame.scanner.position();
+      }
+      frame.file.release(frame.released, consumed - frame.released);
+      frame.released = consumed;
+    }
+
+    combineTile(samples, frames, static_cast<size_t>(top) * width, rows * static_cast<size_t>(width));
+  }
+
+  for (const auto& frame : sources) {
+    cout << "Successfully read: " << inputDirectory << frame->filename << endl;
+  }
+  stackedFrames = 1; // pixels now holds the final values
+  totalWeight = 1;
+  return true;
+}
+
+
+/**
+ * @brief Kappa-sigma clipping that decodes each frame once, in order, holding
+ * running statistics instead of every frame's samples: the exact sums and sums
+ * of squares, and the lowest and highest few values of every sample (as many
+ * as StreamingClip::reservoirSize() picks for the frame count, kappa and tile
+ * budget). That gives exactly the sigma mode's output unless a pixel drops
+ * more values at one end than were kept; those pixels alone are re-read
+ * afterwards (see rereadFlagged()). Frames are aligned first when
+ * setAlignment() asks.
+ *
+ * @param filenames The images to stack
  * @return True if stacked successfully, false otherwise
  */
-bool Stacker::stackImages(int numImages) {
-  for (int i = 0; i < numImages; ++i) {
-    string filename;
-    cout << "Enter filename " << i + 1 << " (inside inputImages/): ";
-    cin >> filename;
+bool Stacker::stackStreaming(const vector<string>& filenames) {
+  totals.reset();
+  if (!prepareRegistration(filenames[0])) {
+    return false;
+  }
 
-    if (!readImage(filename)) {
+  int frames = static_cast<int>(filenames.size());
+  StreamingClip clip;
+  unique_ptr<Accumulator> sums;
+  size_t count = 0;
+  size_t sampleBytes = 1;
+  for (const string& filename : filenames) {
+    DecodedFrame frame;
+    frame.filename = filename;
+    if (!openImage(filename, frame.file, frame.magic, frame.offset) || !decodeFrame(frame)) {
       cerr << "Error: Unable to read image " << filename << endl;
       return false;
     }
+    if (!sums) {
+      count = static_cast<size_t>(width) * height;
+      sampleBytes = max_color < 256 ? 1 : 2;
+      sums = makeAccumulator(narrowestSum(frames, max_color, false), count);
+      clip.assign(count * 3, StreamingClip::reservoirSize(frames, kappa, count * 3, tileBudget));
+    }
+    alignFrame(frame);
+    sums->add(frame.samples, count, sampleBytes, 1);
+    clip.add(frame.samples, sampleBytes);
+    cout << "Successfully read: " << inputDirectory << filename << shiftNote(frame.shift) << endl;
+  }
+
+  pixels.assign(count);
+  Plane* out[3] = {&pixels.red, &pixels.green, &pixels.blue};
+  vector<size_t> flagged; // pixels that need every value
+  for (size_t p = 0; p < count; p++) {
+    bool known = true;
+    for (int c = 0; c < 3 && known; c++) {
+      const void* plane = sums->plane(c);
+      uint64_t sum = sums->sumBytes() == sizeof(uint32_t) ? static_cast<const uint32_t*>(plane)[p]
+                                                          : static_cast<const uint64_t*>(plane)[p];
+      known = clip.clippedMean(p * 3 + c, sum, kappa, clipIterations, (*out[c])[p]);
+    }
+    if (!known) {
+      flagged.push_back(p);
+    }
+  }
+  sums.reset();
+  clip = StreamingClip(); // free the statistics before reading again
+
+  if (!flagged.empty()) {
+    int passes = 0;
+    if (!rereadFlagged(filenames, flagged, passes)) {
+      return false;
+    }
+    cout << "Re-read " << flagged.size() << " of " << count << " pixels: " << passes * frames
+         << " more frame decodes (" << passes << (passes == 1 ? " pass" : " passes") << ")" << endl;
+  }
+  stackedFrames = 1; // pixels now holds the final values
+  totalWeight = 1;
+  return true;
+}
+
+
+/**
+ * @brief Clips the pixels stackStreaming() could not from its statistics by
+ * collecting their values from every frame. All of them are gathered in one
+ * pass over the frames when their values fit the tile budget, as they do
+ * unless a large share of the pixels is flagged; otherwise in as few passes as
+ * the budget allows. Binary frames are mapped and only the flagged pixels'
+ * pages are touched; P3 frames, and frames being aligned, are decoded whole.
+ *
+ * @param filenames The images being stacked
+ * @param flagged The pixels to clip, in increasing order
+ * @param passes Receives the number of passes over the frames
+ * @return True if every pixel was clipped, false otherwise
+ */
+bool Stacker::rereadFlagged(const vector<string>& filenames, const vector<size_t>& flagged, int& passes) {
+  int frames = static_cast<int>(filenames.size());
+  size_t sampleBytes = max_color < 256 ? 1 : 2;
+  size_t chunk = max<size_t>(1, tileBudget / (3 * frames * sizeof(uint16_t)));
+  Plane* out[3] = {&pixels.red, &pixels.green, &pixels.blue};
+  vector<uint16_t> values;
+
+  passes = 0;
+  for (size_t first = 0; first < flagged.size(); first += chunk) {
+    size_t pixelCount = min(chunk, flagged.size() - first);
+    values.resize(pixelCount * 3 * frames);
+    passes++;
+    for (int f = 0; f < frames; f++) {
+      DecodedFrame frame;
+      frame.filename = filenames[f];
+      if (!openImage(frame.filename, frame.file, frame.magic, frame.offset) || !decodeFrame(frame)) {
+        cerr << "Error: Unable to read image " << frame.filename << endl;
+        return false;
+      }
+      alignFrame(frame);
+      for (size_t j = 0; j < pixelCount; j++) {
+        for (int c = 0; c < 3; c++) {
+          size_t k = flagged[first + j] * 3 + c;
+          values[(j * 3 + c) * frames + f] = sampleBytes == 1 ? frame.samples[k]
+              : static_cast<uint16_t>((frame.samples[2 * k] << 8) | frame.samples[2 * k + 1]);
+        }
+      }
+    }
+
+    for (size_t j = 0; j < pixelCount; j++) {
+      for (int c = 0; c < 3; c++) {
+        (*out[c])[flagged[first + j]] = sigmaClippedMean(values.data() + (j * 3 + c) * frames, frames, kappa,
+                                                         clipIterations);
+      }
+    }
+  }
+  return true;
+}
+
+
+/**
+ * @brief Stacks a list of images by averaging pixel values, decoding them on
+ * the number of threads set with setThreads(), or with the median, rejection
+ * or streaming rejection mode set with setMode()
+ *
+ * @param filenames The images to stack (inside inputImages/)
+ * @return True if stacked successfully, false otherwise
+ */
+bool Stacker::stackFiles(const vector<string>& filenames) {
+  int numImages = static_cast<int>(filenames.size());
+  if (numImages == 0) {
+    cerr << "Error: No images to stack" << endl;
+    return false;
+  }
+
+  if (mode != MODE_MEAN) {
+    if (!(mode == MODE_STREAM_CLIP ? stackStreaming(filenames) : stackTiled(filenames))) {
+      return false;
+    }
+    cout << "Successfully stacked images" << endl;
+    return true;
+  }
+
+  plannedFrames = static_cast<uint64_t>(stackedFrames) + numImages;
+  if (totals && !prepareTotals()) {
+    return false;
+  }
+
+  if (threads <= 1 || numImages == 1) {
+    for (const string& filename : filenames) {
+      if (!readImage(filename)) {
+        cerr << "Error: Unable to read image " << filename << endl;
+        return false;
+      }
+    }
+  } else {
+    // the first image's header sizes the accumulators
+    MappedFile file;
+    string fileMagic;
+    size_t offset = 0;
+    if (magic_number.empty() && !openImage(filenames[0], file, fileMagic, offset)) {
+      cerr << "Error: Unable to read image " << filenames[0] << endl;
+      return false;
+    }
+    file.close();
+    if (!prepareRegistration(filenames[0]) || !readImagesParallel(filenames)) {
+      return false;
+    }
+    stackedFrames += numImages;
+  }
+
+  cout << "Successfully stacked images" << endl;
+  return true;
+}
+
+
+/**
+ * @brief Gets the image to write: the running totals divided by the number (or
+ * total weight) of images added, or the result of a median or rejection stack.
+ * The totals themselves are kept, so more images can still be added or the
+ * totals saved with saveCheckpoint().
+ *
+ * @return The averaged planes
+ */
+Stacker::Planes Stacker::averaged() const {
+  if (!totals) {
+    return pixels;
+  }
+  Planes average;
+  totals->average(totalWeight, average.red, average.green, average.blue);
+  return average;
+}
+
+
+/**
+ * @brief Saves the running totals, frame count and image header, so a later run
+ * can add new images with loadCheckpoint() instead of reading these again
+ *
+ * @param filepath Where to save the checkpoint
+ * @return True if saved, false otherwise
+ */
+bool Stacker::saveCheckpoint(const string& filepath) const {
+  if (mode != MODE_MEAN) {
+    cerr << "Error: Checkpoints hold totals for the mean mode only" << endl;
+    return false;
+  }
+  if (stackedFrames == 0 || !totals) {
+    cerr << "Error: No images to save in checkpoint " << filepath << endl;
+    return false;
   }
 
-  // Average the values
-  for (auto& pixel : pixels) {
-    pixel.red /= numImages;
-    pixel.green /= numImages;
-    pixel.blue /= numImages;
+  CheckpointHeader header;
+  header.magic = magic_number;
+  header.width = width;
+  header.height = height;
+  header.maxColor = max_color;
+  header.frames = stackedFrames;
+  header.totalWeight = totalWeight;
+  if (!writeCheckpoint(filepath, header, *totals)) {
+    return false;
   }
+  cout << "Saved " << stackedFrames << " stacked images to checkpoint " << filepath << endl;
+  return true;
+}
+
 
+/**
+ * @brief Loads totals saved with saveCheckpoint(). Into an empty Stacker this
+ * restores the saved state; otherwise the images must match and the saved
+ * totals are added to the current ones, merging two stacks.
+ *
+ * @param filepath The checkpoint to load
+ * @return True if loaded, false otherwise
+ */
+bool Stacker::loadCheckpoint(const string& filepath) {
+  CheckpointHeader header;
+  unique_ptr<Accumulator> saved = readCheckpoint(filepath, header);
+  if (!saved) {
+    return false;
+  }
+  if (header.width > INT_MAX || header.height > INT_MAX || header.maxColor > 65535 || header.frames > INT_MAX) {
+    cerr << "Error: Checkpoint " << filepath << " has an impossible header" << endl;
+    return false;
+  }
+
+  if (magic_number.empty()) {
+    magic_number = header.magic;
+    width = header.width;
+    height = header.height;
+    max_color = header.maxColor;
+    totals = move(saved);
+    stackedFrames = header.frames;
+    totalWeight = header.totalWeight;
+  } else {
+    if (width != static_cast<int>(header.width) || height != static_cast<int>(header.height)
+        || max_color != static_cast<int>(header.maxColor)) {
+      cerr << "Error: Checkpoint " << filepath << " dimensions do not match the first image!" << endl;
+      return false;
+    }
+
+    // widen the totals first if the merged sums could overflow them
+    plannedFrames = static_cast<uint64_t>(stackedFrames) + header.frames;
+    if (totals && !prepareTotals()) {
+      return false;
+    }
+    if (!totals) {
+      totals = makeAccumulator(saved->type(), saved->size());
+    } else if (saved->floating() && !totals->floating()) {
+      totals = convertAccumulator(*totals, SUM_DOUBLE);
+    }
+    totals->merge(*saved);
+    stackedFrames += header.frames;
+    totalWeight += header.totalWeight;
+  }
+
+  cout << "Loaded " << header.frames << " stacked images from checkpoint " << filepath << endl;
+  return true;
+}
+
+
+/**
+ * @brief The parse stage of stackPipelined() and addImage(): checks a P6 frame
+ * holds every sample, or converts a P3 frame's text into P6 layout samples so
+ * either can be added with the binary kernels
+ *
+ * @param frame The frame, opened by the read stage
+ * @return True if every sample is present and valid, false otherwise
+ */
+bool Stacker::decodeFrame(DecodedFrame& frame) {
+  size_t count = static_cast<size_t>(width) * height * 3;
+  size_t sampleBytes = max_color < 256 ? 1 : 2;
+  if (frame.magic == "P6") {
+    if (frame.file.size() - frame.offset < count * sampleBytes) {
+      cerr << "Error: Image " << frame.filename << " is truncated" << endl;
+      return false;
+    }
+    frame.samples = frame.file.data() + frame.offset;
+    return true;
+  }
+
+  frame.decoded.resize(count * sampleBytes);
+  unsigned char* out = frame.decoded.data();
+  PpmScanner scanner(frame.file.data(), frame.file.size(), frame.offset);
+  for (size_t i = 0; i < count; i++) {
+    int value;
+    if (!scanner.readSample(max_color, value)) {
+      cerr << "Error: Image " << frame.filename << " " << scanner.error() << endl;
+      return false;
+    }
+    if (sampleBytes == 2) {
+      *out++ = static_cast<unsigned char>(value >> 8);
+    }
+    *out++ = static_cast<unsigned char>(value & 0xff);
+  }
+  frame.file.close(); // the text is no longer needed
+  frame.samples = frame.decoded.data();
+  return true;
+}
+
+
+/**
+ * @brief Stacks a list of images by averaging, as a three stage pipeline with
+ * each stage on its own thread: read (map the file, start readahead and fault
+ * the pages in), parse (check the header, turn P3 text into binary samples and
+ * align the frame when setAlignment() asks) and accumulate (add the samples to
+ * the totals). Bounded queues between the stages keep at most PIPELINE_DEPTH
+ * frames waiting at each, so the disk is busy with the next frames while the
+ * current one is parsed and added. With setThreads() above one the parse stage
+ * runs on that many workers, each adding its frames to its own totals as
+ * readImagesParallel() does, and the accumulate stage only merges them at the
+ * end. With integer totals the output matches stackFiles() exactly; float and
+ * double totals add the frames in another order when several workers share
+ * them, so they may differ in the last bits. Timings are kept in
+ * pipelineReport(). The median and rejection modes are not pipelined; they go
+ * through stackFiles().
+ *
+ * @param filenames The images to stack (inside inputImages/ unless set with setDirectories())
+ * @return True if stacked successfully, false otherwise
+ */
+bool Stacker::stackPipelined(const vector<string>& filenames) {
+  report = PipelineReport();
+  if (mode != MODE_MEAN || filenames.empty()) {
+    return stackFiles(filenames);
+  }
+
+  plannedFrames = static_cast<uint64_t>(stackedFrames) + filenames.size();
+  if ((totals && !prepareTotals()) || !prepareRegistration(filenames[0])) {
+    return false;
+  }
+
+  Clock::time_point wallStart = Clock::now();
+  report.stages = {{"read", 0, 0, 0, 0}, {"parse", 0, 0, 0, 0}, {"accumulate", 0, 0, 0, 0}};
+  BoundedQueue<unique_ptr<DecodedFrame>> readFrames(PIPELINE_DEPTH), parsedFrames(PIPELINE_DEPTH);
+  atomic<bool> failed(false);
+  auto fail = [&]() {
+    failed = true;
+    readFrames.close();
+    parsedFrames.close();
+  };
+
+  thread reader([&]() {
+    StageTiming& timing = report.stages[0];
+    Clock::time_point start = Clock::now();
+    for (const string& filename : filenames) {
+      unique_ptr<DecodedFrame> frame(new DecodedFrame());
+      frame->filename = filename;
+      if (!openImage(filename, frame->file, frame->magic, frame->offset)) {
+        cerr << "Error: Unable to read image " << filename << endl;
+        fail();
+        break;
+      }
+      timing.bytes += frame->file.prefetch();
+      timing.frames++;
+
+      Clock::time_point waitStart = Clock::now();
+      bool queued = readFrames.push(move(frame));
+      timing.waitSeconds += elapsedSeconds(waitStart);
+      if (!queued) {
+        break;
+      }
+    }
+    readFrames.close();
+    timing.busySeconds = elapsedSeconds(start) - timing.waitSeconds;
+  });
+
+  // with more than one thread the frames are parsed on that many workers, each
+  // adding its frames to its own totals as readImagesParallel() does
+  int parseThreads = max(1, min(threads, static_cast<int>(filenames.size())));
+  vector<unique_ptr<Accumulator>> partials(parseThreads);
+  vector<double> partialWeights(parseThreads, 0);
+  vector<StageTiming> parseTimings(parseThreads, StageTiming()), addTimings(parseThreads, StageTiming());
+  mutex outputMutex;
+
+  // width, height and max_color are set by the first openImage, which the
+  // queue hands over before any frame reaches the later stages
+  auto parser = [&](int t) {
+    StageTiming& timing = parseTimings[t];
+    StageTiming& adding = addTimings[t];
+    Clock::time_point start = Clock::now();
+    unique_ptr<DecodedFrame> frame;
+    while (true) {
+      Clock::time_point waitStart = Clock::now();
+      bool got = readFrames.pop(frame);
+      timing.waitSeconds += elapsedSeconds(waitStart);
+      if (!got || failed) {
+        break;
+      }
+      if (!decodeFrame(*frame)) {
+        lock_guard<mutex> lock(outputMutex);
+        cerr << "Error: Unable to read image " << frame->filename << endl;
+        fail();
+        break;
+      }
+      frame->weight = frameWeight(*frame);
+      alignFrame(*frame);
+      size_t count = static_cast<size_t>(width) * height;
+      size_t sampleBytes = max_color < 256 ? 1 : 2;
+      timing.bytes += count * 3 * sampleBytes;
+      timing.frames++;
+
+      if (parseThreads > 1) {
+        Clock::time_point addStart = Clock::now();
+        if (!partials[t]) {
+          partials[t] = totals->emptyLike();
+        }
+        partials[t]->add(frame->samples, count, sampleBytes, frame->weight);
+        partialWeights[t] += frame->weight;
+        adding.bytes += count * 3 * sampleBytes;
+        adding.frames++;
+        adding.busySeconds += elapsedSeconds(addStart);
+        lock_guard<mutex> lock(outputMutex);
+        cout << "Successfully read: " << inputDirectory << frame->filename << shiftNote(frame->shift) << endl;
+        frame.reset();
+        continue;
+      }
+
+      waitStart = Clock::now();
+      bool queued = parsedFrames.push(move(frame));
+      timing.waitSeconds += elapsedSeconds(waitStart);
+      if (!queued) {
+        break;
+      }
+    }
+    parsedFrames.close();
+    timing.busySeconds = elapsedSeconds(start) - timing.waitSeconds - adding.busySeconds;
+  };
+
+  StageTiming& timing = report.stages[2];
+  vector<thread> parsers;
+  if (parseThreads > 1) {
+    for (int t = 1; t < parseThreads; t++) {
+      parsers.emplace_back(parser, t);
+    }
+    parser(0);
+    for (auto& p : parsers) {
+      p.join();
+    }
+
+    // add the per-worker totals in worker order
+    Clock::time_point start = Clock::now();
+    for (int t = 0; t < parseThreads && !failed; t++) {
+      if (partials[t]) {
+        totals->merge(*partials[t]);
+        totalWeight += partialWeights[t];
+      }
+    }
+    timing.busySeconds = elapsedSeconds(start);
+  } else {
+    parsers.emplace_back(parser, 0);
+
+    // accumulate on this thread
+    Clock::time_point start = Clock::now();
+    unique_ptr<DecodedFrame> frame;
+    while (true) {
+      Clock::time_point waitStart = Clock::now();
+      bool got = parsedFrames.pop(frame);
+      timing.waitSeconds += elapsedSeconds(waitStart);
+      if (!got || failed) {
+        break;
+      }
+      size_t count = static_cast<size_t>(width) * height;
+      size_t sampleBytes = max_color < 256 ? 1 : 2;
+      totals->add(frame->samples, count, sampleBytes, frame->weight);
+      totalWeight += frame->weight;
+      timing.bytes += count * 3 * sampleBytes;
+      timing.frames++;
+      cout << "Successfully read: " << inputDirectory << frame->filename << shiftNote(frame->shift) << endl;
+      frame.reset(); // unmaps the file before waiting for the next one
+    }
+    timing.busySeconds = elapsedSeconds(start) - timing.waitSeconds;
+    parsers[0].join();
+  }
+  reader.join();
+
+  // the parse and (when fused with it) accumulate times add up over the workers
+  for (int t = 0; t < parseThreads; t++) {
+    report.stages[1].frames += parseTimings[t].frames;
+    report.stages[1].bytes += parseTimings[t].bytes;
+    report.stages[1].busySeconds += parseTimings[t].busySeconds;
+    report.stages[1].waitSeconds += parseTimings[t].waitSeconds;
+    timing.frames += addTimings[t].frames;
+    timing.bytes += addTimings[t].bytes;
+    timing.busySeconds += addTimings[t].busySeconds;
+  }
+  report.wallSeconds = elapsedSeconds(wallStart);
+  if (failed || timing.frames != static_cast<int>(filenames.size())) {
+    return false;
+  }
+
+  stackedFrames += timing.frames;
   cout << "Successfully stacked images" << endl;
   return true;
 }
 
 
+/**
+ * @brief Stacks multiple images by averaging pixel values
+ *
+ * @param numImages The number of images to be stacked.
+ * @return True if stacked successfully, false otherwise
+ */
+bool Stacker::stackImages(int numImages) {
+  vector<string> filenames;
+  for (int i = 0; i < numImages; ++i) {
+    string filename;
+    cout << "Enter filename " << i + 1 << " (inside inputImages/): ";
+    cin >> filename;
+    filenames.push_back(filename);
+  }
+
+  return stackFiles(filenames);
+}
+
+
 /**
  * @brief Writes the new image
  * 
  * @param outputFilename The name of the  output file
+ * @param format P3, P6, or the format of the first input image
  * @return True if the image saved successfully, false otherwise.
  */
-bool Stacker::writeImage(const string& outputFilename) {
-  string filepath = "outputImages/" + outputFilename; // writes to outputImages directory
-  ofstream file(filepath);
+bool Stacker::writeImage(const string& outputFilename, OutputFormat format) {
+  string filepath = outputDirectory + outputFilename; // writes to outputImages directory unless told otherwise
+  ofstream file(filepath, ios::binary);
   if (!file) {
     cerr << "Error: Cannot create file " << filepath << endl;
     return false;
   }
 
+  string outputMagic = magic_number;
+  if (format == FORMAT_P3) {
+    outputMagic = "P3";
+  } else if (format == FORMAT_P6) {
+    outputMagic = "P6";
+  }
+
   // write header file
-  file << magic_number << "\n";
+  file << outputMagic << "\n";
   file << width << " " << height << "\n";
   file << max_color << "\n";
 
   // write pixel data
-  for (const auto& pixel : pixels) {
-    file << pixel.red << " " << pixel.green << " " << pixel.blue << "\n";
+  Planes output = averaged();
+  if (outputMagic == "P6") {
+    // build the whole raster, then write it in one call
+    size_t sampleBytes = max_color < 256 ? 1 : 2;
+    vector<unsigned char> raster(output.size() * 3 * sampleBytes);
+    unsigned char* out = raster.data();
+    for (size_t i = 0; i < output.size(); i++) {
+      uint32_t samples[3] = {output.red[i], output.green[i], output.blue[i]};
+      for (uint32_t sample : samples) {
+        if (sampleBytes == 2) {
+          *out++ = static_cast<unsigned char>(sample >> 8);
+        }
+        *out++ = static_cast<unsigned char>(sample & 0xff);
+      }
+    }
+    file.write(reinterpret_cast<const char*>(raster.data()), raster.size());
+  } else {
+    for (size_t i = 0; i < output.size(); i++) {
+      file << output.red[i] << " " << output.green[i] << " " << output.blue[i] << "\n";
+    }
+  }
+
+  if (!file) {
+    cerr << "Error: Cannot write to file " << filepath << endl;
+    return false;
   }
 
   file.close();
@@ -11,26 +11,131 @@
 #ifndef STACKER_H
 #define STACKER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <vector>
 #include <string>
+#include "Accumulator.h"
+#include "Registration.h"
 
 using namespace std;
 
+class MappedFile;
+struct DecodedFrame;
+
 class Stacker {
+ public:
+  // output formats for writeImage
+  enum OutputFormat {
+    FORMAT_INPUT, // same as the first image read
+    FORMAT_P3,    // ASCII samples
+    FORMAT_P6     // binary samples, 1 byte each (maxval < 256) or 2 bytes big-endian
+  };
+
+  // how stackFiles combines the frames at each pixel
+  enum StackMode {
+    MODE_MEAN,        // average of every frame
+    MODE_MEDIAN,      // middle value
+    MODE_SIGMA_CLIP,  // average after repeatedly dropping values more than kappa sigma from the mean
+    MODE_WINSORIZED,  // average after repeatedly clamping values to within kappa sigma of the median
+    MODE_STREAM_CLIP  // MODE_SIGMA_CLIP from running statistics, decoding each frame once
+  };
+
+  // where frame weights for the mean come from, besides setFrameWeights
+  enum WeightMetric {
+    WEIGHT_NONE,      // every frame counts equally
+    WEIGHT_NOISE,     // inverse of the estimated noise variance
+    WEIGHT_SHARPNESS  // mean squared gradient of the luminance
+  };
+
+  // what one stage of stackPipelined did
+  struct StageTiming {
+    string name;         // read, parse or accumulate
+    int frames;          // frames the stage finished
+    size_t bytes;        // file bytes read, or sample bytes produced or added
+    double busySeconds;  // time spent working
+    double waitSeconds;  // time blocked on the neighbouring stages
+  };
+
+  // timing of the last stackPipelined call
+  struct PipelineReport {
+    double wallSeconds;
+    vector<StageTiming> stages;
+  };
+
  private:
-  struct Pixel {
-    int red, green, blue;
+  // an image stored planar: one aligned array per channel
+  struct Planes {
+    Plane red, green, blue;
+
+    size_t size() const { return red.size(); }
+    void assign(size_t count) { red.assign(count, 0); green.assign(count, 0); blue.assign(count, 0); }
   };
 
   string magic_number;
   int width, height, max_color;
-  vector<Pixel> pixels; // stores pixel data
+  Planes pixels; // final values of a median or rejection stack
+  unique_ptr<Accumulator> totals; // running sums of the mean mode
+  int threads; // threads stackFiles decodes with, parse workers of stackPipelined
+  StackMode mode;
+  double kappa; // rejection threshold in standard deviations
+  int clipIterations; // most rejection rounds per pixel
+  size_t tileBudget; // bytes of frame samples held at once by the rejection modes
+  string inputDirectory; // prefix for input filenames
+  string outputDirectory; // prefix for the output filename
+  PipelineReport report; // filled by stackPipelined
+  int stackedFrames; // images added to totals
+  double totalWeight; // sum of their weights (stackedFrames when unweighted)
+  SumType sumType; // requested totals type
+  WeightMetric weighting;
+  map<string, double> frameWeights; // user-supplied weights by filename
+  uint64_t plannedFrames; // frames the totals must hold by the end of the current stack
+  bool aligning; // shift frames onto the reference before adding them
+  string referenceFile; // frame the others are aligned to; the first one stacked if empty
+  unique_ptr<Registration> registration; // the reference, once analysed
+
+  bool readHeader(const MappedFile& file, const string& filename, string& fileMagic,
+                  int& fileWidth, int& fileHeight, int& fileMaxColor, size_t& offset); // parses a ppm header
+  bool openImage(const string& filename, MappedFile& file, string& fileMagic, size_t& offset); // maps and checks an image
+  bool addImage(const string& filename, Accumulator* sums, double& weight,
+                FrameShift& shift); // adds one image (to totals when null)
+  bool readImagesParallel(const vector<string>& filenames); // decodes images on several threads
+  bool stackTiled(const vector<string>& filenames); // median and rejection modes, a band of rows at a time
+  void combineTile(vector<uint16_t>& samples, int frames, size_t firstPixel, size_t count); // reduces one band
+  bool stackStreaming(const vector<string>& filenames); // sigma clipping in one pass over the frames
+  bool rereadFlagged(const vector<string>& filenames, const vector<size_t>& flagged,
+                     int& passes); // clips the pixels it could not
+  Planes averaged() const; // the totals divided by the frame count
+  bool decodeFrame(DecodedFrame& frame); // readies one frame's samples for adding
+  double frameWeight(const DecodedFrame& frame) const; // user weight times the metric's
+  bool weighted() const { return weighting != WEIGHT_NONE || !frameWeights.empty(); }
+  bool prepareTotals(); // creates or widens totals to hold plannedFrames
+  bool prepareRegistration(const string& firstFile); // analyses the reference frame when aligning
+  void alignFrame(DecodedFrame& frame) const; // shifts a frame's samples onto the reference
+  string shiftNote(const FrameShift& shift) const; // how far a frame was moved, for the progress lines
 
  public:
   Stacker();
   bool readImage(const string& filename); // reads a single ppm image
   bool stackImages(int numImages); // averages pixel values
-  bool writeImage(const string& outputFilename); // saves image
+  bool stackFiles(const vector<string>& filenames); // averages a list of images
+  bool stackPipelined(const vector<string>& filenames); // averages with reading, parsing and adding overlapped
+  const PipelineReport& pipelineReport() const { return report; }
+  void setThreads(int threadCount); // decoding threads for stackFiles and stackPipelined, 0 for all cores
+  void setMode(StackMode stackMode, double sigmaKappa = 3.0, int iterations = 5); // how frames are combined
+  void setTileBudget(size_t bytes); // memory for frame samples in the rejection modes
+  void setDirectories(const string& input, const string& output); // where filenames are looked up and saved
+  void setSumType(SumType type); // width of the totals, SUM_AUTO for the narrowest exact one
+  void setWeighting(WeightMetric metric); // weights frames by a quality metric
+  void setFrameWeights(const map<string, double>& weights); // weights frames by filename
+  void setAlignment(bool enable, const string& reference = ""); // registers mean and stream frames before adding them
+  SumType totalsType() const { return totals ? totals->type() : sumType; }
+  bool saveCheckpoint(const string& filepath) const; // saves the totals for a later run
+  bool loadCheckpoint(const string& filepath); // restores (or merges in) saved totals
+  int frameCount() const { return stackedFrames; }
+  bool writeImage(const string& outputFilename, OutputFormat format = FORMAT_INPUT); // saves image
 
 };
 
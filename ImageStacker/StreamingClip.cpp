@@ -0,0 +1,199 @@
+/**
+ * @file StreamingClip.cpp
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Implementation of single-pass kappa-sigma clipping
+ *
+ * Clipping only ever drops the most extreme values still kept, so the exact
+ * sum and sum of squares of all values and the most extreme few at each end
+ * are enough to repeat the clipping rounds exactly: each dropped value comes
+ * off both sums. A sample that would drop more values at one end than were
+ * kept is reported so the caller can re-read its values.
+ */
+
+
+#include "StreamingClip.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+/**
+ * @brief Picks how many extreme values to keep at each end of every sample.
+ * By Chebyshev's inequality one clipping round drops at most frames / kappa^2
+ * values, so that many, plus two for the later rounds, covers all but unusual
+ * pixels; half the frames at each end covers every value. The extremes cost
+ * 4 bytes per sample for each value kept at both ends and are held within the
+ * tile budget, though never below 2 (or all the values, for fewer frames).
+ *
+ * @param frames The number of frames to be added
+ * @param kappa The clipping threshold in standard deviations
+ * @param samples Samples per frame (width * height * 3)
+ * @param budget Bytes the extremes may take
+ * @return Values to keep at each end
+ */
+int StreamingClip::reservoirSize(int frames, double kappa, size_t samples, size_t budget) {
+  int every = (frames + 1) / 2;
+  double dropped = kappa > 1 ? frames / (kappa * kappa) : frames;
+  int wanted = static_cast<int>(min<double>(every, dropped + 2));
+  size_t affordable = budget / max<size_t>(1, samples * 2 * sizeof(uint16_t));
+  return max(min(wanted, 2), static_cast<int>(min<size_t>(wanted, affordable)));
+}
+
+
+/**
+ * @brief Resizes the statistics for frames of a given number of samples and
+ * forgets any frames already added
+ *
+ * @param samples Samples per frame (width * height * 3)
+ * @param reservoirSize Extreme values to keep at each end (see reservoirSize())
+ */
+void StreamingClip::assign(size_t samples, int reservoirSize) {
+  count = 0;
+  reservoir = reservoirSize;
+  squares.assign(samples, 0);
+  lowest.assign(samples * reservoir, UINT16_MAX);
+  highest.assign(samples * reservoir, 0);
+}
+
+
+/**
+ * @brief Adds one frame's samples to the running statistics
+ */
+template <size_t SampleBytes>
+void StreamingClip::addSamples(const unsigned char* rgb) {
+  size_t samples = squares.size();
+  uint64_t* __restrict sumSquares = squares.data();
+  for (size_t i = 0; i < samples; i++) {
+    uint64_t value = SampleBytes == 1 ? rgb[i] : (static_cast<uint32_t>(rgb[2 * i]) << 8) | rgb[2 * i + 1];
+    sumSquares[i] += value * value;
+  }
+
+  // insertion into the short sorted lists; most values go into neither
+  for (size_t i = 0; i < samples; i++) {
+    uint16_t value = SampleBytes == 1 ? rgb[i] : static_cast<uint16_t>((rgb[2 * i] << 8) | rgb[2 * i + 1]);
+    uint16_t* low = lowest.data() + i * reservoir;
+    if (value < low[reservoir - 1]) {
+      int k = reservoir - 1;
+      for (; k > 0 && low[k - 1] > value; k--) {
+        low[k] = low[k - 1];
+      }
+      low[k] = value;
+    }
+    uint16_t* high = highest.data() + i * reservoir;
+    if (value > high[reservoir - 1]) {
+      int k = reservoir - 1;
+      for (; k > 0 && high[k - 1] < value; k--) {
+        high[k] = high[k - 1];
+      }
+      high[k] = value;
+    }
+  }
+}
+
+
+/**
+ * @brief Adds one frame
+ *
+ * @param rgb The frame's samples, 1 byte or 2 bytes most significant first each (P6 layout)
+ * @param sampleBytes Bytes per sample
+ */
+void StreamingClip::add(const unsigned char* rgb, size_t sampleBytes) {
+  count++;
+  if (sampleBytes == 1) {
+    addSamples<1>(rgb);
+  } else {
+    addSamples<2>(rgb);
+  }
+}
+
+
+/**
+ * @brief Gets the k-th smallest of a sample's values (from 0), when it is
+ * among the kept extremes
+ *
+ * @param i The sample
+ * @param k The rank
+ * @param value Receives the value
+ * @return True if the value is known, false otherwise
+ */
+bool StreamingClip::orderStatistic(size_t i, int k, uint16_t& value) const {
+  if (k < min(reservoir, count)) {
+    value = lowest[i * reservoir + k];
+    return true;
+  }
+  if (k >= count - reservoir) {
+    value = highest[i * reservoir + (count - 1 - k)];
+    return true;
+  }
+  return false;
+}
+
+
+/**
+ * @brief Works out a sample's kappa-sigma clipped mean exactly as the tiled
+ * sigma mode does: rounds of dropping the values more than kappa standard
+ * deviations from the mean of those still kept, until nothing is dropped,
+ * two or fewer values remain or the rounds run out; then the truncated mean
+ * of the rest. The kept values' sum and sum of squares are exact integers, so
+ * the mean and deviation come out bit for bit as sigmaClippedMean's.
+ *
+ * @param i The sample (pixel * 3 + channel)
+ * @param sum The exact sum of the sample's values over every frame
+ * @param kappa The threshold in standard deviations
+ * @param iterations The most clipping rounds
+ * @param value Receives the clipped mean
+ * @return True if it was worked out, false if it needs values that were not kept
+ */
+bool StreamingClip::clippedMean(size_t i, uint64_t sum, double kappa, int iterations, uint32_t& value) const {
+  int low = 0, high = count; // the kept values are ranks low to high - 1
+  uint64_t keptSum = sum, keptSquares = squares[i];
+
+  for (int round = 0; round < iterations && high - low > 2; round++) {
+    double mean = static_cast<double>(keptSum) / (high - low);
+    double sigma = sqrt(max(0.0, static_cast<double>(keptSquares) / (high - low) - mean * mean));
+    if (sigma == 0) {
+      break;
+    }
+
+    int newLow = low, newHigh = high;
+    uint16_t candidate;
+    while (newLow < newHigh) {
+      if (!orderStatistic(i, newLow, candidate)) {
+        return false;
+      }
+      if (!(candidate < mean - kappa * sigma)) {
+        break;
+      }
+      newLow++;
+    }
+    while (newHigh > newLow) {
+      if (!orderStatistic(i, newHigh - 1, candidate)) {
+        return false;
+      }
+      if (!(candidate > mean + kappa * sigma)) {
+        break;
+      }
+      newHigh--;
+    }
+    if ((newLow == low && newHigh == high) || newLow == newHigh) {
+      break;
+    }
+
+    for (int k = low; k < newLow; k++) {
+      orderStatistic(i, k, candidate);
+      keptSum -= candidate;
+      keptSquares -= static_cast<uint64_t>(candidate) * candidate;
+    }
+    for (int k = newHigh; k < high; k++) {
+      orderStatistic(i, k, candidate);
+      keptSum -= candidate;
+      keptSquares -= static_cast<uint64_t>(candidate) * candidate;
+    }
+    low = newLow;
+    high = newHigh;
+  }
+
+  value = static_cast<uint32_t>(keptSum / (high - low));
+  return true;
+}
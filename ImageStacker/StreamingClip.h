@@ -0,0 +1,46 @@
+/**
+ * @file StreamingClip.h
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Header file for single-pass kappa-sigma clipping
+ *
+ * per-sample running statistics from which a kappa-sigma clipped mean can be
+ * worked out after every frame has been decoded just once
+ */
+
+
+#ifndef STREAMINGCLIP_H
+#define STREAMINGCLIP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+class StreamingClip {
+ private:
+  int count; // frames added
+  int reservoir; // extreme values kept at each end of every sample
+  vector<uint64_t> squares; // exact sum of each sample's squared values
+  vector<uint16_t> lowest; // the reservoir smallest values of each sample, ascending
+  vector<uint16_t> highest; // the reservoir largest values of each sample, descending
+
+  template <size_t SampleBytes>
+  void addSamples(const unsigned char* rgb); // one frame's update
+  bool orderStatistic(size_t i, int k, uint16_t& value) const; // k-th smallest value of sample i, if kept
+
+ public:
+  StreamingClip() : count(0), reservoir(0) {}
+  static int reservoirSize(int frames, double kappa, size_t samples, size_t budget); // extremes worth keeping
+  static size_t bytesPerSample(int reservoirSize) { return sizeof(uint64_t) + 2 * reservoirSize * sizeof(uint16_t); }
+  void assign(size_t samples, int reservoirSize); // resizes to samples values per frame, no frames seen
+  void add(const unsigned char* rgb, size_t sampleBytes); // one frame, P6 layout
+  int frames() const { return count; }
+
+  // the clipped mean of sample i, whose values add up to sum; false when the
+  // clipping reaches past the kept extremes and the values must be re-read
+  bool clippedMean(size_t i, uint64_t sum, double kappa, int iterations, uint32_t& value) const;
+};
+
+#endif // STREAMINGCLIP_H
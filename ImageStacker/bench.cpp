@@ -0,0 +1,682 @@
+/**
+ * @file bench.cpp
+ * @author Odin's Ravens
+ * @date 2025-03-08
+ * @brief Benchmark driver for the image stacker
+ * 
+ * Each benchmark is selected by name on the command line; running the driver
+ * with no arguments runs all of them. Images are generated in memory so the
+ * timings do not depend on the disk.
+ */
+
+#include "Accumulator.h"
+#include "Kernels.h"
+#include "PpmScanner.h"
+#include "Registration.h"
+#include "Stacker.h"
+#include "StreamingClip.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/**
+ * @brief Gets the seconds elapsed since a starting time
+ *
+ * @param start The starting time
+ * @return Elapsed time in seconds
+ */
+static double elapsedSeconds(Clock::time_point start) {
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+/**
+ * @brief Builds the pixel data of a P3 image: one pixel per line, a comment every
+ * thousand lines, values drawn at random up to maxValue
+ *
+ * @param pixelCount Number of pixels
+ * @param maxValue The max color
+ * @return The text of the samples (no header)
+ */
+static string makeP3Samples(int pixelCount, int maxValue) {
+  mt19937 rng(12345);
+  uniform_int_distribution<int> sample(0, maxValue);
+  string text;
+  text.reserve(static_cast<size_t>(pixelCount) * 18);
+  for (int i = 0; i < pixelCount; i++) {
+    if (i % 1000 == 0) {
+      text += "# row marker\n";
+    }
+    text += to_string(sample(rng));
+    text += ' ';
+    text += to_string(sample(rng));
+    text += ' ';
+    text += to_string(sample(rng));
+    text += '\n';
+  }
+  return text;
+}
+
+
+/**
+ * @brief P3 sample parsing: iostream extraction (the original reader) against
+ * PpmScanner digit by digit and 8 digits at a time
+ */
+void benchP3Parse() {
+  const int pixelCount = 4000000;
+  const int repeats = 3;
+  const int maxValues[] = {255, 65535};
+
+  cout << "[p3] parsing " << pixelCount << " pixels (best of " << repeats << ")" << endl;
+  cout << "  " << setw(10) << "max color" << setw(16) << "reader" << setw(12) << "MB/s"
+       << setw(12) << "speedup" << endl;
+
+  for (int maxValue : maxValues) {
+    string text = makeP3Samples(pixelCount, maxValue);
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    double megabytes = text.size() / 1e6;
+    double baseline = 0;
+    long long expected = 0;
+
+    for (int reader = 0; reader < 3; reader++) {
+      double best = 0;
+      long long sum = 0;
+      for (int r = 0; r < repeats; r++) {
+        sum = 0;
+        Clock::time_point start = Clock::now();
+        if (reader == 0) {
+          // what Stacker::readImage did: locale-aware stream extraction per sample;
+          // the comment lines are stripped first since >> cannot skip them
+          string stripped;
+          istringstream lines(text);
+          string line;
+          while (getline(lines, line)) {
+            if (line[0] != '#') {
+              stripped += line;
+              stripped += '\n';
+            }
+          }
+          start = Clock::now();
+          istringstream in(stripped);
+          int value;
+          for (int i = 0; i < pixelCount * 3 && in >> value; i++) {
+            sum += value;
+          }
+        } else {
+          PpmScanner scanner(data, text.size(), 0, reader == 2);
+          int value;
+          for (int i = 0; i < pixelCount * 3 && scanner.readSample(maxValue, value); i++) {
+            sum += value;
+          }
+        }
+        double seconds = elapsedSeconds(start);
+        if (r == 0 || seconds < best) {
+          best = seconds;
+        }
+      }
+
+      if (reader == 0) {
+        expected = sum;
+        baseline = best;
+      } else if (sum != expected) {
+        cerr << "  checksum mismatch: " << sum << " vs " << expected << endl;
+      }
+      const char* names[] = {"iostream >>", "scanner scalar", "scanner swar"};
+      cout << "  " << setw(10) << maxValue << setw(16) << names[reader] << fixed << setprecision(1)
+           << setw(12) << megabytes / best << setw(11) << baseline / best << "x" << endl;
+    }
+  }
+}
+
+
+/**
+ * @brief Stacking throughput as the number of frames and decoding threads grows.
+ * Frames are 8-bit P3 images written to a temporary directory, which is removed
+ * afterwards; the stacker's progress messages are discarded while timing.
+ */
+void benchStackThreads() {
+  const int frameWidth = 640, frameHeight = 480;
+  const int frameCounts[] = {4, 16, 48};
+  int maxThreads = static_cast<int>(thread::hardware_concurrency());
+  if (maxThreads < 1) {
+    maxThreads = 1;
+  }
+
+  vector<int> threadCounts;
+  for (int t = 1; t < maxThreads; t *= 2) {
+    threadCounts.push_back(t);
+  }
+  threadCounts.push_back(maxThreads);
+
+  // Stacker reads from inputImages/, so work inside a scratch directory
+  char scratch[] = "/tmp/image_bench_XXXXXX";
+  if (mkdtemp(scratch) == nullptr) {
+    cerr << "  cannot create a scratch directory" << endl;
+    return;
+  }
+  char previous[4096];
+  if (getcwd(previous, sizeof(previous)) == nullptr || chdir(scratch) != 0) {
+    cerr << "  cannot enter the scratch directory" << endl;
+    return;
+  }
+  mkdir("inputImages", 0700);
+
+  int maxFrames = frameCounts[sizeof(frameCounts) / sizeof(frameCounts[0]) - 1];
+  vector<string> filenames;
+  string header = "P3\n" + to_string(frameWidth) + " " + to_string(frameHeight) + "\n255\n";
+  string samples = makeP3Samples(frameWidth * frameHeight, 255);
+  for (int f = 0; f < maxFrames; f++) {
+    filenames.push_back("frame" + to_string(f) + ".ppm");
+    ofstream out("inputImages/" + filenames.back(), ios::binary);
+    out << header << samples;
+  }
+  double frameMegabytes = (header.size() + samples.size()) / 1e6;
+
+  cout << "[stack] " << frameWidth << "x" << frameHeight << " P3 frames (" << fixed << setprecision(1)
+       << frameMegabytes << " MB each), " << maxThreads << " hardware threads" << endl;
+  cout << "  " << setw(8) << "frames" << setw(9) << "threads" << setw(12) << "seconds"
+       << setw(12) << "frames/s" << setw(12) << "speedup" << endl;
+
+  streambuf* console = cout.rdbuf();
+  ostringstream discard;
+  for (int frames : frameCounts) {
+    vector<string> stack(filenames.begin(), filenames.begin() + frames);
+    double baseline = 0;
+    for (int threads : threadCounts) {
+      Stacker stacker;
+      stacker.setThreads(threads);
+      cout.rdbuf(discard.rdbuf());
+      Clock::time_point start = Clock::now();
+      bool ok = stacker.stackFiles(stack);
+      double seconds = elapsedSeconds(start);
+      cout.rdbuf(console);
+      discard.str("");
+      if (!ok) {
+        cerr << "  stacking failed" << endl;
+        break;
+      }
+      if (threads == 1) {
+        baseline = seconds;
+      }
+      cout << "  " << setw(8) << frames << setw(9) << threads << fixed << setprecision(3)
+           << setw(12) << seconds << setprecision(1) << setw(12) << frames / seconds
+           << setw(11) << baseline / seconds << "x" << endl;
+    }
+
+    // the batch pipeline: read, parse and accumulate each on their own thread
+    Stacker stacker;
+    cout.rdbuf(discard.rdbuf());
+    Clock::time_point start = Clock::now();
+    bool ok = stacker.stackPipelined(stack);
+    double seconds = elapsedSeconds(start);
+    cout.rdbuf(console);
+    discard.str("");
+    if (!ok) {
+      cerr << "  pipelined stacking failed" << endl;
+      continue;
+    }
+    cout << "  " << setw(8) << frames << setw(9) << "pipe" << fixed << setprecision(3)
+         << setw(12) << seconds << setprecision(1) << setw(12) << frames / seconds
+         << setw(11) << baseline / seconds << "x" << endl;
+    for (const Stacker::StageTiming& stage : stacker.pipelineReport().stages) {
+      cout << "  " << setw(17) << stage.name << setprecision(3) << setw(12) << stage.busySeconds
+           << " busy " << stage.waitSeconds << " waiting" << endl;
+    }
+  }
+
+  for (const string& filename : filenames) {
+    remove(("inputImages/" + filename).c_str());
+  }
+  rmdir("inputImages");
+  if (chdir(previous) != 0) {
+    cerr << "  cannot return to " << previous << endl;
+  }
+  rmdir(scratch);
+}
+
+
+/**
+ * @brief Checks one kernel set against the scalar kernels (accumulating) and
+ * plain integer division (averaging), on lengths that leave a remainder after
+ * every vector width, and that nothing past the end of a plane is written
+ *
+ * @param kernels The set to check
+ * @param scalar The scalar set
+ * @return True if every result matches, false otherwise
+ */
+static bool kernelsMatch(const StackKernels& kernels, const StackKernels& scalar) {
+  const size_t lengths[] = {1, 2, 3, 5, 7, 15, 17, 31, 33, 63, 65, 127, 129, 1001};
+  const uint32_t divisors[] = {1, 2, 3, 7, 37, 255, 256, 1000, 65535, 65537, 0x7FFFFFFFu, 0xFFFFFFFFu};
+  const size_t guard = 16; // extra samples after each plane that must stay untouched
+  const uint32_t fill = 0xA5A5A5A5u;
+
+  mt19937 rng(11);
+  for (size_t count : lengths) {
+    vector<unsigned char> raster(count * 6);
+    for (auto& byte : raster) {
+      byte = static_cast<unsigned char>(rng());
+    }
+    Plane start(3 * (count + guard), fill);
+    for (int c = 0; c < 3; c++) {
+      for (size_t i = 0; i < count; i++) {
+        start[c * (count + guard) + i] = rng() >> 2; // room for the added samples
+      }
+    }
+
+    for (int bytes = 1; bytes <= 2; bytes++) {
+      Plane expected = start, actual = start;
+      auto add = [&](const StackKernels& set, Plane& planes) {
+        uint32_t* red = planes.data();
+        (bytes == 1 ? set.add8 : set.add16)(raster.data(), count, red, red + (count + guard),
+                                             red + 2 * (count + guard));
+      };
+      add(scalar, expected);
+      add(kernels, actual);
+      if (actual != expected) {
+        cerr << "Error: " << kernels.name << " add" << 8 * bytes << " differs from scalar for "
+             << count << " pixels" << endl;
+        return false;
+      }
+    }
+
+    vector<uint32_t> values(count + guard, fill);
+    for (size_t i = 0; i < count; i++) {
+      values[i] = i == 0 ? 0 : i == 1 ? UINT32_MAX : static_cast<uint32_t>(rng() >> (rng() % 32));
+    }
+    for (uint32_t divisor : divisors) {
+      vector<uint32_t> quotients = values;
+      kernels.divide(quotients.data(), count, divisor);
+      for (size_t i = 0; i < count + guard; i++) {
+        uint32_t expected = i < count ? values[i] / divisor : fill;
+        if (quotients[i] != expected) {
+          cerr << "Error: " << kernels.name << " divide gives " << quotients[i] << " for " << values[i]
+               << " / " << divisor << " (" << count << " values, index " << i << ")" << endl;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+
+/**
+ * @brief Each stacking kernel (8-bit accumulate, 16-bit accumulate, average) for
+ * every instruction set this CPU supports, on an 8-megapixel frame. Each set is
+ * first checked against the scalar kernels, and the run stops if one differs.
+ */
+void benchKernels() {
+  const size_t pixelCount = 8 << 20;
+  const int repeats = 5;
+  const uint32_t frames = 37;
+
+  mt19937 rng(7);
+  vector<unsigned char> raster(pixelCount * 6);
+  for (auto& byte : raster) {
+    byte = static_cast<unsigned char>(rng());
+  }
+  Plane red(pixelCount), green(pixelCount), blue(pixelCount);
+
+  cout << "[kernels] " << (pixelCount >> 20) << " Mpixel frame, best of " << repeats << endl;
+  cout << "  " << setw(10) << "kernels" << setw(10) << "kernel" << setw(14) << "Mpixel/s"
+       << setw(12) << "speedup" << endl;
+
+  const char* kernelNames[] = {"add8", "add16", "divide"};
+  double scalarSeconds[3] = {0, 0, 0};
+  uint32_t checksum = 0;
+  for (const StackKernels* kernels : supportedKernels()) {
+    if (!kernelsMatch(*kernels, *supportedKernels().front())) {
+      exit(1);
+    }
+    for (int k = 0; k < 3; k++) {
+      double best = 0;
+      for (int r = 0; r < repeats; r++) {
+        // sums of a few dozen frames, so divide sees realistic values
+        for (size_t i = 0; i < pixelCount; i++) {
+          red[i] = green[i] = blue[i] = static_cast<uint32_t>(i * 2654435761u) >> 8;
+        }
+        Clock::time_point start = Clock::now();
+        if (k == 0) {
+          kernels->add8(raster.data(), pixelCount, red.data(), green.data(), blue.data());
+        } else if (k == 1) {
+          kernels->add16(raster.data(), pixelCount, red.data(), green.data(), blue.data());
+        } else {
+          kernels->divide(red.data(), pixelCount, frames);
+          kernels->divide(green.data(), pixelCount, frames);
+          kernels->divide(blue.data(), pixelCount, frames);
+        }
+        double seconds = elapsedSeconds(start);
+        if (r == 0 || seconds < best) {
+          best = seconds;
+        }
+        checksum += red[pixelCount / 3] + green[pixelCount / 2] + blue[pixelCount - 1];
+      }
+      if (kernels == supportedKernels().front()) {
+        scalarSeconds[k] = best;
+      }
+      cout << "  " << setw(10) << kernels->name << setw(10) << kernelNames[k] << fixed << setprecision(1)
+           << setw(14) << pixelCount / best / 1e6 << setw(11) << scalarSeconds[k] / best << "x" << endl;
+    }
+  }
+  cout << "  checksum: " << checksum << endl;
+}
+
+
+/**
+ * @brief A named benchmark the driver can run
+ */
+struct Benchmark {
+  const char* name;
+  void (*run)();
+  const char* description;
+};
+
+/**
+ * @brief Times adding a frame to each type of running totals, unweighted and
+ * (for the floating types) weighted, relative to the 32-bit vector kernels
+ */
+void benchSums() {
+  const size_t pixelCount = 4 << 20;
+  const int repeats = 5;
+
+  mt19937 rng(5);
+  vector<unsigned char> raster(pixelCount * 6);
+  for (auto& byte : raster) {
+    byte = static_cast<unsigned char>(rng());
+  }
+
+  cout << "[sums] " << (pixelCount >> 20) << " Mpixel frame, best of " << repeats << endl;
+  cout << "  " << setw(8) << "totals" << setw(8) << "bits" << setw(10) << "weight" << setw(14) << "Mpixel/s"
+       << setw(12) << "time ratio" << endl;
+
+  const SumType types[] = {SUM_UINT32, SUM_UINT64, SUM_FLOAT, SUM_DOUBLE};
+  double baseline[2] = {0, 0};
+  double checksum = 0;
+  for (SumType type : types) {
+    for (double weight : {1.0, 0.75}) {
+      bool floating = type == SUM_FLOAT || type == SUM_DOUBLE;
+      if (weight != 1 && !floating) {
+        continue;
+      }
+      for (size_t sampleBytes = 1; sampleBytes <= 2; sampleBytes++) {
+        unique_ptr<Accumulator> totals = makeAccumulator(type, pixelCount);
+        double best = 0;
+        for (int r = 0; r < repeats; r++) {
+          Clock::time_point start = Clock::now();
+          totals->add(raster.data(), pixelCount, sampleBytes, weight);
+          double seconds = elapsedSeconds(start);
+          if (r == 0 || seconds < best) {
+            best = seconds;
+          }
+        }
+        if (type == SUM_UINT32) {
+          baseline[sampleBytes - 1] = best;
+        }
+        Plane red, green, blue;
+        totals->average(repeats * weight, red, green, blue);
+        checksum += red[pixelCount / 3] + green[pixelCount / 2] + blue[pixelCount - 1];
+
+        cout << "  " << setw(8) << sumTypeName(type) << setw(8) << sampleBytes * 8 << fixed << setprecision(2)
+             << setw(10) << weight << setprecision(1) << setw(14) << pixelCount / best / 1e6
+             << setw(11) << best / baseline[sampleBytes - 1] << "x" << endl;
+      }
+    }
+  }
+  cout << "  checksum: " << checksum << endl;
+}
+
+
+/**
+ * @brief Times the median and rejection modes against the mean. They read the
+ * frames a band of rows at a time, so the sample memory is set by the tile
+ * budget rather than the frame count; the budget is kept small here so every
+ * run takes many bands. The streaming mode holds no bands and gets the default
+ * budget for its extremes; any pixels it has to re-read are reported.
+ */
+void benchRejection() {
+  const int frameWidth = 640, frameHeight = 480;
+  const int frameCounts[] = {8, 32};
+  const size_t tileBudget = size_t(4) << 20;
+  const size_t streamBudget = size_t(256) << 20; // the default: stream holds no bands, only its extremes
+  const Stacker::StackMode modes[] = {Stacker::MODE_MEAN, Stacker::MODE_MEDIAN, Stacker::MODE_SIGMA_CLIP,
+                                      Stacker::MODE_WINSORIZED, Stacker::MODE_STREAM_CLIP};
+  const char* modeNames[] = {"mean", "median", "sigma", "winsor", "stream"};
+
+  char scratch[] = "/tmp/image_bench_XXXXXX";
+  if (mkdtemp(scratch) == nullptr) {
+    cerr << "  cannot create a scratch directory" << endl;
+    return;
+  }
+  char previous[4096];
+  if (getcwd(previous, sizeof(previous)) == nullptr || chdir(scratch) != 0) {
+    cerr << "  cannot enter the scratch directory" << endl;
+    return;
+  }
+  mkdir("inputImages", 0700);
+
+  // binary frames with a few bright outliers, so parsing does not hide the combine cost
+  int maxFrames = frameCounts[sizeof(frameCounts) / sizeof(frameCounts[0]) - 1];
+  vector<string> filenames;
+  string header = "P6\n" + to_string(frameWidth) + " " + to_string(frameHeight) + "\n255\n";
+  mt19937 random(11);
+  string samples(size_t(frameWidth) * frameHeight * 3, '\0');
+  for (int f = 0; f < maxFrames; f++) {
+    for (char& sample : samples) {
+      unsigned value = 96 + random() % 64;
+      sample = static_cast<char>(random() % 50 == 0 ? 255 : value);
+    }
+    filenames.push_back("frame" + to_string(f) + ".ppm");
+    ofstream out("inputImages/" + filenames.back(), ios::binary);
+    out << header << samples;
+  }
+
+  cout << "[reject] " << frameWidth << "x" << frameHeight << " P6 frames, tile budget " << (tileBudget >> 20)
+       << " MB" << endl;
+  cout << "  " << setw(8) << "frames" << setw(9) << "mode" << setw(12) << "seconds" << setw(12) << "frames/s"
+       << setw(14) << "samples MB" << endl;
+
+  streambuf* console = cout.rdbuf();
+  ostringstream discard;
+  for (int frames : frameCounts) {
+    vector<string> stack(filenames.begin(), filenames.begin() + frames);
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+      Stacker stacker;
+      stacker.setMode(modes[m]);
+      size_t budget = modes[m] == Stacker::MODE_STREAM_CLIP ? streamBudget : tileBudget;
+      stacker.setTileBudget(budget);
+      cout.rdbuf(discard.rdbuf());
+      Clock::time_point start = Clock::now();
+      bool ok = stacker.stackFiles(stack);
+      double seconds = elapsedSeconds(start);
+      cout.rdbuf(console);
+      string output = discard.str();
+      discard.str("");
+      if (!ok) {
+        cerr << "  stacking failed" << endl;
+        break;
+      }
+
+      // the mean keeps only the totals and stream its statistics (plus 32-bit
+      // sums); the others hold one band of every frame
+      size_t rowBytes = size_t(frameWidth) * 3 * sizeof(uint16_t) * frames;
+      size_t bandRows = max<size_t>(1, min<size_t>(frameHeight, tileBudget / rowBytes));
+      double sampleMegabytes = bandRows * rowBytes / 1e6;
+      if (modes[m] == Stacker::MODE_MEAN) {
+        sampleMegabytes = 0;
+      } else if (modes[m] == Stacker::MODE_STREAM_CLIP) {
+        size_t samples = size_t(frameWidth) * frameHeight * 3;
+        int reservoir = StreamingClip::reservoirSize(frames, 3.0, samples, budget);
+        sampleMegabytes = samples * (StreamingClip::bytesPerSample(reservoir) + sizeof(uint32_t)) / 1e6;
+      }
+      cout << "  " << setw(8) << frames << setw(9) << modeNames[m] << fixed << setprecision(3)
+           << setw(12) << seconds << setprecision(1) << setw(12) << frames / seconds
+           << setw(14) << sampleMegabytes << endl;
+      size_t reread = output.find("Re-read ");
+      if (reread != string::npos) {
+        cout << "  " << setw(17) << "" << output.substr(reread, output.find('\n', reread) - reread) << endl;
+      }
+    }
+  }
+
+  for (const string& filename : filenames) {
+    remove(("inputImages/" + filename).c_str());
+  }
+  rmdir("inputImages");
+  if (chdir(previous) != 0) {
+    cerr << "  cannot return to " << previous << endl;
+  }
+  rmdir(scratch);
+}
+
+/**
+ * @brief Renders a star field as 8-bit P6 samples: Gaussian stars on a grey sky
+ * with a little noise, all moved right by dx and down by dy
+ *
+ * @param frameWidth Frame width
+ * @param frameHeight Frame height
+ * @param dx Horizontal shift in pixels, may be fractional
+ * @param dy Vertical shift in pixels, may be fractional
+ * @param seed Seed of the noise; the stars are the same for every seed
+ * @return The samples
+ */
+static vector<unsigned char> renderStars(int frameWidth, int frameHeight, double dx, double dy, unsigned seed) {
+  mt19937 layout(5), noise(seed);
+  uniform_real_distribution<double> uniform(0, 1);
+  normal_distribution<double> grain(0, 0.02);
+  vector<double> sky(size_t(frameWidth) * frameHeight, 0.1);
+  for (int s = 0; s < frameWidth * frameHeight / 2000; s++) {
+    double x = uniform(layout) * frameWidth + dx, y = uniform(layout) * frameHeight + dy;
+    double brightness = 0.05 + 0.8 * pow(uniform(layout), 3), radius = 1 + 1.5 * uniform(layout);
+    int reach = static_cast<int>(4 * radius) + 1;
+    for (int py = max(0, int(y) - reach); py < min(frameHeight, int(y) + reach + 1); py++) {
+      for (int px = max(0, int(x) - reach); px < min(frameWidth, int(x) + reach + 1); px++) {
+        double r2 = (px - x) * (px - x) + (py - y) * (py - y);
+        sky[size_t(py) * frameWidth + px] += brightness * exp(-r2 / (2 * radius * radius));
+      }
+    }
+  }
+  vector<unsigned char> samples(sky.size() * 3);
+  for (size_t i = 0; i < samples.size(); i++) {
+    double value = min(1.0, max(0.0, sky[i / 3] + grain(noise)));
+    samples[i] = static_cast<unsigned char>(lround(value * 255));
+  }
+  return samples;
+}
+
+
+/**
+ * @brief Times frame registration against decoding a P3 frame of the same
+ * size: estimating the shift (two FFT correlations on small windows) and
+ * resampling the frame, with the estimate's error for a known shift
+ */
+void benchAlign() {
+  const int sizes[][2] = {{640, 480}, {2000, 1500}, {4000, 3000}};
+  const double dx = 7.37, dy = -3.81;
+  const int repeats = 3;
+
+  cout << "[align] star fields shifted by (" << dx << ", " << dy << "), best of " << repeats << endl;
+  cout << "  " << setw(11) << "size" << setw(13) << "P3 decode ms" << setw(13) << "estimate ms"
+       << setw(10) << "shift ms" << setw(14) << "of decode %" << setw(10) << "error px" << endl;
+
+  for (const auto& size : sizes) {
+    int frameWidth = size[0], frameHeight = size[1];
+    vector<unsigned char> reference = renderStars(frameWidth, frameHeight, 0, 0, 1);
+    vector<unsigned char> moved = renderStars(frameWidth, frameHeight, dx, dy, 2);
+
+    // decoding: the same samples written as P3 text
+    string text;
+    text.reserve(moved.size() * 4);
+    for (unsigned char sample : moved) {
+      text += to_string(sample);
+      text += ' ';
+    }
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+
+    Registration registration(reference.data(), 1, frameWidth, frameHeight);
+    vector<unsigned char> decoded(moved.size()), shifted;
+    double decodeBest = 0, estimateBest = 0, shiftBest = 0;
+    FrameShift shift = {0, 0, 0};
+    for (int r = 0; r < repeats; r++) {
+      Clock::time_point start = Clock::now();
+      PpmScanner scanner(data, text.size(), 0);
+      int value;
+      for (size_t i = 0; i < decoded.size() && scanner.readSample(255, value); i++) {
+        decoded[i] = static_cast<unsigned char>(value);
+      }
+      double decodeSeconds = elapsedSeconds(start);
+
+      start = Clock::now();
+      shift = registration.estimate(decoded.data());
+      double estimateSeconds = elapsedSeconds(start);
+
+      start = Clock::now();
+      shiftFrame(decoded.data(), 1, frameWidth, frameHeight, shift, shifted);
+      double shiftSeconds = elapsedSeconds(start);
+
+      decodeBest = r == 0 ? decodeSeconds : min(decodeBest, decodeSeconds);
+      estimateBest = r == 0 ? estimateSeconds : min(estimateBest, estimateSeconds);
+      shiftBest = r == 0 ? shiftSeconds : min(shiftBest, shiftSeconds);
+    }
+
+    string name = to_string(frameWidth) + "x" + to_string(frameHeight);
+    cout << "  " << setw(11) << name << fixed << setprecision(2) << setw(13) << decodeBest * 1e3
+         << setw(13) << estimateBest * 1e3 << setw(10) << shiftBest * 1e3 << setprecision(1)
+         << setw(14) << 100 * (estimateBest + shiftBest) / decodeBest << setprecision(3)
+         << setw(10) << hypot(shift.x - dx, shift.y - dy) << endl;
+  }
+}
+
+const Benchmark BENCHMARKS[] = {
+  {"p3", benchP3Parse, "P3 sample parsing: iostream vs PpmScanner (scalar and 8 digits at a time)"},
+  {"kernels", benchKernels, "planar accumulate and average kernels: scalar, SSE2, AVX2"},
+  {"stack", benchStackThreads, "stacking 4 to 48 frames on 1 to N decoding threads, and pipelined"},
+  {"sums", benchSums, "adding a frame to uint32, uint64, float and double totals, weighted and not"},
+  {"reject", benchRejection, "median, sigma-clipped, winsorized and streaming sigma stacking against the mean"},
+  {"align", benchAlign, "estimating and undoing a frame's drift against decoding it"},
+};
+
+int main(int argc, char* argv[]) {
+  const int benchmarkCount = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+  if (argc == 1) {
+    for (int i = 0; i < benchmarkCount; ++i) {
+      BENCHMARKS[i].run();
+    }
+    return 0;
+  }
+
+  for (int a = 1; a < argc; ++a) {
+    bool found = false;
+    for (int i = 0; i < benchmarkCount; ++i) {
+      if (strcmp(argv[a], BENCHMARKS[i].name) == 0) {
+        BENCHMARKS[i].run();
+        found = true;
+      }
+    }
+    if (!found) {
+      cerr << "Unknown benchmark: " << argv[a] << "\nAvailable benchmarks:\n";
+      for (int i = 0; i < benchmarkCount; ++i) {
+        cerr << "  " << setw(10) << left << BENCHMARKS[i].name << BENCHMARKS[i].description << endl;
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
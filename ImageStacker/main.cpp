@@ -5,21 +5,351 @@
  * @brief Image stacker user interface
  * 
  * interface to proccess user supplied images
+ *
+ * usage: ./image_stacker [--threads N] [--mode MODE] [--kappa K] [--iterations N] [--tile-mb M]
+ *   --threads N decodes images on N threads (0 for every core, default 1); in
+ *     batch mode the parse stage runs on N workers
+ *   --mode MODE combines frames by mean (default), median, sigma (kappa-sigma
+ *     clipped mean), winsor (winsorized mean) or stream (the sigma mode from
+ *     running statistics, decoding each frame once)
+ *   --kappa K rejection threshold in standard deviations (default 3)
+ *   --iterations N most rejection rounds per pixel (default 5)
+ *   --tile-mb M memory for frame samples in the non-mean modes (default 256)
+ *   --sum TYPE totals of the mean: auto (default, the narrowest exact type),
+ *     uint32, uint64, float or double (Kahan-compensated)
+ *   --weight METRIC weights frames of the mean by noise (1 / sigma^2) or
+ *     sharpness (mean squared gradient)
+ *   --weights FILE weights frames by name, one "filename weight" pair per line;
+ *     multiplies the --weight metric
+ *   --align shifts each frame of the mean (or stream) onto the first one,
+ *     measuring the drift by phase correlation
+ *   --reference FILE aligns to FILE instead (implies --align); give the same
+ *     one to every run that adds to a checkpoint
+ *
+ * batch mode, with no prompts: ./image_stacker [options] --output FILE [--format P3|P6|same]
+ *                                [--list FILE] [--timing FILE] [--checkpoint FILE] PATH...
+ *   PATH is an image, a directory (every .ppm inside) or a glob pattern such as
+ *     "night*.ppm"; paths are used as given rather than inside inputImages/
+ *   --list FILE reads more paths from FILE, one per line ("-" for standard input)
+ *   --output FILE where the stacked image is saved (required unless --checkpoint)
+ *   --format sets the output format (default same as the first input)
+ *   --timing FILE writes the per-stage timing summary to FILE instead of
+ *     printing it as the last line of output
+ *   --checkpoint FILE adds the totals saved in FILE (if it exists) to the new
+ *     images, then saves the combined totals back to FILE; with no PATH it
+ *     just writes the average of what FILE holds
  */
 
 #include "Stacker.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <glob.h>
 #include <iostream>
+#include <sys/stat.h>
 
-int main() {
+
+/**
+ * @brief Turns an output format name into a Stacker::OutputFormat
+ *
+ * @param name P3, P6, or anything else for the input's format
+ * @return The format
+ */
+static Stacker::OutputFormat parseFormat(const string& name) {
+  if (name == "P3" || name == "p3") {
+    return Stacker::FORMAT_P3;
+  } else if (name == "P6" || name == "p6") {
+    return Stacker::FORMAT_P6;
+  }
+  return Stacker::FORMAT_INPUT;
+}
+
+
+/**
+ * @brief Adds the images named by one batch path: every .ppm file inside a
+ * directory (in name order), every match of a glob pattern (in name order), or
+ * a single file
+ *
+ * @param path The directory, pattern or file
+ * @param filenames Receives the image paths
+ * @return True if the path named at least one image, false otherwise
+ */
+static bool expandPath(const string& path, vector<string>& filenames) {
+  struct stat info;
+  if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+      cerr << "Error: Cannot open directory " << path << endl;
+      return false;
+    }
+    vector<string> found;
+    string prefix = path.back() == '/' ? path : path + "/";
+    while (dirent* entry = readdir(dir)) {
+      string name = entry->d_name;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ppm") == 0) {
+        found.push_back(prefix + name);
+      }
+    }
+    closedir(dir);
+    if (found.empty()) {
+      cerr << "Error: No .ppm images in directory " << path << endl;
+      return false;
+    }
+    sort(found.begin(), found.end());
+    filenames.insert(filenames.end(), found.begin(), found.end());
+    return true;
+  }
+
+  if (path.find_first_of("*?[") != string::npos) {
+    glob_t matches;
+    if (glob(path.c_str(), 0, nullptr, &matches) != 0) {
+      cerr << "Error: No images match " << path << endl;
+      globfree(&matches);
+      return false;
+    }
+    for (size_t i = 0; i < matches.gl_pathc; i++) {
+      filenames.push_back(matches.gl_pathv[i]);
+    }
+    globfree(&matches);
+    return true;
+  }
+
+  filenames.push_back(path);
+  return true;
+}
+
+
+/**
+ * @brief Writes the batch timing summary as one line of JSON
+ *
+ * @param out Where to write it
+ * @param frames The number of frames stacked
+ * @param report The pipeline timings
+ */
+static void writeTiming(ostream& out, size_t frames, const Stacker::PipelineReport& report) {
+  out << "{\"frames\":" << frames << ",\"wall_seconds\":" << report.wallSeconds << ",\"stages\":[";
+  for (size_t i = 0; i < report.stages.size(); i++) {
+    const Stacker::StageTiming& stage = report.stages[i];
+    out << (i > 0 ? "," : "") << "{\"stage\":\"" << stage.name << "\",\"frames\":" << stage.frames
+        << ",\"bytes\":" << stage.bytes << ",\"busy_seconds\":" << stage.busySeconds
+        << ",\"wait_seconds\":" << stage.waitSeconds << "}";
+  }
+  out << "]}" << endl;
+}
+
+int main(int argc, char* argv[]) {
   int numImages;
   string outputFilename;
+  string outputFormat;
+  int threads = 1;
+  Stacker::StackMode mode = Stacker::MODE_MEAN;
+  double kappa = 3.0;
+  int iterations = 5;
+  long tileMegabytes = 256;
+  SumType sumType = SUM_AUTO;
+  Stacker::WeightMetric weighting = Stacker::WEIGHT_NONE;
+  string weightsFile;
+  bool align = false;
+  string referenceFile;
+  vector<string> batchPaths; // batch mode when any are given
+  string listFile, timingFile, checkpointFile;
+  bool batch = false;
+
+  // optional command line settings
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+      string name = argv[++i];
+      if (name == "mean") {
+        mode = Stacker::MODE_MEAN;
+      } else if (name == "median") {
+        mode = Stacker::MODE_MEDIAN;
+      } else if (name == "sigma") {
+        mode = Stacker::MODE_SIGMA_CLIP;
+      } else if (name == "winsor") {
+        mode = Stacker::MODE_WINSORIZED;
+      } else if (name == "stream") {
+        mode = Stacker::MODE_STREAM_CLIP;
+      } else {
+        cerr << "Error: unknown mode " << name << " (mean, median, sigma, winsor or stream)" << endl;
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--kappa") == 0 && i + 1 < argc) {
+      kappa = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--tile-mb") == 0 && i + 1 < argc) {
+      tileMegabytes = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--sum") == 0 && i + 1 < argc) {
+      string name = argv[++i];
+      SumType types[] = {SUM_AUTO, SUM_UINT32, SUM_UINT64, SUM_FLOAT, SUM_DOUBLE};
+      bool known = false;
+      for (SumType type : types) {
+        if (name == sumTypeName(type)) {
+          sumType = type;
+          known = true;
+        }
+      }
+      if (!known) {
+        cerr << "Error: unknown sum type " << name << " (auto, uint32, uint64, float or double)" << endl;
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--weight") == 0 && i + 1 < argc) {
+      string name = argv[++i];
+      if (name == "noise") {
+        weighting = Stacker::WEIGHT_NOISE;
+      } else if (name == "sharpness") {
+        weighting = Stacker::WEIGHT_SHARPNESS;
+      } else if (name == "none") {
+        weighting = Stacker::WEIGHT_NONE;
+      } else {
+        cerr << "Error: unknown weight metric " << name << " (noise, sharpness or none)" << endl;
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+      weightsFile = argv[++i];
+    } else if (strcmp(argv[i], "--align") == 0) {
+      align = true;
+    } else if (strcmp(argv[i], "--reference") == 0 && i + 1 < argc) {
+      referenceFile = argv[++i];
+      align = true;
+    } else if (strcmp(argv[i], "--list") == 0 && i + 1 < argc) {
+      listFile = argv[++i];
+      batch = true;
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      outputFilename = argv[++i];
+    } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      outputFormat = argv[++i];
+    } else if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc) {
+      timingFile = argv[++i];
+    } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+      checkpointFile = argv[++i];
+      batch = true;
+    } else if (argv[i][0] != '-') {
+      batchPaths.push_back(argv[i]);
+      batch = true;
+    } else {
+      cerr << "usage: " << argv[0]
+           << " [--threads N] [--mode mean|median|sigma|winsor|stream] [--kappa K] [--iterations N] [--tile-mb M]\n"
+           << "       [--sum auto|uint32|uint64|float|double] [--weight noise|sharpness] [--weights FILE]\n"
+           << "       [--align] [--reference FILE]\n"
+           << "       [--output FILE [--format P3|P6|same] [--list FILE] [--timing FILE] [--checkpoint FILE] PATH...]"
+           << endl;
+      return 1;
+    }
+  }
+
+  Stacker stacker;
+  stacker.setThreads(threads);
+  stacker.setMode(mode, kappa, iterations);
+  stacker.setTileBudget(static_cast<size_t>(max(1L, tileMegabytes)) << 20);
+  stacker.setSumType(sumType);
+  stacker.setWeighting(weighting);
+  if (align && mode != Stacker::MODE_MEAN && mode != Stacker::MODE_STREAM_CLIP) {
+    cerr << "Error: --align works with the mean and stream modes only" << endl;
+    return 1;
+  }
+  stacker.setAlignment(align, referenceFile);
+
+  if (!weightsFile.empty()) {
+    ifstream list(weightsFile);
+    if (!list) {
+      cerr << "Error: Cannot open weights file " << weightsFile << endl;
+      return 1;
+    }
+    map<string, double> weights;
+    string name;
+    double weight;
+    while (list >> name >> weight) {
+      if (!(weight > 0)) {
+        cerr << "Error: Weight for " << name << " must be positive" << endl;
+        return 1;
+      }
+      weights[name] = weight;
+    }
+    if (!list.eof()) {
+      cerr << "Error: Weights file " << weightsFile << " needs \"filename weight\" on each line" << endl;
+      return 1;
+    }
+    stacker.setFrameWeights(weights);
+  }
+
+  if (batch) {
+    if (outputFilename.empty() && checkpointFile.empty()) {
+      cerr << "Error: batch mode needs --output FILE or --checkpoint FILE" << endl;
+      return 1;
+    }
+    if (!checkpointFile.empty() && mode != Stacker::MODE_MEAN) {
+      cerr << "Error: --checkpoint works with the mean mode only" << endl;
+      return 1;
+    }
+    if (!listFile.empty()) {
+      ifstream fileList;
+      if (listFile != "-") {
+        fileList.open(listFile);
+        if (!fileList) {
+          cerr << "Error: Cannot open file list " << listFile << endl;
+          return 1;
+        }
+      }
+      istream& list = listFile == "-" ? cin : fileList;
+      string line;
+      while (getline(list, line)) {
+        if (!line.empty()) {
+          batchPaths.push_back(line);
+        }
+      }
+    }
+
+    vector<string> filenames;
+    for (const string& path : batchPaths) {
+      if (!expandPath(path, filenames)) {
+        return 1;
+      }
+    }
+
+    stacker.setDirectories("", "");
+    struct stat info;
+    if (!checkpointFile.empty() && stat(checkpointFile.c_str(), &info) == 0) {
+      if (!stacker.loadCheckpoint(checkpointFile)) {
+        return 1;
+      }
+    } else if (!checkpointFile.empty()) {
+      cout << "Starting new checkpoint " << checkpointFile << endl;
+    }
+
+    if ((!filenames.empty() || stacker.frameCount() == 0) && !stacker.stackPipelined(filenames)) {
+      cerr << "Error: stacking failed" << endl;
+      return 1;
+    }
+    if (!checkpointFile.empty() && !filenames.empty() && !stacker.saveCheckpoint(checkpointFile)) {
+      return 1;
+    }
+    if (!outputFilename.empty() && !stacker.writeImage(outputFilename, parseFormat(outputFormat))) {
+      cerr << "Error: could not save image " << outputFilename << "\n";
+      return 1;
+    }
+
+    if (timingFile.empty()) {
+      writeTiming(cout, filenames.size(), stacker.pipelineReport());
+    } else {
+      ofstream timing(timingFile);
+      writeTiming(timing, filenames.size(), stacker.pipelineReport());
+      if (!timing) {
+        cerr << "Error: Cannot write timing summary " << timingFile << endl;
+        return 1;
+      }
+    }
+    return 0;
+  }
 
   // prompt user for number of images to process
   cout << "Enter the number of images to stack: ";
   cin >> numImages;
 
-  Stacker stacker;
-
   if(!stacker.stackImages(numImages)) {
     cerr << "Error: stacking failed" << endl;
     return 1;
@@ -29,8 +359,11 @@ int main() {
   cout << "Enter the output filename (including .ppm)";
   cin >> outputFilename;
 
+  //prompt user for output format
+  cout << "Enter the output format (P3, P6, or same as input): ";
+  cin >> outputFormat;
 
-  if (!stacker.writeImage(outputFilename)) {
+  if (!stacker.writeImage(outputFilename, parseFormat(outputFormat))) {
     cerr << "Error: could not save image " << outputFilename << "\n";
     return 1;
   }